@@ -0,0 +1,364 @@
+//
+//  BusSimulator.cpp
+//  VoodooI2CHID
+//
+//  Created on 10/19/26.
+//  Copyright © 2026 VoodooI2C contributors. All rights reserved.
+//
+//  Host-side simulator of transferI2C on a DesignWare controller, with the
+//  real VoodooI2CHIDDevice driving simulated I2C-HID targets. Everything runs
+//  in simulated time, so results are exact and repeatable. Scenarios:
+//    - raw transfer cost by bus speed, restart support and addressing
+//    - how FIFO depth and interrupt latency stall longer reads
+//    - reading wMaxInputLength against a QuirkMaxInputLength sized read
+//    - recovery from bus aborts and from each kind of input desync
+//    - a pen, a touchpad and feature writes sharing one bus
+//  Results are printed as tables.
+//
+
+#include "HIDDeviceRig.hpp"
+
+#include <unistd.h>
+
+#include <algorithm>
+
+#define kAddress 0x2c
+
+static unsigned int runMs = 2000;
+
+//A vendor-defined application with one input report of length bytes, report ID included
+static std::vector<UInt8> vendorReportDescriptor(UInt8 reportID, UInt16 length){
+    return {
+        0x06, 0x00, 0xFF,           //Usage Page (Vendor Defined 0xFF00)
+        0x09, 0x01,                 //Usage (0x01)
+        0xA1, 0x01,                 //Collection (Application)
+        0x85, reportID,             //  Report ID
+        0x09, 0x02,                 //  Usage (0x02)
+        0x15, 0x00,                 //  Logical Minimum (0)
+        0x26, 0xFF, 0x00,           //  Logical Maximum (255)
+        0x75, 0x08,                 //  Report Size (8)
+        0x95, (UInt8)(length - 1),  //  Report Count
+        0x81, 0x02,                 //  Input (Data, Variable, Absolute)
+        0xC0                        //End Collection
+    };
+}
+
+//Reports carry their sequence number so delivery can be matched to when the device queued them
+static std::vector<UInt8> sequencedReport(UInt8 reportID, UInt16 length, unsigned int sequence){
+    std::vector<UInt8> report(length, 0);
+    report[0] = reportID;
+    report[1] = sequence & 0xFF;
+    report[2] = (sequence >> 8) & 0xFF;
+    return report;
+}
+
+static unsigned long long percentile(std::vector<UInt64> samples, unsigned int perMille){
+    if (samples.empty())
+        return 0;
+    std::sort(samples.begin(), samples.end());
+    return samples[(samples.size() - 1) * perMille / 1000];
+}
+
+static UInt64 timeTransfer(DesignWareBus *bus, VoodooI2CControllerBusMessage *messages, int number, IOReturn *ret = NULL){
+    UInt64 start = mach_absolute_time();
+    IOReturn result = bus->controller->transferI2C(messages, number);
+    if (ret)
+        *ret = result;
+    return mach_absolute_time() - start;
+}
+
+static void transferCost(){
+    printf("transfer cost              input read 34B   write+read 2+30B   interrupts  stalls\n");
+
+    struct Mode {
+        const char *name;
+        UInt32 busConfig;
+        bool tenBit;
+    } modes[] = {
+        { "standard", DW_IC_CON_MASTER | DW_IC_CON_SPEED_STD | DW_IC_CON_RESTART_EN, false },
+        { "fast", DW_IC_CON_MASTER | DW_IC_CON_SPEED_FAST | DW_IC_CON_RESTART_EN, false },
+        { "fast, no restart", DW_IC_CON_MASTER | DW_IC_CON_SPEED_FAST, false },
+        { "fast, 10-bit", DW_IC_CON_MASTER | DW_IC_CON_SPEED_FAST | DW_IC_CON_RESTART_EN, true },
+        { "fast, 10-bit, no restart", DW_IC_CON_MASTER | DW_IC_CON_SPEED_FAST, true },
+    };
+
+    for (const Mode &mode : modes){
+        DesignWareConfig config;
+        config.busConfig = mode.busConfig;
+        DesignWareBus bus(config);
+
+        HIDTargetConfig targetConfig;
+        targetConfig.reportDescriptor = vendorReportDescriptor(1, 32);
+        HIDTarget target(targetConfig);
+        bus.attach(kAddress, &target);
+        target.queueReport(sequencedReport(1, 32, 0));
+
+        UInt16 flags = mode.tenBit ? I2C_M_TEN : 0;
+        UInt8 input[34];
+        VoodooI2CControllerBusMessage read = { kAddress, input, (UInt16)(I2C_M_RD | flags), sizeof(input) };
+        IOReturn readRet;
+        UInt64 readNs = timeTransfer(&bus, &read, 1, &readRet);
+
+        UInt8 reg[2] = { 0x01, 0x00 };
+        UInt8 descriptor[30];
+        VoodooI2CControllerBusMessage writeRead[] = {
+            { kAddress, reg, flags, sizeof(reg) },
+            { kAddress, descriptor, (UInt16)(I2C_M_RD | flags), sizeof(descriptor) },
+        };
+        IOReturn writeReadRet;
+        UInt64 writeReadNs = timeTransfer(&bus, writeRead, 2, &writeReadRet);
+
+        printf("  %-24s", mode.name);
+        if (readRet == kIOReturnSuccess)
+            printf(" %13llu us", (unsigned long long)readNs / 1000);
+        else
+            printf(" abort 0x%04x    ", bus.lastAbortSource());
+        if (writeReadRet == kIOReturnSuccess)
+            printf(" %15llu us", (unsigned long long)writeReadNs / 1000);
+        else
+            printf("     abort 0x%04x", bus.lastAbortSource());
+        printf(" %12llu %7llu\n", (unsigned long long)bus.stats.interrupts, (unsigned long long)bus.stats.stalls);
+    }
+}
+
+static void fifoStalls(){
+    printf("\n66B read          fifo  irq latency   duration   interrupts  stalls  stalled   splits\n");
+
+    UInt32 depths[] = { 4, 8, 16, 32 };
+    UInt64 latenciesUs[] = { 10, 50, 200 };
+    for (int hold = 1; hold >= 0; hold--){
+        for (UInt32 depth : depths){
+            for (UInt64 latencyUs : latenciesUs){
+                DesignWareConfig config;
+                config.receiveFifoDepth = depth;
+                config.transactionFifoDepth = depth;
+                config.transactionThreshold = depth / 2;
+                config.interruptLatencyNs = latencyUs * 1000;
+                config.emptyFifoHold = hold;
+                DesignWareBus bus(config);
+
+                HIDTargetConfig targetConfig;
+                targetConfig.maxInputLength = 66;
+                HIDTarget target(targetConfig);
+                bus.attach(kAddress, &target);
+                target.queueReport(std::vector<UInt8>(64, 0x5A));
+
+                UInt8 input[66];
+                VoodooI2CControllerBusMessage read = { kAddress, input, I2C_M_RD, sizeof(input) };
+                UInt64 ns = timeTransfer(&bus, &read, 1);
+
+                printf("  %-14s %6u %9llu us %7llu us %12llu %7llu %6llu us %8llu\n", hold ? "SCL hold" : "STOP on empty", depth,
+                       (unsigned long long)latencyUs, (unsigned long long)ns / 1000, (unsigned long long)bus.stats.interrupts,
+                       (unsigned long long)bus.stats.stalls, (unsigned long long)bus.stats.stallNs / 1000, (unsigned long long)bus.stats.splits);
+            }
+        }
+    }
+}
+
+struct StreamResult {
+    std::vector<UInt64> latencyNs;
+    UInt64 queued;
+    UInt64 delivered;
+};
+
+//Latency from the device queueing a report to the driver handing it to the HID stack
+static void collectLatency(HIDDeviceRig *rig, const std::vector<UInt64> &queuedAt, StreamResult *result){
+    for (const HIDDeviceRigReport &report : rig->reports){
+        if (report.bytes.size() < 3)
+            continue;
+        unsigned int sequence = report.bytes[1] | report.bytes[2] << 8;
+        if (sequence < queuedAt.size())
+            result->latencyNs.push_back(report.time - queuedAt[sequence]);
+    }
+    result->queued = queuedAt.size();
+    result->delivered = rig->reports.size();
+}
+
+static std::vector<UInt64> stream(HIDTarget *target, UInt8 reportID, UInt16 length, UInt64 periodNs, UInt64 offsetNs = 0){
+    unsigned int count = (unsigned int)(runMs * 1000000ULL / periodNs);
+    std::vector<UInt64> queuedAt;
+    UInt64 start = mach_absolute_time() + offsetNs;
+    for (unsigned int i = 0; i < count; i++)
+        queuedAt.push_back(start + i * periodNs);
+    target->streamReports(start, periodNs, count, [reportID, length](unsigned int i){
+        return sequencedReport(reportID, length, i);
+    });
+    return queuedAt;
+}
+
+static void printStream(const char *name, const StreamResult &result, DesignWareBus *bus){
+    printf("  %-26s %8llu/%-8llu %8llu %8llu %8llu", name, (unsigned long long)result.delivered, (unsigned long long)result.queued,
+           percentile(result.latencyNs, 500) / 1000, percentile(result.latencyNs, 990) / 1000, percentile(result.latencyNs, 1000) / 1000);
+    if (bus)
+        printf(" %9llu%%\n", (unsigned long long)(bus->stats.busNs * 100 / (runMs * 1000000ULL)));
+    else
+        printf("         -\n");
+}
+
+static void readStrategy(){
+    printf("\nread size, 30B reports at 125 Hz   delivered      p50 us   p99 us   max us  bus busy\n");
+
+    UInt16 readLengths[] = { 0, 32 };
+    for (UInt16 readLength : readLengths){
+        DesignWareBus bus;
+        HIDTargetConfig targetConfig;
+        targetConfig.maxInputLength = 256;
+        targetConfig.reportDescriptor = vendorReportDescriptor(1, 30);
+        HIDTarget target(targetConfig);
+        HIDDeviceRig rig(&bus, &target, kAddress);
+        if (readLength)
+            rig.setProperty("QuirkMaxInputLength", (UInt32)readLength);
+        if (!rig.start()){
+            printf("  driver failed to start\n");
+            continue;
+        }
+
+        bus.stats = DesignWareStats();
+        std::vector<UInt64> queuedAt = stream(&target, 1, 30, 8000000);
+        HostSimulationWait(runMs * 1000000ULL + 50000000ULL);
+
+        StreamResult result;
+        collectLatency(&rig, queuedAt, &result);
+        printStream(readLength ? "QuirkMaxInputLength 32" : "wMaxInputLength 256", result, &bus);
+        rig.stop();
+    }
+}
+
+static void faultRecovery(){
+    printf("\nrecovery                     delivered  retries flushes powercycles resets failures  aborts\n");
+
+    struct Case {
+        const char *name;
+        DesignWareFault fault;
+        unsigned int perMille;
+        HIDTargetDesync desync;
+        unsigned int reads;
+    } cases[] = {
+        { "clean", kDesignWareFaultNone, 0, kHIDTargetDesyncNone, 0 },
+        { "address NACK 1%", kDesignWareFaultAddressNack, 10, kHIDTargetDesyncNone, 0 },
+        { "address NACK 5%", kDesignWareFaultAddressNack, 50, kHIDTargetDesyncNone, 0 },
+        { "data NACK 5%, writes only", kDesignWareFaultDataNack, 50, kHIDTargetDesyncNone, 0 },
+        { "arbitration lost 5%", kDesignWareFaultArbitrationLost, 50, kHIDTargetDesyncNone, 0 },
+        { "desync, 1 read", kDesignWareFaultNone, 0, kHIDTargetDesyncReads, 1 },
+        { "desync, 4 reads", kDesignWareFaultNone, 0, kHIDTargetDesyncReads, 4 },
+        { "desync until power cycle", kDesignWareFaultNone, 0, kHIDTargetDesyncUntilPowerCycle, 0 },
+        { "desync until reset", kDesignWareFaultNone, 0, kHIDTargetDesyncUntilReset, 0 },
+    };
+
+    for (const Case &test : cases){
+        DesignWareBus bus;
+        HIDTargetConfig targetConfig;
+        targetConfig.maxInputLength = 32;
+        targetConfig.reportDescriptor = vendorReportDescriptor(1, 30);
+        HIDTarget target(targetConfig);
+        HIDDeviceRig rig(&bus, &target, kAddress);
+        if (!rig.start()){
+            printf("  driver failed to start\n");
+            continue;
+        }
+
+        bus.stats = DesignWareStats();
+        if (test.perMille)
+            bus.setRandomFault(test.fault, test.perMille);
+        if (test.desync != kHIDTargetDesyncNone)
+            target.desync(test.desync, test.reads);
+        std::vector<UInt64> queuedAt = stream(&target, 1, 30, 8000000);
+        HostSimulationWait(runMs * 1000000ULL + 50000000ULL);
+        bus.setRandomFault(kDesignWareFaultNone, 0);
+
+        printf("  %-26s %6llu/%-6llu %6llu %7llu %11llu %6llu %8llu %7llu\n", test.name,
+               (unsigned long long)rig.reports.size(), (unsigned long long)queuedAt.size(),
+               (unsigned long long)rig.statistic("InputRecovery", "Retries"), (unsigned long long)rig.statistic("InputRecovery", "Flushes"),
+               (unsigned long long)rig.statistic("InputRecovery", "PowerCycles"), (unsigned long long)rig.statistic("InputRecovery", "Resets"),
+               (unsigned long long)rig.statistic("InputRecovery", "Failures"), (unsigned long long)bus.stats.aborts);
+        rig.stop();
+    }
+}
+
+struct FeatureWriter {
+    HIDDeviceRig *rig;
+    unsigned int bursts;
+};
+
+//A user client pushing a burst of four 40 byte feature reports every 50ms
+static void writeFeatures(void *context, int waitResult){
+    FeatureWriter *writer = (FeatureWriter *)context;
+    UInt8 feature[40] = { 0 };
+    for (unsigned int burst = 0; burst < writer->bursts; burst++){
+        for (int i = 0; i < 4; i++)
+            writer->rig->device->setReport(3, kIOHIDReportTypeFeature, feature, sizeof(feature));
+        IOSleep(50);
+    }
+}
+
+static void sharedBus(){
+    printf("\nshared bus, 400 kHz              delivered      p50 us   p99 us   max us  bus busy\n");
+
+    DesignWareBus bus;
+
+    HIDTargetConfig penConfig;
+    penConfig.maxInputLength = 22;
+    penConfig.reportDescriptor = vendorReportDescriptor(1, 20);
+    HIDTarget pen(penConfig);
+    HIDDeviceRig penRig(&bus, &pen, 0x10);
+
+    HIDTargetConfig touchpadConfig;
+    touchpadConfig.maxInputLength = 32;
+    touchpadConfig.reportDescriptor = vendorReportDescriptor(2, 30);
+    HIDTarget touchpad(touchpadConfig);
+    HIDDeviceRig touchpadRig(&bus, &touchpad, kAddress);
+
+    if (!penRig.start() || !touchpadRig.start()){
+        printf("  driver failed to start\n");
+        return;
+    }
+
+    bus.stats = DesignWareStats();
+    std::vector<UInt64> penQueuedAt = stream(&pen, 1, 20, 4166666);
+    std::vector<UInt64> touchpadQueuedAt = stream(&touchpad, 2, 30, 8000000, 1000000);
+
+    FeatureWriter writer = { &touchpadRig, runMs / 50 };
+    thread_t thread;
+    kernel_thread_start(writeFeatures, &writer, &thread);
+
+    HostSimulationWait(runMs * 1000000ULL + 50000000ULL);
+
+    StreamResult penResult, touchpadResult;
+    collectLatency(&penRig, penQueuedAt, &penResult);
+    collectLatency(&touchpadRig, touchpadQueuedAt, &touchpadResult);
+    printStream("pen, 20B at 240 Hz", penResult, NULL);
+    printStream("touchpad, 30B at 125 Hz", touchpadResult, &bus);
+    printf("  %-26s %8llu/%u\n", "feature writes", (unsigned long long)touchpad.stats.featureReports, writer.bursts * 4);
+
+    penRig.stop();
+    touchpadRig.stop();
+}
+
+static void usage(const char *name){
+    fprintf(stderr, "usage: %s [-t run_ms]\n"
+            "  -t  simulated time each streaming scenario runs for (default 2000)\n", name);
+    exit(1);
+}
+
+int main(int argc, char **argv){
+    int option;
+    while ((option = getopt(argc, argv, "t:h")) != -1){
+        switch (option){
+            case 't':
+                runMs = (unsigned int)strtoul(optarg, NULL, 0);
+                break;
+            default:
+                usage(argv[0]);
+        }
+    }
+    if (optind != argc || runMs == 0)
+        usage(argv[0]);
+
+    HostSimulationStart();
+    transferCost();
+    fifoStalls();
+    readStrategy();
+    faultRecovery();
+    sharedBus();
+    return 0;
+}
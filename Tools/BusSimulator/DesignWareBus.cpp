@@ -0,0 +1,324 @@
+//
+//  DesignWareBus.cpp
+//  VoodooI2CHID
+//
+//  Created on 10/19/26.
+//  Copyright © 2026 VoodooI2C contributors. All rights reserved.
+//
+
+#include "DesignWareBus.hpp"
+
+#include <deque>
+
+#define kNever (~0ULL)
+
+//START, repeated START and STOP are each counted as one SCL period, as is the bus free time after a STOP
+#define kConditionBits 1
+
+struct DesignWareCommand {
+    int message;
+    UInt16 index;
+    bool read;
+    //First byte of its message, preceded by an addressing phase
+    bool first;
+};
+
+DesignWareBus::DesignWareBus(const DesignWareConfig &config) : config(config) {
+    this->bus = VoodooI2CControllerBusDevice();
+    this->bus.acpi_config = &this->config.counts;
+    this->bus.awake = true;
+    this->bus.bus_config = config.busConfig;
+    this->bus.functionality = I2C_FUNC_I2C | I2C_FUNC_10BIT_ADDR;
+    this->bus.name = "DesignWareBus";
+    this->bus.receive_fifo_depth = config.receiveFifoDepth;
+    this->bus.transaction_fifo_depth = config.transactionFifoDepth;
+    this->bus.clock_rate = config.clockKHz;
+
+    this->controller = HostControllerCreate(this);
+    this->controller->bus_device = &this->bus;
+    this->lock = IOLockAlloc();
+
+    this->scriptedFault = kDesignWareFaultNone;
+    this->scriptedFaults = 0;
+    this->randomFault = kDesignWareFaultNone;
+    this->randomFaultPerMille = 0;
+    this->sclHz = 0;
+}
+
+DesignWareBus::~DesignWareBus(){
+    this->controller->bus_device = NULL;
+    this->controller->release();
+    IOLockFree(this->lock);
+}
+
+void DesignWareBus::attach(UInt16 address, I2CTarget *target){
+    this->targets[address] = target;
+}
+
+void DesignWareBus::detach(UInt16 address){
+    this->targets.erase(address);
+}
+
+void DesignWareBus::injectFault(DesignWareFault fault, unsigned int count){
+    this->scriptedFault = fault;
+    this->scriptedFaults = count;
+}
+
+void DesignWareBus::setRandomFault(DesignWareFault fault, unsigned int perMille, unsigned int seed){
+    this->randomFault = fault;
+    this->randomFaultPerMille = perMille;
+    this->random.seed(seed);
+}
+
+DesignWareFault DesignWareBus::nextFault(){
+    if (this->scriptedFaults){
+        this->scriptedFaults--;
+        return this->scriptedFault;
+    }
+    if (this->randomFaultPerMille && this->random() % 1000 < this->randomFaultPerMille)
+        return this->randomFault;
+    return kDesignWareFaultNone;
+}
+
+//SCL is held high for HCNT plus the spike filter and sync delay, low for LCNT plus one cycle
+UInt64 DesignWareBus::bitTimeNs(UInt32 hcnt, UInt32 lcnt) const {
+    return ((UInt64)(hcnt + 8 + lcnt + 1) * 1000000ULL) / this->config.clockKHz;
+}
+
+IOReturn DesignWareBus::transfer(VoodooI2CControllerDriver *controller, VoodooI2CControllerBusMessage *messages, int number){
+    //The controller's command gate lets one transfer at a time onto the bus
+    IOLockLock(this->lock);
+
+    UInt64 elapsedNs = 0;
+    IOReturn ret = play(messages, number, &elapsedNs);
+    if (HostSimulationActive())
+        HostSimulationWait(elapsedNs);
+
+    //The target sees the final STOP once the transfer has actually taken its time
+    std::map<UInt16, I2CTarget *>::iterator target = this->targets.find(messages[0].address);
+    if (number > 0 && target != this->targets.end())
+        target->second->stop();
+
+    this->stats.transfers++;
+    this->stats.busNs += elapsedNs;
+    if (ret != kIOReturnSuccess)
+        this->stats.aborts++;
+
+    IOLockUnlock(this->lock);
+    return ret;
+}
+
+IOReturn DesignWareBus::play(VoodooI2CControllerBusMessage *messages, int number, UInt64 *elapsedNs){
+    UInt64 now = this->config.setupNs;
+    *elapsedNs = now;
+    this->bus.abort_source = 0;
+
+    if (number <= 0)
+        return kIOReturnBadArgument;
+
+    //IC_TAR, IC_CON and the SCL counts are programmed once per transfer, and the FIFO can't express a zero length message
+    for (int i = 0; i < number; i++){
+        if (messages[i].address != messages[0].address || messages[i].speed != messages[0].speed ||
+            messages[i].hcnt != messages[0].hcnt || messages[i].lcnt != messages[0].lcnt)
+            return kIOReturnBadArgument;
+        if (messages[i].length == 0)
+            return kIOReturnUnsupported;
+    }
+
+    bool tenBit = (messages[0].flags & I2C_M_TEN) != 0;
+    bool restart = (this->config.busConfig & DW_IC_CON_RESTART_EN) != 0;
+    VoodooI2CControllerBusConfig &counts = this->config.counts;
+    UInt64 bitNs;
+    if (messages[0].speed){
+        //The message brings its own speed and counts, programmed into the FS registers for the transfer
+        bitNs = bitTimeNs(messages[0].hcnt, messages[0].lcnt);
+        this->stats.speedRequests++;
+    } else {
+        bitNs = (this->config.busConfig & DW_IC_CON_SPEED_FAST) ? bitTimeNs(counts.fs_hcnt, counts.fs_lcnt) : bitTimeNs(counts.ss_hcnt, counts.ss_lcnt);
+    }
+    this->sclHz = (UInt32)(1000000000ULL / bitNs);
+
+    std::map<UInt16, I2CTarget *>::iterator found = this->targets.find(messages[0].address);
+    I2CTarget *target = found == this->targets.end() ? NULL : found->second;
+
+    std::vector<DesignWareCommand> commands;
+    bool anyRead = false;
+    for (int i = 0; i < number; i++){
+        bool read = (messages[i].flags & I2C_M_RD) != 0;
+        anyRead |= read;
+        for (UInt16 j = 0; j < messages[i].length; j++){
+            DesignWareCommand command = { i, j, read, j == 0 };
+            commands.push_back(command);
+        }
+    }
+
+    DesignWareFault fault = nextFault();
+    UInt32 abortSource = 0;
+
+    size_t queued = 0;
+    size_t shifted = 0;
+    size_t drained = 0;
+    UInt32 transactionLevel = 0;
+    UInt32 outstandingReads = 0;
+    std::deque<UInt8> receiveFifo;
+
+    bool busy = false;
+    bool onWire = false;
+    bool addressed = false;
+    UInt64 busDoneAt = kNever;
+    UInt64 idleSince = kNever;
+
+    //Enabling the controller with an empty TX FIFO raises TX_EMPTY straight away
+    UInt64 interruptAt = now + this->config.interruptLatencyNs;
+
+    //10-bit reads need a repeated START to turn the bus around after the address
+    if (tenBit && anyRead && !restart){
+        abortSource = DW_IC_TX_ABRT_10B_RD_NORSTRT;
+        goto abort;
+    }
+
+    for (;;){
+        if (!busy && shifted < queued){
+            const DesignWareCommand &command = commands[shifted];
+            if (idleSince != kNever){
+                this->stats.stalls++;
+                this->stats.stallNs += now - idleSince;
+                idleSince = kNever;
+            }
+
+            UInt64 bits = 0;
+            if (command.first || !onWire){
+                if (onWire && restart){
+                    bits += kConditionBits;
+                } else {
+                    //Without IC_RESTART_EN the controller ends the transaction and starts a new one
+                    if (onWire && target)
+                        target->stop();
+                    bits += (onWire ? 2 * kConditionBits : 0) + kConditionBits;
+                }
+                if (!command.first)
+                    this->stats.splits++;
+                onWire = true;
+
+                //10-bit reads send both address bytes as a write, then turn around with the first byte again
+                bits += tenBit ? (command.read ? 9 * 3 + kConditionBits : 9 * 2) : 9;
+
+                if (!addressed && fault == kDesignWareFaultArbitrationLost){
+                    now += bits * bitNs;
+                    abortSource = DW_IC_TX_ARB_LOST;
+                    goto abort;
+                }
+                //A target that doesn't answer its address never sees the transaction
+                bool acked = !(!addressed && fault == kDesignWareFaultAddressNack) && target && target->select(command.read);
+                if (!acked){
+                    now += bits * bitNs;
+                    abortSource = tenBit ? DW_IC_TX_ABRT_10ADDR1_NOACK : DW_IC_TX_ABRT_7B_ADDR_NOACK;
+                    goto abort;
+                }
+                addressed = true;
+            }
+
+            bits += 9;
+            busDoneAt = now + bits * bitNs + (command.read ? target->stretchNs() : 0);
+            busy = true;
+            transactionLevel--;
+            if (transactionLevel <= this->config.transactionThreshold && queued < commands.size() && interruptAt == kNever)
+                interruptAt = now + this->config.interruptLatencyNs;
+            continue;
+        }
+
+        if (!busy && shifted == commands.size())
+            break;
+
+        if (!busy && idleSince == kNever && shifted > 0){
+            //SCL is held low from here until the handler catches up
+            idleSince = now;
+            if (!this->config.emptyFifoHold && transactionLevel == 0 && onWire){
+                if (target)
+                    target->stop();
+                onWire = false;
+            }
+        }
+
+        UInt64 next = busy ? busDoneAt : kNever;
+        if (interruptAt < next)
+            next = interruptAt;
+        if (next == kNever){
+            fprintf(stderr, "DesignWareBus: transfer stuck with %zu of %zu commands queued\n", queued, commands.size());
+            abort();
+        }
+        now = next;
+
+        if (busy && busDoneAt == now){
+            const DesignWareCommand &command = commands[shifted++];
+            busy = false;
+            this->stats.bytes++;
+            if (command.read){
+                receiveFifo.push_back(target->read());
+                //IC_RX_TL is 0, RX_FULL follows every byte
+                if (interruptAt == kNever)
+                    interruptAt = now + this->config.interruptLatencyNs;
+            } else {
+                bool acked = target->write(messages[command.message].buffer[command.index]);
+                if (fault == kDesignWareFaultDataNack){
+                    acked = false;
+                    fault = kDesignWareFaultNone;
+                }
+                if (!acked){
+                    abortSource = DW_IC_TX_ABRT_TXDATA_NOACK;
+                    goto abort;
+                }
+            }
+            continue;
+        }
+
+        //Interrupt handler: drain the RX FIFO, then top up the TX FIFO within what the RX FIFO can take back
+        interruptAt = kNever;
+        this->stats.interrupts++;
+        while (!receiveFifo.empty()){
+            while (!commands[drained].read)
+                drained++;
+            messages[commands[drained].message].buffer[commands[drained].index] = receiveFifo.front();
+            receiveFifo.pop_front();
+            drained++;
+            outstandingReads--;
+        }
+        while (queued < commands.size() && transactionLevel < this->config.transactionFifoDepth){
+            if (commands[queued].read){
+                if (outstandingReads >= this->config.receiveFifoDepth)
+                    break;
+                outstandingReads++;
+            }
+            transactionLevel++;
+            queued++;
+        }
+        //TX_EMPTY stays asserted while the FIFO is at or below the threshold and commands remain
+        if (queued < commands.size() && transactionLevel <= this->config.transactionThreshold)
+            interruptAt = now + this->config.interruptLatencyNs;
+    }
+
+    //STOP, then the STOP_DET interrupt drains whatever is left and completes the transfer
+    now += kConditionBits * bitNs + this->config.interruptLatencyNs;
+    this->stats.interrupts++;
+    while (!receiveFifo.empty()){
+        while (!commands[drained].read)
+            drained++;
+        messages[commands[drained].message].buffer[commands[drained].index] = receiveFifo.front();
+        receiveFifo.pop_front();
+        drained++;
+    }
+    *elapsedNs = now + this->config.completionNs;
+    return kIOReturnSuccess;
+
+abort:
+    //TX_ABRT flushes both FIFOs and the controller issues a STOP
+    now += kConditionBits * bitNs + this->config.interruptLatencyNs;
+    this->stats.interrupts++;
+    this->bus.abort_source = abortSource;
+    *elapsedNs = now + this->config.completionNs;
+    if (abortSource & DW_IC_TX_ABRT_NOACK)
+        return kIOReturnNotResponding;
+    if (abortSource & DW_IC_TX_ARB_LOST)
+        return kIOReturnBusy;
+    return kIOReturnIOError;
+}
@@ -0,0 +1,135 @@
+//
+//  DesignWareBus.hpp
+//  VoodooI2CHID
+//
+//  Created on 10/19/26.
+//  Copyright © 2026 VoodooI2C contributors. All rights reserved.
+//
+//  Models the DesignWare I2C master that VoodooI2C drives, at the level of
+//  its FIFOs and interrupts. A transfer is played out byte by byte: the
+//  interrupt handler refills the TX FIFO with data and read commands when it
+//  drops to the threshold and drains the RX FIFO, the bus shifts one command
+//  per nine SCL periods, holds SCL low when it runs out of commands or RX
+//  space, and aborts with the DW_IC_TX_ABRT_SOURCE bits the hardware would
+//  set. The calling thread is blocked for the simulated duration, so the
+//  driver's transfer scheduler and readers see realistic bus occupancy.
+//
+
+#ifndef DesignWareBus_hpp
+#define DesignWareBus_hpp
+
+#include "HostController.hpp"
+
+#include <random>
+
+//A device on the bus, addressed by DesignWareBus in the order the wire sees it
+class I2CTarget {
+public:
+    virtual ~I2CTarget() {}
+
+    //START or repeated START addressing the target, false NACKs the address
+    virtual bool select(bool read) { return true; }
+
+    //Byte written by the master, false NACKs it
+    virtual bool write(UInt8 byte) { return true; }
+
+    //Byte clocked out to the master
+    virtual UInt8 read() { return 0xFF; }
+
+    //STOP, ending the transaction
+    virtual void stop() {}
+
+    //How long the target holds SCL low before the next byte it sends
+    virtual UInt64 stretchNs() { return 0; }
+};
+
+struct DesignWareConfig {
+    //IC_CLK input in kHz, the SCL counts are in cycles of it
+    UInt32 clockKHz = 100000;
+    VoodooI2CControllerBusConfig counts;
+    UInt32 busConfig = DW_IC_CON_MASTER | DW_IC_CON_SPEED_FAST | DW_IC_CON_RESTART_EN;
+
+    UInt32 receiveFifoDepth = 32;
+    UInt32 transactionFifoDepth = 32;
+    //IC_TX_TL, TX_EMPTY fires at or below it. IC_RX_TL is 0, every received byte raises RX_FULL.
+    UInt32 transactionThreshold = 16;
+
+    //Without IC_EMPTYFIFO_HOLD_MASTER_EN an empty TX FIFO ends the transaction with a STOP
+    bool emptyFifoHold = true;
+
+    //From a FIFO interrupt being raised to its handler running
+    UInt64 interruptLatencyNs = 5000;
+    //Programming IC_TAR and IC_CON and enabling the controller
+    UInt64 setupNs = 10000;
+    //From STOP_DET to transferI2C returning
+    UInt64 completionNs = 5000;
+};
+
+enum DesignWareFault {
+    kDesignWareFaultNone,
+    kDesignWareFaultAddressNack,
+    kDesignWareFaultDataNack,
+    kDesignWareFaultArbitrationLost
+};
+
+struct DesignWareStats {
+    UInt64 transfers = 0;
+    UInt64 bytes = 0;
+    UInt64 interrupts = 0;
+    UInt64 stalls = 0;
+    UInt64 stallNs = 0;
+    //Transactions cut in two by a TX FIFO underrun
+    UInt64 splits = 0;
+    UInt64 aborts = 0;
+    UInt64 busNs = 0;
+    //Transfers whose messages asked for a speed of their own
+    UInt64 speedRequests = 0;
+};
+
+class DesignWareBus : public HostBus {
+public:
+    DesignWareBus(const DesignWareConfig &config = DesignWareConfig());
+    virtual ~DesignWareBus();
+
+    //Controller the driver sees, bus_device reflects config
+    VoodooI2CControllerDriver *controller;
+
+    void attach(UInt16 address, I2CTarget *target);
+    void detach(UInt16 address);
+
+    //Fails the next transfers count times with fault
+    void injectFault(DesignWareFault fault, unsigned int count = 1);
+    //Fails each transfer with probability perMille/1000, repeatably for a seed
+    void setRandomFault(DesignWareFault fault, unsigned int perMille, unsigned int seed = 1);
+
+    //DW_IC_TX_ABRT_SOURCE of the last aborted transfer
+    UInt32 lastAbortSource() const { return this->bus.abort_source; }
+
+    //SCL frequency the last transfer ran at
+    UInt32 lastSclHz() const { return this->sclHz; }
+
+    //SCL period for the counts in effect
+    UInt64 bitTimeNs(UInt32 hcnt, UInt32 lcnt) const;
+
+    DesignWareStats stats;
+
+    IOReturn transfer(VoodooI2CControllerDriver *controller, VoodooI2CControllerBusMessage *messages, int number) override;
+
+private:
+    DesignWareConfig config;
+    VoodooI2CControllerBusDevice bus;
+    std::map<UInt16, I2CTarget *> targets;
+    IOLock *lock;
+
+    DesignWareFault scriptedFault;
+    unsigned int scriptedFaults;
+    DesignWareFault randomFault;
+    unsigned int randomFaultPerMille;
+    std::mt19937 random;
+    UInt32 sclHz;
+
+    DesignWareFault nextFault();
+    IOReturn play(VoodooI2CControllerBusMessage *messages, int number, UInt64 *elapsedNs);
+};
+
+#endif /* DesignWareBus_hpp */
@@ -0,0 +1,138 @@
+//
+//  HIDDeviceRig.cpp
+//  VoodooI2CHID
+//
+//  Created on 10/19/26.
+//  Copyright © 2026 VoodooI2C contributors. All rights reserved.
+//
+
+#include "HIDDeviceRig.hpp"
+#include "VoodooI2CHIDDeviceWrapper.hpp"
+
+#include <algorithm>
+
+static std::vector<HIDDeviceRig *> rigs;
+
+//The HID stack is shared, hand each report back to the rig whose driver sent it
+static void captureReport(IOHIDDevice *hidDevice, AbsoluteTime timeStamp, const UInt8 *report, UInt32 length){
+    VoodooI2CHIDDeviceWrapper *wrapper = OSDynamicCast(VoodooI2CHIDDeviceWrapper, hidDevice);
+    if (!wrapper)
+        return;
+    for (HIDDeviceRig *rig : rigs){
+        if (rig->device != wrapper->provider)
+            continue;
+        HIDDeviceRigReport captured = { mach_absolute_time(), timeStamp, std::vector<UInt8>(report, report + length) };
+        rig->reports.push_back(captured);
+    }
+}
+
+HIDDeviceRig::HIDDeviceRig(DesignWareBus *bus, HIDTarget *target, UInt16 address, UInt32 speedHz, bool tenBit) : bus(bus), target(target), address(address), started(false) {
+    if (rigs.empty())
+        HostHIDSetReportHandler(captureReport);
+    rigs.push_back(this);
+
+    this->acpiDevice = new IOACPIPlatformDevice;
+    this->acpiDevice->init();
+
+    //_DSM function 1 of the HID-over-I2C GUID returns the HID descriptor register
+    OSNumber *descriptorRegister = OSNumber::withNumber(0x0001, 16);
+    this->acpiDevice->setObject("_DSM", descriptorRegister);
+    descriptorRegister->release();
+
+    setConnection(speedHz, address, tenBit);
+
+    this->nub = new IOService;
+    this->nub->init();
+    this->nub->setName("VoodooI2CControllerNub");
+    this->nub->setProperty("i2cAddress", address, 16);
+    this->nub->setProperty("addrWidth", tenBit ? 10 : 7, 8);
+    this->nub->setProperty("acpi-device", this->acpiDevice);
+    this->nub->attach(bus->controller);
+
+    this->device = new VoodooI2CHIDDevice;
+    this->device->init();
+    this->device->setName("VoodooI2CHIDDevice");
+    this->device->attach(this->nub);
+}
+
+HIDDeviceRig::~HIDDeviceRig(){
+    stop();
+    rigs.erase(std::find(rigs.begin(), rigs.end(), this));
+    this->device->release();
+    this->nub->release();
+    this->acpiDevice->release();
+}
+
+void HIDDeviceRig::setConnection(UInt32 speedHz, UInt16 address, bool tenBit){
+    std::vector<UInt8> resources;
+    if (speedHz){
+        const char *source = "\\_SB.PCI0.I2C1";
+        UInt16 itemLength = (UInt16)(15 + strlen(source) + 1);
+        UInt8 serialBus[] = {
+            0x8E, (UInt8)(itemLength & 0xFF), (UInt8)(itemLength >> 8),
+            0x01, 0x00, 0x01, 0x02, (UInt8)(tenBit ? 0x01 : 0x00), 0x00, 0x01, 0x06, 0x00,
+            (UInt8)speedHz, (UInt8)(speedHz >> 8), (UInt8)(speedHz >> 16), (UInt8)(speedHz >> 24),
+            (UInt8)(address & 0xFF), (UInt8)(address >> 8)
+        };
+        resources.insert(resources.end(), serialBus, serialBus + sizeof(serialBus));
+        resources.insert(resources.end(), source, source + strlen(source) + 1);
+    }
+    resources.push_back(0x79);
+    resources.push_back(0x00);
+    OSData *crs = OSData::withBytes(resources.data(), (unsigned int)resources.size());
+    this->acpiDevice->setObject("_CRS", crs);
+    crs->release();
+}
+
+void HIDDeviceRig::setProperty(const char *key, OSObject *value){
+    this->device->setProperty(key, value);
+}
+
+void HIDDeviceRig::setProperty(const char *key, UInt32 value){
+    this->device->setProperty(key, value, 32);
+}
+
+void HIDDeviceRig::setProperty(const char *key, bool value){
+    this->device->setProperty(key, value);
+}
+
+bool HIDDeviceRig::start(){
+    IOService *nub = this->nub;
+    this->target->interruptLine = [nub](bool asserted){
+        HostInterruptSetLevel(nub, 0, asserted);
+    };
+    this->bus->attach(this->address, this->target);
+    SInt32 score = 0;
+    this->started = this->device->probe(this->nub, &score) && this->device->start(this->nub);
+    return this->started;
+}
+
+void HIDDeviceRig::stop(){
+    if (this->started)
+        this->device->stop(this->nub);
+    this->started = false;
+    this->bus->detach(this->address);
+    this->target->interruptLine = nullptr;
+}
+
+void HIDDeviceRig::setPowerState(unsigned long state){
+    this->device->setPowerState(state, this->device);
+}
+
+OSObject *HIDDeviceRig::copyProperty(const char *key){
+    this->device->serializeProperties(NULL);
+    OSObject *value = this->device->getProperty(key);
+    if (value)
+        value->retain();
+    return value;
+}
+
+UInt64 HIDDeviceRig::statistic(const char *dictionary, const char *key){
+    OSObject *value = copyProperty(dictionary);
+    OSDictionary *stats = OSDynamicCast(OSDictionary, value);
+    OSNumber *number = stats ? OSDynamicCast(OSNumber, stats->getObject(key)) : NULL;
+    UInt64 result = number ? number->unsigned64BitValue() : ~0ULL;
+    if (value)
+        value->release();
+    return result;
+}
@@ -0,0 +1,66 @@
+//
+//  HIDDeviceRig.hpp
+//  VoodooI2CHID
+//
+//  Created on 10/19/26.
+//  Copyright © 2026 VoodooI2C contributors. All rights reserved.
+//
+//  Builds what VoodooI2CHIDDevice expects to find when it starts: a
+//  controller nub carrying the target's address, an ACPI device answering
+//  _DSM with the HID descriptor register and _CRS with an I2cSerialBus
+//  resource, and the interrupt line wired to the target. The driver is the
+//  real one; every report it hands to the HID stack is captured with the
+//  simulated time it was delivered.
+//
+
+#ifndef HIDDeviceRig_hpp
+#define HIDDeviceRig_hpp
+
+#include "HIDTarget.hpp"
+#include "VoodooI2CHIDDevice.hpp"
+
+struct HIDDeviceRigReport {
+    //When the HID stack got it, and the event time the driver attached
+    UInt64 time;
+    UInt64 timeStamp;
+    std::vector<UInt8> bytes;
+};
+
+class HIDDeviceRig {
+public:
+    //speedHz is what _CRS declares for the connection, 0 leaves it out
+    HIDDeviceRig(DesignWareBus *bus, HIDTarget *target, UInt16 address, UInt32 speedHz = 400000, bool tenBit = false);
+    ~HIDDeviceRig();
+
+    //Driver properties, as Info.plist personalities or the user would set them; must come before start()
+    void setProperty(const char *key, OSObject *value);
+    void setProperty(const char *key, UInt32 value);
+    void setProperty(const char *key, bool value);
+
+    //Replaces the I2cSerialBus resource in _CRS, for a connection that doesn't match the device; must come before start()
+    void setConnection(UInt32 speedHz, UInt16 address, bool tenBit = false);
+
+    //Probes and starts the driver as IOKit matching would
+    bool start();
+    void stop();
+
+    //Puts the device to sleep and wakes it as system sleep would
+    void setPowerState(unsigned long state);
+
+    //A registry property of the driver, refreshed as ioreg would
+    OSObject *copyProperty(const char *key);
+    UInt64 statistic(const char *dictionary, const char *key);
+
+    VoodooI2CHIDDevice *device;
+    std::vector<HIDDeviceRigReport> reports;
+
+private:
+    DesignWareBus *bus;
+    HIDTarget *target;
+    UInt16 address;
+    IOService *nub;
+    IOACPIPlatformDevice *acpiDevice;
+    bool started;
+};
+
+#endif /* HIDDeviceRig_hpp */
@@ -0,0 +1,258 @@
+//
+//  HIDTarget.cpp
+//  VoodooI2CHID
+//
+//  Created on 10/19/26.
+//  Copyright © 2026 VoodooI2C contributors. All rights reserved.
+//
+
+#include "HIDTarget.hpp"
+
+#define kHIDOpcodeReset 0x01
+#define kHIDOpcodeSetReport 0x03
+#define kHIDOpcodeSetPower 0x08
+
+#define kHIDPowerOn 0x00
+#define kHIDPowerSleep 0x01
+
+#define kHIDReportTypeOutput 0x02
+#define kHIDReportTypeFeature 0x03
+
+HIDTarget::HIDTarget(const HIDTargetConfig &config) : config(config) {
+    this->awake = true;
+    this->wokeAt = 0;
+    this->resetGeneration = 0;
+    this->resetComplete = false;
+    this->desyncMode = kHIDTargetDesyncNone;
+    this->desyncReads = 0;
+    this->reading = false;
+    this->readIndex = 0;
+    this->inputRead = false;
+    this->pointerSet = false;
+    this->pointer = 0;
+    this->lineAsserted = false;
+}
+
+void HIDTarget::queueReport(const std::vector<UInt8> &report){
+    //The device's own buffer is small, a host that falls behind loses the oldest reports
+    if (this->reports.size() >= this->config.queueDepth){
+        this->reports.pop_front();
+        this->stats.dropped++;
+    }
+
+    UInt16 length = (UInt16)(report.size() + 2);
+    std::vector<UInt8> framed;
+    framed.push_back(length & 0xFF);
+    framed.push_back(length >> 8);
+    framed.insert(framed.end(), report.begin(), report.end());
+    this->reports.push_back(framed);
+    this->stats.queued++;
+    updateInterrupt();
+}
+
+void HIDTarget::streamReports(UInt64 start, UInt64 period, unsigned int count, std::function<std::vector<UInt8>(unsigned int)> generate){
+    for (unsigned int i = 0; i < count; i++){
+        HostSimulationAt(start + i * period, [this, i, generate]{
+            queueReport(generate(i));
+        });
+    }
+}
+
+void HIDTarget::desync(HIDTargetDesync mode, unsigned int reads){
+    this->desyncMode = mode;
+    this->desyncReads = reads;
+}
+
+std::vector<UInt8> HIDTarget::feature(UInt8 reportID) const {
+    std::map<UInt8, std::vector<UInt8>>::const_iterator found = this->features.find(reportID);
+    return found == this->features.end() ? std::vector<UInt8>() : found->second;
+}
+
+void HIDTarget::updateInterrupt(){
+    bool asserted = this->resetComplete || !this->reports.empty();
+    if (asserted == this->lineAsserted)
+        return;
+    this->lineAsserted = asserted;
+    if (this->interruptLine)
+        this->interruptLine(asserted);
+}
+
+bool HIDTarget::select(bool read){
+    //A repeated START ends the write before it
+    if (!this->reading && !this->written.empty())
+        finishWrite();
+
+    this->reading = read;
+    this->written.clear();
+    if (read)
+        beginRead();
+    return true;
+}
+
+bool HIDTarget::write(UInt8 byte){
+    this->written.push_back(byte);
+    return true;
+}
+
+UInt8 HIDTarget::read(){
+    UInt8 byte = this->readIndex < this->readData.size() ? this->readData[this->readIndex] : 0;
+    this->readIndex++;
+    return byte;
+}
+
+UInt64 HIDTarget::stretchNs(){
+    return this->inputRead && this->readIndex == 0 ? this->config.inputStretchNs : 0;
+}
+
+void HIDTarget::stop(){
+    if (!this->reading && !this->written.empty())
+        finishWrite();
+
+    //Whatever the host didn't read of a report is gone
+    if (this->inputRead && this->readIndex < this->readData.size())
+        this->stats.truncated++;
+
+    this->reading = false;
+    this->inputRead = false;
+    this->readData.clear();
+    this->readIndex = 0;
+    updateInterrupt();
+}
+
+void HIDTarget::beginRead(){
+    UInt16 reg = this->pointerSet ? this->pointer : this->config.inputRegister;
+    this->pointerSet = false;
+    this->readData.clear();
+    this->readIndex = 0;
+
+    if (reg == this->config.descriptorRegister){
+        UInt16 fields[] = {
+            30, 0x0100, (UInt16)this->config.reportDescriptor.size(), this->config.reportDescriptorRegister,
+            this->config.inputRegister, this->config.maxInputLength, this->config.outputRegister, this->config.maxOutputLength,
+            this->config.commandRegister, this->config.dataRegister, this->config.vendorID, this->config.productID,
+            this->config.versionID, 0, 0
+        };
+        for (UInt16 field : fields){
+            this->readData.push_back(field & 0xFF);
+            this->readData.push_back(field >> 8);
+        }
+        return;
+    }
+
+    if (reg == this->config.reportDescriptorRegister){
+        this->readData = this->config.reportDescriptor;
+        return;
+    }
+
+    //Anything else reads the input register
+    this->inputRead = true;
+    UInt64 now = mach_absolute_time();
+    if (this->resetComplete){
+        this->resetComplete = false;
+        this->readData.assign(2, 0);
+    } else if (this->desyncMode != kHIDTargetDesyncNone){
+        //A length the host can't trust, followed by what looks like the middle of a report
+        this->readData.assign(this->config.maxInputLength, 0xA5);
+        this->readData[0] = 0xFF;
+        this->readData[1] = 0xFF;
+        this->stats.garbageReads++;
+        if (this->desyncMode == kHIDTargetDesyncReads && --this->desyncReads == 0)
+            this->desyncMode = kHIDTargetDesyncNone;
+    } else if (!this->awake || now < this->wokeAt + this->config.wakeLatchNs || this->reports.empty()){
+        this->readData.assign(2, 0);
+        this->stats.emptyReads++;
+    } else {
+        this->readData = this->reports.front();
+        this->reports.pop_front();
+        this->stats.read++;
+    }
+}
+
+void HIDTarget::finishWrite(){
+    std::vector<UInt8> bytes;
+    bytes.swap(this->written);
+    if (bytes.size() < 2)
+        return;
+
+    UInt16 reg = bytes[0] | bytes[1] << 8;
+    if (bytes.size() == 2){
+        //Just the register, for the read that follows
+        this->pointer = reg;
+        this->pointerSet = true;
+        return;
+    }
+
+    if (reg == this->config.outputRegister){
+        this->stats.outputReports++;
+        return;
+    }
+
+    if (reg != this->config.commandRegister || bytes.size() < 4)
+        return;
+
+    UInt8 reportTypeID = bytes[2];
+    UInt8 opcode = bytes[3] & 0x0F;
+    if (opcode == kHIDOpcodeSetPower){
+        if ((reportTypeID & 0x03) == kHIDPowerSleep){
+            if (this->awake)
+                this->stats.sleeps++;
+            this->awake = false;
+            if (this->desyncMode == kHIDTargetDesyncUntilPowerCycle)
+                this->desyncMode = kHIDTargetDesyncNone;
+        } else if (!this->awake){
+            this->awake = true;
+            this->wokeAt = mach_absolute_time();
+            this->stats.wakes++;
+        }
+        return;
+    }
+
+    if (opcode == kHIDOpcodeReset){
+        this->stats.resets++;
+        this->reports.clear();
+        this->resetComplete = false;
+        this->awake = true;
+        if (this->desyncMode == kHIDTargetDesyncUntilPowerCycle || this->desyncMode == kHIDTargetDesyncUntilReset)
+            this->desyncMode = kHIDTargetDesyncNone;
+        updateInterrupt();
+
+        UInt64 generation = ++this->resetGeneration;
+        HostSimulationAt(mach_absolute_time() + this->config.resetLatencyNs, [this, generation]{
+            if (generation != this->resetGeneration)
+                return;
+            this->resetComplete = true;
+            updateInterrupt();
+        });
+        return;
+    }
+
+    if (opcode == kHIDOpcodeSetReport){
+        //Report IDs of 15 and up follow the opcode, then the data register and the length
+        size_t index = 4;
+        UInt8 reportID = reportTypeID & 0x0F;
+        if (reportID == 0x0F && bytes.size() > index)
+            reportID = bytes[index++];
+        index += 2;
+        if (bytes.size() < index + 2)
+            return;
+        UInt16 length = bytes[index] | bytes[index + 1] << 8;
+        index += 2;
+        if (reportTypeID & 0x0F){
+            //The length covers itself and the report ID byte
+            index++;
+            length = length >= 3 ? length - 3 : 0;
+        } else {
+            length = length >= 2 ? length - 2 : 0;
+        }
+        if (index + length > bytes.size())
+            length = (UInt16)(bytes.size() > index ? bytes.size() - index : 0);
+
+        UInt8 reportType = (reportTypeID >> 4) & 0x03;
+        if (reportType == kHIDReportTypeFeature){
+            this->features[reportID] = std::vector<UInt8>(bytes.begin() + index, bytes.begin() + index + length);
+            this->stats.featureReports++;
+        } else if (reportType == kHIDReportTypeOutput){
+            this->stats.outputReports++;
+        }
+    }
+}
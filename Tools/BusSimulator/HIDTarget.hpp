@@ -0,0 +1,129 @@
+//
+//  HIDTarget.hpp
+//  VoodooI2CHID
+//
+//  Created on 10/19/26.
+//  Copyright © 2026 VoodooI2C contributors. All rights reserved.
+//
+//  An I2C-HID device as the bus sees it: the HID descriptor and report
+//  descriptor registers, an input register backed by a queue of pending
+//  reports, and the command register handling SET_POWER, RESET and
+//  SET_REPORT. The interrupt line is asserted while a report is pending.
+//  Faults that desynchronize the input register can be injected to walk the
+//  driver through each of its recovery tiers.
+//
+
+#ifndef HIDTarget_hpp
+#define HIDTarget_hpp
+
+#include "DesignWareBus.hpp"
+
+struct HIDTargetConfig {
+    UInt16 vendorID = 0x1234;
+    UInt16 productID = 0x5678;
+    UInt16 versionID = 0x0100;
+    std::vector<UInt8> reportDescriptor;
+    UInt16 maxInputLength = 64;
+    UInt16 maxOutputLength = 64;
+
+    UInt16 descriptorRegister = 0x0001;
+    UInt16 reportDescriptorRegister = 0x0002;
+    UInt16 inputRegister = 0x0003;
+    UInt16 outputRegister = 0x0004;
+    UInt16 commandRegister = 0x0005;
+    UInt16 dataRegister = 0x0006;
+
+    //From the RESET command to the empty report and interrupt that end it
+    UInt64 resetLatencyNs = 1000000;
+    //After SET_POWER(ON), input reads come back empty until the pending report is latched
+    UInt64 wakeLatchNs = 0;
+    //Clock stretch before the first byte of an input report
+    UInt64 inputStretchNs = 0;
+    //Reports the device buffers before dropping the oldest
+    unsigned int queueDepth = 8;
+};
+
+enum HIDTargetDesync {
+    kHIDTargetDesyncNone,
+    //The next reads of the input register return garbage
+    kHIDTargetDesyncReads,
+    //Garbage until the device is put to sleep and woken
+    kHIDTargetDesyncUntilPowerCycle,
+    //Garbage until the device is reset
+    kHIDTargetDesyncUntilReset,
+    kHIDTargetDesyncForever
+};
+
+struct HIDTargetStats {
+    UInt64 queued = 0;
+    UInt64 read = 0;
+    UInt64 dropped = 0;
+    UInt64 truncated = 0;
+    UInt64 emptyReads = 0;
+    UInt64 garbageReads = 0;
+    UInt64 resets = 0;
+    UInt64 sleeps = 0;
+    UInt64 wakes = 0;
+    UInt64 outputReports = 0;
+    UInt64 featureReports = 0;
+};
+
+class HIDTarget : public I2CTarget {
+public:
+    HIDTarget(const HIDTargetConfig &config);
+
+    //Drives the interrupt line, asserted while a report is pending
+    std::function<void(bool asserted)> interruptLine;
+
+    //Queues an input report, report ID included when the descriptor uses them
+    void queueReport(const std::vector<UInt8> &report);
+
+    //Queues count reports period apart starting at start, made by generate(i)
+    void streamReports(UInt64 start, UInt64 period, unsigned int count, std::function<std::vector<UInt8>(unsigned int)> generate);
+
+    void desync(HIDTargetDesync mode, unsigned int reads = 1);
+
+    bool isAwake() const { return this->awake; }
+    size_t pendingReports() const { return this->reports.size(); }
+
+    //Last feature report written with SET_REPORT for reportID, without the ID
+    std::vector<UInt8> feature(UInt8 reportID) const;
+
+    HIDTargetStats stats;
+
+    bool select(bool read) override;
+    bool write(UInt8 byte) override;
+    UInt8 read() override;
+    void stop() override;
+    UInt64 stretchNs() override;
+
+private:
+    HIDTargetConfig config;
+    std::deque<std::vector<UInt8>> reports;
+    std::map<UInt8, std::vector<UInt8>> features;
+
+    bool awake;
+    UInt64 wokeAt;
+    UInt64 resetGeneration;
+    bool resetComplete;
+    bool lineAsserted;
+
+    HIDTargetDesync desyncMode;
+    unsigned int desyncReads;
+
+    //Current transaction
+    std::vector<UInt8> written;
+    bool reading;
+    std::vector<UInt8> readData;
+    size_t readIndex;
+    bool inputRead;
+    bool pointerSet;
+    UInt16 pointer;
+
+    void finishWrite();
+    void command(UInt8 opcode, UInt8 reportTypeID);
+    void beginRead();
+    void updateInterrupt();
+};
+
+#endif /* HIDTarget_hpp */
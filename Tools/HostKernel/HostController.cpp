@@ -0,0 +1,64 @@
+//
+//  HostController.cpp
+//  VoodooI2CHID
+//
+//  Created on 10/19/26.
+//  Copyright © 2026 VoodooI2C contributors. All rights reserved.
+//
+
+#include "HostController.hpp"
+
+#include <mutex>
+
+OSDefineMetaClassAndStructors(VoodooI2CControllerDriver, IOService);
+
+static std::mutex busesLock;
+static std::map<VoodooI2CControllerDriver *, HostBus *> buses;
+
+VoodooI2CControllerDriver *HostControllerCreate(HostBus *bus){
+    VoodooI2CControllerDriver *controller = new VoodooI2CControllerDriver;
+    controller->init(NULL);
+    controller->setName("VoodooI2CControllerDriver");
+
+    std::lock_guard<std::mutex> guard(busesLock);
+    buses[controller] = bus;
+    return controller;
+}
+
+IOReturn VoodooI2CControllerDriver::transferI2C(VoodooI2CControllerBusMessage *messages, int number){
+    HostBus *bus;
+    {
+        std::lock_guard<std::mutex> guard(busesLock);
+        std::map<VoodooI2CControllerDriver *, HostBus *>::iterator found = buses.find(this);
+        bus = found == buses.end() ? NULL : found->second;
+    }
+    return bus ? bus->transfer(this, messages, number) : kIOReturnNoDevice;
+}
+
+bool VoodooI2CControllerDriver::init(OSDictionary *properties){
+    this->bus_device = NULL;
+    return IOService::init(properties);
+}
+
+void VoodooI2CControllerDriver::free(){
+    {
+        std::lock_guard<std::mutex> guard(busesLock);
+        buses.erase(this);
+    }
+    IOService::free();
+}
+
+VoodooI2CControllerDriver *VoodooI2CControllerDriver::probe(IOService *provider, SInt32 *score){
+    return this;
+}
+
+bool VoodooI2CControllerDriver::start(IOService *provider){
+    return true;
+}
+
+void VoodooI2CControllerDriver::stop(IOService *provider){
+}
+
+IOReturn VoodooI2CControllerDriver::setPowerState(unsigned long whichState, IOService *whatDevice){
+    return kIOPMAckImplied;
+}
@@ -0,0 +1,27 @@
+//
+//  HostController.hpp
+//  VoodooI2CHID
+//
+//  Created on 10/19/26.
+//  Copyright © 2026 VoodooI2C contributors. All rights reserved.
+//
+//  Stands in for the VoodooI2C controller kext. The driver calls
+//  VoodooI2CControllerDriver::transferI2C as usual; each controller instance
+//  forwards its transfers to whatever HostBus has been attached to it.
+//
+
+#ifndef HostController_hpp
+#define HostController_hpp
+
+#include "VoodooI2CControllerDriver.hpp"
+
+class HostBus {
+public:
+    virtual ~HostBus() {}
+    virtual IOReturn transfer(VoodooI2CControllerDriver *controller, VoodooI2CControllerBusMessage *messages, int number) = 0;
+};
+
+//Creates a controller whose transfers go to bus
+VoodooI2CControllerDriver *HostControllerCreate(HostBus *bus);
+
+#endif /* HostController_hpp */
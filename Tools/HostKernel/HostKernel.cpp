@@ -0,0 +1,803 @@
+//
+//  HostKernel.cpp
+//  VoodooI2CHID
+//
+//  Created on 10/19/26.
+//  Copyright © 2026 VoodooI2C contributors. All rights reserved.
+//
+
+#include "HostKernel.hpp"
+
+#include <pthread.h>
+#include <time.h>
+#include <ucontext.h>
+#include <unistd.h>
+
+#include <queue>
+
+// libkern
+
+void OSObject::release() const {
+    if (--this->retainCount == 0)
+        const_cast<OSObject *>(this)->free();
+}
+
+OSNumber *OSNumber::withNumber(unsigned long long value, unsigned int numberOfBits){
+    OSNumber *number = new OSNumber;
+    number->value = numberOfBits < 64 ? value & ((1ULL << numberOfBits) - 1) : value;
+    return number;
+}
+
+static OSBoolean booleanTrue(true);
+static OSBoolean booleanFalse(false);
+OSBoolean *const kOSBooleanTrue = &booleanTrue;
+OSBoolean *const kOSBooleanFalse = &booleanFalse;
+
+OSString *OSString::withCString(const char *string){
+    OSString *object = new OSString;
+    object->string = string;
+    return object;
+}
+
+OSData *OSData::withBytes(const void *bytes, unsigned int length){
+    OSData *data = new OSData;
+    data->appendBytes(bytes, length);
+    return data;
+}
+
+OSData *OSData::withCapacity(unsigned int capacity){
+    OSData *data = new OSData;
+    data->bytes.reserve(capacity);
+    return data;
+}
+
+bool OSData::appendBytes(const void *bytes, unsigned int length){
+    const UInt8 *start = (const UInt8 *)bytes;
+    this->bytes.insert(this->bytes.end(), start, start + length);
+    return true;
+}
+
+OSArray *OSArray::withCapacity(unsigned int capacity){
+    OSArray *array = new OSArray;
+    array->objects.reserve(capacity);
+    return array;
+}
+
+bool OSArray::setObject(const OSObject *object){
+    if (!object)
+        return false;
+    object->retain();
+    this->objects.push_back(const_cast<OSObject *>(object));
+    return true;
+}
+
+void OSArray::free(){
+    for (OSObject *object : this->objects)
+        object->release();
+    this->objects.clear();
+    OSCollection::free();
+}
+
+OSDictionary *OSDictionary::withCapacity(unsigned int capacity){
+    return new OSDictionary;
+}
+
+bool OSDictionary::setObject(const char *key, const OSObject *object){
+    if (!key || !object)
+        return false;
+    object->retain();
+    removeObject(key);
+    this->objects[key] = const_cast<OSObject *>(object);
+    return true;
+}
+
+OSObject *OSDictionary::getObject(const char *key) const {
+    std::map<std::string, OSObject *>::const_iterator found = this->objects.find(key);
+    return found == this->objects.end() ? NULL : found->second;
+}
+
+void OSDictionary::removeObject(const char *key){
+    std::map<std::string, OSObject *>::iterator found = this->objects.find(key);
+    if (found == this->objects.end())
+        return;
+    found->second->release();
+    this->objects.erase(found);
+}
+
+void OSDictionary::free(){
+    for (auto &entry : this->objects)
+        entry.second->release();
+    this->objects.clear();
+    OSCollection::free();
+}
+
+bool OSCompareAndSwap(UInt32 oldValue, UInt32 newValue, volatile UInt32 *address){
+    return __sync_bool_compare_and_swap(address, oldValue, newValue);
+}
+
+bool OSCompareAndSwap64(UInt64 oldValue, UInt64 newValue, volatile UInt64 *address){
+    return __sync_bool_compare_and_swap(address, oldValue, newValue);
+}
+
+bool OSCompareAndSwapPtr(void *oldValue, void *newValue, void * volatile *address){
+    return __sync_bool_compare_and_swap(address, oldValue, newValue);
+}
+
+SInt32 OSIncrementAtomic(volatile SInt32 *address){
+    return __sync_fetch_and_add(address, 1);
+}
+
+SInt32 OSDecrementAtomic(volatile SInt32 *address){
+    return __sync_fetch_and_sub(address, 1);
+}
+
+SInt32 OSAddAtomic(SInt32 amount, volatile SInt32 *address){
+    return __sync_fetch_and_add(address, amount);
+}
+
+SInt64 OSIncrementAtomic64(volatile SInt64 *address){
+    return __sync_fetch_and_add(address, 1);
+}
+
+SInt64 OSAddAtomic64(SInt64 amount, volatile SInt64 *address){
+    return __sync_fetch_and_add(address, amount);
+}
+
+void OSMemoryBarrier(){
+    __sync_synchronize();
+}
+
+// Simulation
+
+#define kHostThreadStackSize (512 * 1024)
+
+struct HostThread {
+    ucontext_t context;
+    void *stack;
+    thread_continue_t continuation;
+    void *parameter;
+};
+
+struct HostWakeup {
+    uint64_t when;
+    uint64_t sequence;
+    HostThread *thread;
+    std::function<void()> callback;
+
+    bool operator>(const HostWakeup &other) const {
+        return this->when != other.when ? this->when > other.when : this->sequence > other.sequence;
+    }
+};
+
+static bool simulating = false;
+static uint64_t simulatedNow = 0;
+static uint64_t nextSequence = 0;
+static HostThread mainThread;
+static HostThread *currentThread = NULL;
+static std::vector<HostThread *> finishedThreads;
+static std::priority_queue<HostWakeup, std::vector<HostWakeup>, std::greater<HostWakeup>> timeline;
+
+void HostSimulationStart(){
+    simulating = true;
+    currentThread = &mainThread;
+}
+
+bool HostSimulationActive(){
+    return simulating;
+}
+
+static void makeRunnable(HostThread *thread, uint64_t when){
+    HostWakeup wakeup = { when, nextSequence++, thread, nullptr };
+    timeline.push(wakeup);
+}
+
+void HostSimulationAt(uint64_t when, std::function<void()> callback){
+    HostWakeup wakeup = { when < simulatedNow ? simulatedNow : when, nextSequence++, NULL, callback };
+    timeline.push(wakeup);
+}
+
+static void reapFinishedThreads(){
+    for (HostThread *thread : finishedThreads){
+        free(thread->stack);
+        delete thread;
+    }
+    finishedThreads.clear();
+}
+
+//Gives up the host thread until whatever the caller arranged makes it runnable again
+static void blockCurrentThread(){
+    HostThread *self = currentThread;
+    for (;;){
+        if (timeline.empty()){
+            fprintf(stderr, "HostKernel: every simulated thread is blocked at %llu ns\n", (unsigned long long)simulatedNow);
+            abort();
+        }
+
+        HostWakeup wakeup = timeline.top();
+        timeline.pop();
+        if (wakeup.when > simulatedNow)
+            simulatedNow = wakeup.when;
+
+        if (!wakeup.thread){
+            wakeup.callback();
+            continue;
+        }
+        if (wakeup.thread == self)
+            return;
+
+        currentThread = wakeup.thread;
+        swapcontext(&self->context, &wakeup.thread->context);
+        //Switched back by whichever thread picked our wakeup
+        currentThread = self;
+        reapFinishedThreads();
+        return;
+    }
+}
+
+void HostSimulationWait(uint64_t ns){
+    makeRunnable(currentThread, simulatedNow + ns);
+    blockCurrentThread();
+}
+
+static void runSimulatedThread(){
+    HostThread *thread = currentThread;
+    reapFinishedThreads();
+    thread->continuation(thread->parameter, THREAD_AWAKENED);
+
+    //Freed by the next thread to run, it can't free the stack it's running on
+    finishedThreads.push_back(thread);
+    blockCurrentThread();
+}
+
+static HostThread *createSimulatedThread(thread_continue_t continuation, void *parameter){
+    HostThread *thread = new HostThread;
+    thread->stack = malloc(kHostThreadStackSize);
+    thread->continuation = continuation;
+    thread->parameter = parameter;
+    getcontext(&thread->context);
+    thread->context.uc_stack.ss_sp = thread->stack;
+    thread->context.uc_stack.ss_size = kHostThreadStackSize;
+    thread->context.uc_link = NULL;
+    makecontext(&thread->context, runSimulatedThread, 0);
+    makeRunnable(thread, simulatedNow);
+    return thread;
+}
+
+// Mach
+
+task_t kernel_task = NULL;
+
+uint64_t mach_absolute_time(){
+    if (simulating)
+        return simulatedNow;
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
+
+void absolutetime_to_nanoseconds(uint64_t absoluteTime, uint64_t *result){
+    *result = absoluteTime;
+}
+
+void nanoseconds_to_absolutetime(uint64_t nanoseconds, uint64_t *result){
+    *result = nanoseconds;
+}
+
+void clock_get_uptime(uint64_t *result){
+    *result = mach_absolute_time();
+}
+
+struct HostThreadStart {
+    thread_continue_t continuation;
+    void *parameter;
+};
+
+static void *runThread(void *context){
+    HostThreadStart start = *(HostThreadStart *)context;
+    delete (HostThreadStart *)context;
+    start.continuation(start.parameter, THREAD_AWAKENED);
+    return NULL;
+}
+
+kern_return_t kernel_thread_start(thread_continue_t continuation, void *parameter, thread_t *newThread){
+    if (simulating){
+        *newThread = createSimulatedThread(continuation, parameter);
+        return KERN_SUCCESS;
+    }
+
+    HostThreadStart *start = new HostThreadStart;
+    start->continuation = continuation;
+    start->parameter = parameter;
+
+    pthread_t thread;
+    if (pthread_create(&thread, NULL, runThread, start) != 0){
+        delete start;
+        return KERN_FAILURE;
+    }
+    pthread_detach(thread);
+    *newThread = NULL;
+    return KERN_SUCCESS;
+}
+
+void thread_deallocate(thread_t thread){
+}
+
+// IOKit
+
+void IOLog(const char *format, ...){
+    static const bool verbose = getenv("HOSTKERNEL_LOG") != NULL;
+    if (!verbose)
+        return;
+    va_list arguments;
+    va_start(arguments, format);
+    vfprintf(stderr, format, arguments);
+    va_end(arguments);
+}
+
+void *IOMalloc(vm_size_t size){
+    return malloc(size);
+}
+
+void IOFree(void *address, vm_size_t size){
+    free(address);
+}
+
+void IOSleep(unsigned int milliseconds){
+    if (simulating)
+        HostSimulationWait(milliseconds * 1000000ULL);
+    else
+        usleep(milliseconds * 1000);
+}
+
+//Spins in the kernel; simulated time has no CPU cost, so here it just passes
+void IODelay(unsigned int microseconds){
+    if (simulating){
+        HostSimulationWait(microseconds * 1000ULL);
+        return;
+    }
+    uint64_t until = mach_absolute_time() + microseconds * 1000ULL;
+    while (mach_absolute_time() < until){}
+}
+
+//Host threads share one condition per lock and recheck their predicate, as the kernel allows.
+//Simulated threads queue for ownership and sleep per event.
+struct HostLock {
+    pthread_mutex_t mutex;
+    pthread_cond_t wakeup;
+
+    HostThread *owner;
+    std::deque<HostThread *> waiting;
+    std::vector<std::pair<HostThread *, void *>> sleeping;
+};
+
+IOLock *IOLockAlloc(){
+    IOLock *lock = new IOLock;
+    pthread_mutex_init(&lock->mutex, NULL);
+    pthread_cond_init(&lock->wakeup, NULL);
+    lock->owner = NULL;
+    return lock;
+}
+
+void IOLockFree(IOLock *lock){
+    pthread_cond_destroy(&lock->wakeup);
+    pthread_mutex_destroy(&lock->mutex);
+    delete lock;
+}
+
+void IOLockLock(IOLock *lock){
+    if (!simulating){
+        pthread_mutex_lock(&lock->mutex);
+        return;
+    }
+    if (!lock->owner){
+        lock->owner = currentThread;
+        return;
+    }
+    //Ownership is handed over by IOLockUnlock
+    lock->waiting.push_back(currentThread);
+    blockCurrentThread();
+}
+
+void IOLockUnlock(IOLock *lock){
+    if (!simulating){
+        pthread_mutex_unlock(&lock->mutex);
+        return;
+    }
+    if (lock->waiting.empty()){
+        lock->owner = NULL;
+        return;
+    }
+    lock->owner = lock->waiting.front();
+    lock->waiting.pop_front();
+    makeRunnable(lock->owner, simulatedNow);
+}
+
+int IOLockSleep(IOLock *lock, void *event, UInt32 interruptible){
+    if (!simulating){
+        pthread_cond_wait(&lock->wakeup, &lock->mutex);
+        return THREAD_AWAKENED;
+    }
+    lock->sleeping.push_back(std::make_pair(currentThread, event));
+    IOLockUnlock(lock);
+    blockCurrentThread();
+    IOLockLock(lock);
+    return THREAD_AWAKENED;
+}
+
+void IOLockWakeup(IOLock *lock, void *event, bool oneThread){
+    if (!simulating){
+        pthread_cond_broadcast(&lock->wakeup);
+        return;
+    }
+    for (size_t i = 0; i < lock->sleeping.size();){
+        if (lock->sleeping[i].second != event){
+            i++;
+            continue;
+        }
+        makeRunnable(lock->sleeping[i].first, simulatedNow);
+        lock->sleeping.erase(lock->sleeping.begin() + i);
+        if (oneThread)
+            break;
+    }
+}
+
+IOSimpleLock *IOSimpleLockAlloc(){
+    return IOLockAlloc();
+}
+
+void IOSimpleLockFree(IOSimpleLock *lock){
+    IOLockFree(lock);
+}
+
+void IOSimpleLockLock(IOSimpleLock *lock){
+    IOLockLock(lock);
+}
+
+void IOSimpleLockUnlock(IOSimpleLock *lock){
+    IOLockUnlock(lock);
+}
+
+bool IORegistryEntry::init(OSDictionary *dictionary){
+    this->properties = OSDictionary::withCapacity(16);
+    return true;
+}
+
+void IORegistryEntry::free(){
+    OSSafeReleaseNULL(this->properties);
+    OSObject::free();
+}
+
+bool IORegistryEntry::setProperty(const char *key, OSObject *object){
+    if (!this->properties)
+        this->properties = OSDictionary::withCapacity(16);
+    return this->properties->setObject(key, object);
+}
+
+bool IORegistryEntry::setProperty(const char *key, unsigned long long value, unsigned int numberOfBits){
+    OSNumber *number = OSNumber::withNumber(value, numberOfBits);
+    bool result = setProperty(key, number);
+    number->release();
+    return result;
+}
+
+bool IORegistryEntry::setProperty(const char *key, const char *string){
+    OSString *object = OSString::withCString(string);
+    bool result = setProperty(key, object);
+    object->release();
+    return result;
+}
+
+bool IORegistryEntry::setProperty(const char *key, bool value){
+    return setProperty(key, value ? kOSBooleanTrue : kOSBooleanFalse);
+}
+
+OSObject *IORegistryEntry::getProperty(const char *key) const {
+    return this->properties ? this->properties->getObject(key) : NULL;
+}
+
+void IORegistryEntry::removeProperty(const char *key){
+    if (this->properties)
+        this->properties->removeObject(key);
+}
+
+const char *IORegistryEntry::getName() const {
+    return this->name.empty() ? "IORegistryEntry" : this->name.c_str();
+}
+
+void IORegistryEntry::setName(const char *name){
+    this->name = name;
+}
+
+IOReturn IOService::callPlatformFunction(const char *functionName, bool waitForFunction, void *param1, void *param2, void *param3, void *param4){
+    return kIOReturnUnsupported;
+}
+
+bool IOService::attach(IOService *provider){
+    this->provider = provider;
+    return true;
+}
+
+void IOService::detach(IOService *provider){
+    if (this->provider == provider)
+        this->provider = NULL;
+}
+
+bool IOService::terminate(IOOptionBits options){
+    stop(this->provider);
+    detach(this->provider);
+    return true;
+}
+
+//Every service shares the one workloop, as if they all hung off the same controller
+IOWorkLoop *IOService::getWorkLoop() const {
+    static IOWorkLoop *shared = IOWorkLoop::workLoop();
+    return shared;
+}
+
+IOWorkLoop *IOWorkLoop::workLoop(){
+    IOWorkLoop *workLoop = new IOWorkLoop;
+    workLoop->idle = false;
+    workLoop->thread = simulating ? createSimulatedThread(run, workLoop) : NULL;
+    return workLoop;
+}
+
+void IOWorkLoop::run(void *context, int waitResult){
+    IOWorkLoop *workLoop = (IOWorkLoop *)context;
+    for (;;){
+        while (workLoop->pending.empty()){
+            workLoop->idle = true;
+            blockCurrentThread();
+        }
+        IOEventSource *source = workLoop->pending.front();
+        workLoop->pending.pop_front();
+        source->pending = false;
+        if (source->workLoop == workLoop && source->enabled)
+            source->fire();
+        source->release();
+    }
+}
+
+void IOWorkLoop::signal(IOEventSource *source){
+    if (source->pending || !this->thread)
+        return;
+    source->retain();
+    source->pending = true;
+    this->pending.push_back(source);
+    if (this->idle){
+        this->idle = false;
+        makeRunnable(this->thread, simulatedNow);
+    }
+}
+
+IOReturn IOWorkLoop::addEventSource(IOEventSource *source){
+    source->retain();
+    source->workLoop = this;
+    return kIOReturnSuccess;
+}
+
+IOReturn IOWorkLoop::removeEventSource(IOEventSource *source){
+    if (source->workLoop != this)
+        return kIOReturnNotFound;
+    source->workLoop = NULL;
+    source->release();
+    return kIOReturnSuccess;
+}
+
+void IOEventSource::enable(){
+    this->enabled = true;
+}
+
+void IOEventSource::disable(){
+    this->enabled = false;
+}
+
+IOTimerEventSource *IOTimerEventSource::timerEventSource(OSObject *owner, Action action){
+    IOTimerEventSource *source = new IOTimerEventSource;
+    source->owner = owner;
+    source->action = action;
+    source->enabled = true;
+    return source;
+}
+
+IOReturn IOTimerEventSource::setTimeout(UInt32 interval, UInt32 scaleFactor){
+    if (!simulating){
+        fprintf(stderr, "HostKernel: timer event sources need HostSimulationStart()\n");
+        abort();
+    }
+    //Rearming replaces the previous timeout, like the kernel's
+    UInt64 generation = ++this->generation;
+    retain();
+    HostSimulationAt(simulatedNow + (uint64_t)interval * scaleFactor, [this, generation]{
+        if (generation == this->generation && this->workLoop)
+            this->workLoop->signal(this);
+        release();
+    });
+    return kIOReturnSuccess;
+}
+
+IOReturn IOTimerEventSource::setTimeoutMS(UInt32 milliseconds){
+    return setTimeout(milliseconds, kMillisecondScale);
+}
+
+IOReturn IOTimerEventSource::setTimeoutUS(UInt32 microseconds){
+    return setTimeout(microseconds, kMicrosecondScale);
+}
+
+void IOTimerEventSource::cancelTimeout(){
+    this->generation++;
+}
+
+void IOTimerEventSource::fire(){
+    if (this->action)
+        this->action(this->owner, this);
+}
+
+struct HostInterruptLine {
+    IOService *provider;
+    int intIndex;
+    bool asserted;
+    IOInterruptEventSource *source;
+};
+
+static std::vector<HostInterruptLine> interruptLines;
+
+static HostInterruptLine *findInterruptLine(IOService *provider, int intIndex, bool create){
+    for (HostInterruptLine &line : interruptLines){
+        if (line.provider == provider && line.intIndex == intIndex)
+            return &line;
+    }
+    if (!create)
+        return NULL;
+    HostInterruptLine line = { provider, intIndex, false, NULL };
+    interruptLines.push_back(line);
+    return &interruptLines.back();
+}
+
+IOInterruptEventSource *IOInterruptEventSource::interruptEventSource(OSObject *owner, IOInterruptEventAction action, IOService *provider, int intIndex){
+    if (!simulating){
+        fprintf(stderr, "HostKernel: interrupt event sources need HostSimulationStart()\n");
+        abort();
+    }
+    IOInterruptEventSource *source = new IOInterruptEventSource;
+    source->owner = owner;
+    source->action = action;
+    source->provider = provider;
+    source->intIndex = intIndex;
+    source->enabled = false;
+    findInterruptLine(provider, intIndex, true)->source = source;
+    return source;
+}
+
+void IOInterruptEventSource::free(){
+    HostInterruptLine *line = findInterruptLine(this->provider, this->intIndex, false);
+    if (line && line->source == this)
+        line->source = NULL;
+    IOEventSource::free();
+}
+
+void IOInterruptEventSource::enable(){
+    IOEventSource::enable();
+    update();
+}
+
+void IOInterruptEventSource::update(){
+    HostInterruptLine *line = findInterruptLine(this->provider, this->intIndex, false);
+    if (line && line->asserted && this->enabled && this->workLoop)
+        this->workLoop->signal(this);
+}
+
+void IOInterruptEventSource::fire(){
+    this->action(this->owner, this, 1);
+
+    //Still asserted, the controller raises it again once the interrupt is unmasked
+    HostInterruptLine *line = findInterruptLine(this->provider, this->intIndex, false);
+    if (!line || !line->asserted || this->refireScheduled)
+        return;
+    this->refireScheduled = true;
+    retain();
+    HostSimulationAt(simulatedNow + kHostInterruptRefireNs, [this]{
+        this->refireScheduled = false;
+        update();
+        release();
+    });
+}
+
+void HostInterruptSetLevel(IOService *provider, int intIndex, bool asserted){
+    HostInterruptLine *line = findInterruptLine(provider, intIndex, true);
+    bool raised = asserted && !line->asserted;
+    line->asserted = asserted;
+    if (raised && line->source)
+        line->source->update();
+}
+
+IOByteCount IOMemoryDescriptor::readBytes(IOByteCount offset, void *bytes, IOByteCount length) const {
+    if (offset >= this->length)
+        return 0;
+    if (length > this->length - offset)
+        length = this->length - offset;
+    memcpy(bytes, this->bytes.data() + offset, length);
+    return length;
+}
+
+IOByteCount IOMemoryDescriptor::writeBytes(IOByteCount offset, const void *bytes, IOByteCount length){
+    if (offset >= this->length)
+        return 0;
+    if (length > this->length - offset)
+        length = this->length - offset;
+    memcpy(this->bytes.data() + offset, bytes, length);
+    return length;
+}
+
+IOBufferMemoryDescriptor *IOBufferMemoryDescriptor::inTaskWithOptions(task_t inTask, IOOptionBits options, vm_size_t capacity, vm_offset_t alignment){
+    IOBufferMemoryDescriptor *descriptor = new IOBufferMemoryDescriptor;
+    descriptor->bytes.assign(capacity, 0);
+    descriptor->length = capacity;
+    return descriptor;
+}
+
+IOBufferMemoryDescriptor *IOBufferMemoryDescriptor::withBytes(const void *bytes, vm_size_t length, IODirection direction){
+    IOBufferMemoryDescriptor *descriptor = inTaskWithOptions(kernel_task, direction, length);
+    descriptor->writeBytes(0, bytes, length);
+    return descriptor;
+}
+
+void IOBufferMemoryDescriptor::setLength(vm_size_t length){
+    if (length <= this->bytes.size())
+        this->length = length;
+}
+
+bool IOACPIPlatformDevice::init(OSDictionary *dictionary){
+    this->objects = OSDictionary::withCapacity(4);
+    return IOService::init(dictionary);
+}
+
+void IOACPIPlatformDevice::free(){
+    OSSafeReleaseNULL(this->objects);
+    IOService::free();
+}
+
+IOReturn IOACPIPlatformDevice::evaluateObject(const char *objectName, OSObject **result, OSObject *params[], IOItemCount paramCount, IOOptionBits options){
+    OSObject *object = this->objects ? this->objects->getObject(objectName) : NULL;
+    if (!object)
+        return kIOReturnNotFound;
+    if (result){
+        object->retain();
+        *result = object;
+    }
+    return kIOReturnSuccess;
+}
+
+void IOACPIPlatformDevice::setObject(const char *objectName, OSObject *value){
+    this->objects->setObject(objectName, value);
+}
+
+// HID
+
+static HostHIDReportHandler reportHandler;
+
+void HostHIDSetReportHandler(HostHIDReportHandler handler){
+    reportHandler = handler;
+}
+
+bool IOHIDDevice::start(IOService *provider){
+    //The HID stack parses the descriptor as soon as the device starts
+    IOMemoryDescriptor *descriptor = NULL;
+    if (newReportDescriptor(&descriptor) != kIOReturnSuccess || !descriptor)
+        return false;
+    descriptor->release();
+    return IOService::start(provider);
+}
+
+IOReturn IOHIDDevice::handleReport(IOMemoryDescriptor *report, IOHIDReportType reportType, IOOptionBits options){
+    return handleReportWithTime(mach_absolute_time(), report, reportType, options);
+}
+
+IOReturn IOHIDDevice::handleReportWithTime(AbsoluteTime timeStamp, IOMemoryDescriptor *report, IOHIDReportType reportType, IOOptionBits options){
+    if (!report)
+        return kIOReturnBadArgument;
+    std::vector<UInt8> bytes(report->getLength());
+    report->readBytes(0, bytes.data(), bytes.size());
+    if (reportHandler)
+        reportHandler(this, timeStamp, bytes.data(), (UInt32)bytes.size());
+    return kIOReturnSuccess;
+}
@@ -0,0 +1,509 @@
+//
+//  HostKernel.hpp
+//  VoodooI2CHID
+//
+//  Created on 10/19/26.
+//  Copyright © 2026 VoodooI2C contributors. All rights reserved.
+//
+//  User-space stand-in for the parts of libkern, IOKit and the Mach kernel
+//  interfaces the VoodooI2CHID sources use, so the driver's own code can be
+//  built and exercised on Linux. Only the behaviour the driver relies on is
+//  implemented: reference counted OS containers, IOLock sleep/wakeup, the
+//  atomic and clock KPIs, kernel threads, a registry property table, workloop
+//  event sources and the IOHIDDevice report path.
+//
+//  By default kernel threads are host threads and time is the host's
+//  monotonic clock. Device-level runs call HostSimulationStart() first, which
+//  turns the shim into a discrete-event simulation: kernel threads, the
+//  workloop and the caller become coroutines on one host thread, and time
+//  only advances when every one of them is blocked. Sleeps, delays, lock
+//  waits and simulated bus transfers then take exactly the simulated time
+//  asked for, so runs are deterministic and independent of host load.
+//  Timer and interrupt event sources need the simulation.
+//
+//  The header stubs under include/ map the kernel include paths here.
+//
+
+#ifndef HostKernel_hpp
+#define HostKernel_hpp
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <strings.h>
+
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+typedef uint8_t UInt8;
+typedef uint16_t UInt16;
+typedef uint32_t UInt32;
+typedef uint64_t UInt64;
+typedef int8_t SInt8;
+typedef int16_t SInt16;
+typedef int32_t SInt32;
+typedef int64_t SInt64;
+typedef unsigned int UInt;
+
+typedef int kern_return_t;
+typedef kern_return_t IOReturn;
+typedef UInt32 IOOptionBits;
+typedef uint64_t IOByteCount;
+typedef size_t vm_size_t;
+typedef uint64_t AbsoluteTime;
+typedef UInt32 IODirection;
+typedef UInt32 IOItemCount;
+typedef uintptr_t vm_offset_t;
+
+#define KERN_SUCCESS 0
+#define KERN_FAILURE 5
+
+#define kIOReturnSuccess         0
+#define kIOReturnError           ((IOReturn)0xe00002bc)
+#define kIOReturnNoMemory        ((IOReturn)0xe00002bd)
+#define kIOReturnNoResources     ((IOReturn)0xe00002be)
+#define kIOReturnNoDevice        ((IOReturn)0xe00002c0)
+#define kIOReturnBadArgument     ((IOReturn)0xe00002c2)
+#define kIOReturnUnsupported     ((IOReturn)0xe00002c7)
+#define kIOReturnIOError         ((IOReturn)0xe00002ca)
+#define kIOReturnBusy            ((IOReturn)0xe00002d5)
+#define kIOReturnTimeout         ((IOReturn)0xe00002d6)
+#define kIOReturnNotReady        ((IOReturn)0xe00002d8)
+#define kIOReturnOverrun         ((IOReturn)0xe00002e8)
+#define kIOReturnDeviceError     ((IOReturn)0xe00002e9)
+#define kIOReturnAborted         ((IOReturn)0xe00002eb)
+#define kIOReturnNotResponding   ((IOReturn)0xe00002ed)
+#define kIOReturnNotFound        ((IOReturn)0xe00002f0)
+#define kIOReturnInvalid         ((IOReturn)0x1)
+
+enum {
+    kIODirectionNone = 0,
+    kIODirectionIn = 1,
+    kIODirectionOut = 2
+};
+
+#define THREAD_UNINT 0
+#define THREAD_INTERRUPTIBLE 1
+#define THREAD_AWAKENED 0
+
+// libkern
+
+class OSMetaClass {};
+class OSSerialize;
+
+#define OSDeclareDefaultStructors(className) \
+    public: className(); protected: virtual ~className();
+
+#define OSDefineMetaClassAndStructors(className, superclassName) \
+    className::className() {} className::~className() {}
+
+#define OSDynamicCast(type, inst) (dynamic_cast<type *>(inst))
+
+// GNU C++ can bind a member function to its object and hand back a plain
+// function pointer, which is what the kernel's own implementation relies on
+#pragma GCC diagnostic ignored "-Wpmf-conversions"
+#define OSMemberFunctionCast(cptrtype, self, func) ((cptrtype)((self)->*(func)))
+
+#define OSSafeReleaseNULL(inst) do { if (inst) (inst)->release(); (inst) = NULL; } while (0)
+
+class OSObject {
+public:
+    OSObject() : retainCount(1) {}
+
+    //Kernel allocations of OSObjects come back zeroed and drivers rely on it
+    static void *operator new(size_t size) { return calloc(1, size); }
+    static void operator delete(void *mem) { ::free(mem); }
+
+    virtual bool init() { return true; }
+    virtual void free() { delete this; }
+
+    void retain() const { this->retainCount++; }
+    void release() const;
+    int getRetainCount() const { return this->retainCount; }
+
+    virtual bool serialize(OSSerialize *serializer) const { return true; }
+
+protected:
+    virtual ~OSObject() {}
+
+private:
+    mutable std::atomic<int> retainCount;
+};
+
+class OSSerialize : public OSObject {};
+
+class OSNumber : public OSObject {
+public:
+    static OSNumber *withNumber(unsigned long long value, unsigned int numberOfBits);
+
+    UInt8 unsigned8BitValue() const { return (UInt8)this->value; }
+    UInt16 unsigned16BitValue() const { return (UInt16)this->value; }
+    UInt32 unsigned32BitValue() const { return (UInt32)this->value; }
+    UInt64 unsigned64BitValue() const { return this->value; }
+
+private:
+    UInt64 value;
+};
+
+class OSBoolean : public OSObject {
+public:
+    OSBoolean(bool value) : value(value) {}
+    bool isTrue() const { return this->value; }
+    bool isFalse() const { return !this->value; }
+    virtual void free() override {}
+
+private:
+    bool value;
+};
+
+extern OSBoolean *const kOSBooleanTrue;
+extern OSBoolean *const kOSBooleanFalse;
+
+class OSString : public OSObject {
+public:
+    static OSString *withCString(const char *string);
+    const char *getCStringNoCopy() const { return this->string.c_str(); }
+    bool isEqualTo(const char *other) const { return this->string == other; }
+
+private:
+    std::string string;
+};
+
+class OSData : public OSObject {
+public:
+    static OSData *withBytes(const void *bytes, unsigned int length);
+    static OSData *withCapacity(unsigned int capacity);
+    bool appendBytes(const void *bytes, unsigned int length);
+    const void *getBytesNoCopy() const { return this->bytes.data(); }
+    unsigned int getLength() const { return (unsigned int)this->bytes.size(); }
+
+private:
+    std::vector<UInt8> bytes;
+};
+
+class OSCollection : public OSObject {};
+
+class OSArray : public OSCollection {
+public:
+    static OSArray *withCapacity(unsigned int capacity);
+    bool setObject(const OSObject *object);
+    OSObject *getObject(unsigned int index) const { return index < this->objects.size() ? this->objects[index] : NULL; }
+    unsigned int getCount() const { return (unsigned int)this->objects.size(); }
+    virtual void free() override;
+
+private:
+    std::vector<OSObject *> objects;
+};
+
+class OSDictionary : public OSCollection {
+public:
+    static OSDictionary *withCapacity(unsigned int capacity);
+    bool setObject(const char *key, const OSObject *object);
+    OSObject *getObject(const char *key) const;
+    void removeObject(const char *key);
+    unsigned int getCount() const { return (unsigned int)this->objects.size(); }
+    virtual void free() override;
+
+private:
+    std::map<std::string, OSObject *> objects;
+};
+
+bool OSCompareAndSwap(UInt32 oldValue, UInt32 newValue, volatile UInt32 *address);
+bool OSCompareAndSwap64(UInt64 oldValue, UInt64 newValue, volatile UInt64 *address);
+bool OSCompareAndSwapPtr(void *oldValue, void *newValue, void * volatile *address);
+SInt32 OSIncrementAtomic(volatile SInt32 *address);
+SInt32 OSDecrementAtomic(volatile SInt32 *address);
+SInt32 OSAddAtomic(SInt32 amount, volatile SInt32 *address);
+SInt64 OSIncrementAtomic64(volatile SInt64 *address);
+SInt64 OSAddAtomic64(SInt64 amount, volatile SInt64 *address);
+void OSMemoryBarrier();
+
+// Mach
+
+typedef struct HostThread *thread_t;
+typedef void (*thread_continue_t)(void *parameter, int wait_result);
+typedef struct HostTask *task_t;
+extern task_t kernel_task;
+
+//Absolute time is kept in nanoseconds
+uint64_t mach_absolute_time();
+void absolutetime_to_nanoseconds(uint64_t absoluteTime, uint64_t *result);
+void nanoseconds_to_absolutetime(uint64_t nanoseconds, uint64_t *result);
+void clock_get_uptime(uint64_t *result);
+
+kern_return_t kernel_thread_start(thread_continue_t continuation, void *parameter, thread_t *newThread);
+void thread_deallocate(thread_t thread);
+
+// Simulation
+
+//Switches to simulated time, must be called before any kernel thread, lock or event source is created
+void HostSimulationStart();
+bool HostSimulationActive();
+
+//Blocks the calling thread for ns of simulated time while everything else runs
+void HostSimulationWait(uint64_t ns);
+
+//Runs callback at simulated time when. Callbacks run between threads and must not block;
+//they are for making things happen, like a device raising its interrupt line
+void HostSimulationAt(uint64_t when, std::function<void()> callback);
+
+// IOKit
+
+void IOLog(const char *format, ...) __attribute__((format(printf, 1, 2)));
+void *IOMalloc(vm_size_t size);
+void IOFree(void *address, vm_size_t size);
+void IOSleep(unsigned int milliseconds);
+void IODelay(unsigned int microseconds);
+
+typedef struct HostLock IOLock;
+IOLock *IOLockAlloc();
+void IOLockFree(IOLock *lock);
+void IOLockLock(IOLock *lock);
+void IOLockUnlock(IOLock *lock);
+int IOLockSleep(IOLock *lock, void *event, UInt32 interruptible);
+void IOLockWakeup(IOLock *lock, void *event, bool oneThread);
+
+typedef struct HostLock IOSimpleLock;
+IOSimpleLock *IOSimpleLockAlloc();
+void IOSimpleLockFree(IOSimpleLock *lock);
+void IOSimpleLockLock(IOSimpleLock *lock);
+void IOSimpleLockUnlock(IOSimpleLock *lock);
+
+#define kIOPMPowerOff 0
+#define kIOPMPowerOn 2
+#define kIOPMAckImplied 0
+
+struct IOPMPowerState {
+    unsigned long version;
+    unsigned long capabilityFlags;
+    unsigned long outputPowerCharacter;
+    unsigned long inputPowerRequirement;
+    unsigned long staticPower;
+    unsigned long unbudgetedPower;
+    unsigned long powerToAttain;
+    unsigned long timeToAttain;
+    unsigned long settleUpTime;
+    unsigned long timeToLower;
+    unsigned long settleDownTime;
+    unsigned long powerDomainBudget;
+};
+
+class IOService;
+class IOWorkLoop;
+class IOEventSource;
+class IOInterruptEventSource;
+class IOCommandGate;
+
+class IOMemoryDescriptor : public OSObject {
+public:
+    IOByteCount getLength() const { return this->length; }
+    IOByteCount readBytes(IOByteCount offset, void *bytes, IOByteCount length) const;
+    IOByteCount writeBytes(IOByteCount offset, const void *bytes, IOByteCount length);
+
+protected:
+    std::vector<UInt8> bytes;
+    IOByteCount length;
+};
+
+class IOBufferMemoryDescriptor : public IOMemoryDescriptor {
+public:
+    static IOBufferMemoryDescriptor *inTaskWithOptions(task_t inTask, IOOptionBits options, vm_size_t capacity, vm_offset_t alignment = 1);
+    static IOBufferMemoryDescriptor *withBytes(const void *bytes, vm_size_t length, IODirection direction);
+    void *getBytesNoCopy() { return this->bytes.data(); }
+    void setLength(vm_size_t length);
+};
+
+class IORegistryEntry : public OSObject {
+public:
+    virtual bool init(OSDictionary *dictionary = NULL);
+    virtual void free() override;
+
+    virtual bool setProperty(const char *key, OSObject *object);
+    bool setProperty(const char *key, unsigned long long value, unsigned int numberOfBits);
+    bool setProperty(const char *key, const char *string);
+    bool setProperty(const char *key, bool value);
+    OSObject *getProperty(const char *key) const;
+    void removeProperty(const char *key);
+    virtual bool serializeProperties(OSSerialize *serialize) const { return true; }
+
+    const char *getName() const;
+    void setName(const char *name);
+
+private:
+    OSDictionary *properties;
+    std::string name;
+};
+
+class IOService : public IORegistryEntry {
+public:
+    virtual IOService *probe(IOService *provider, SInt32 *score) { return this; }
+    virtual bool start(IOService *provider) { return true; }
+    virtual void stop(IOService *provider) {}
+    virtual IOReturn setPowerState(unsigned long powerState, IOService *whatDevice) { return kIOPMAckImplied; }
+    virtual IOReturn callPlatformFunction(const char *functionName, bool waitForFunction, void *param1, void *param2, void *param3, void *param4);
+
+    bool attach(IOService *provider);
+    void detach(IOService *provider);
+    bool terminate(IOOptionBits options = 0);
+    IOService *getProvider() const { return this->provider; }
+    void registerService() {}
+
+    void PMinit() {}
+    void PMstop() {}
+    void joinPMtree(IOService *driver) {}
+    IOReturn registerPowerDriver(IOService *controllingDriver, IOPMPowerState *powerStates, unsigned long numberOfStates) { return kIOReturnSuccess; }
+
+    virtual IOWorkLoop *getWorkLoop() const;
+
+private:
+    IOService *provider;
+};
+
+#define kIOServiceRequired 0x00000001
+#define kIOServiceSynchronous 0x00000002
+
+//Runs the actions of its event sources one at a time on its own thread
+class IOWorkLoop : public OSObject {
+public:
+    static IOWorkLoop *workLoop();
+    IOReturn addEventSource(IOEventSource *source);
+    IOReturn removeEventSource(IOEventSource *source);
+
+    //Queues source's action, from timer and interrupt callbacks
+    void signal(IOEventSource *source);
+
+private:
+    struct HostThread *thread;
+    bool idle;
+    std::deque<IOEventSource *> pending;
+
+    static void run(void *workLoop, int waitResult);
+};
+
+class IOEventSource : public OSObject {
+public:
+    virtual void enable();
+    virtual void disable();
+    bool isEnabled() const { return this->enabled; }
+
+protected:
+    friend class IOWorkLoop;
+
+    OSObject *owner;
+    IOWorkLoop *workLoop;
+    bool enabled;
+    bool pending;
+
+    //Runs the action on the workloop
+    virtual void fire() = 0;
+};
+
+class IOTimerEventSource : public IOEventSource {
+public:
+    typedef void (*Action)(OSObject *owner, IOTimerEventSource *sender);
+
+    static IOTimerEventSource *timerEventSource(OSObject *owner, Action action = NULL);
+    IOReturn setTimeoutMS(UInt32 milliseconds);
+    IOReturn setTimeoutUS(UInt32 microseconds);
+    IOReturn setTimeout(UInt32 interval, UInt32 scaleFactor);
+    void cancelTimeout();
+
+protected:
+    virtual void fire() override;
+
+private:
+    Action action;
+    UInt64 generation;
+};
+
+#define kNanosecondScale 1
+#define kMicrosecondScale 1000
+#define kMillisecondScale 1000000
+#define kSecondScale 1000000000
+
+typedef void (*IOInterruptEventAction)(OSObject *owner, IOInterruptEventSource *sender, int count);
+
+//Level triggered: the action keeps being run, kHostInterruptRefireNs apart, for as long as the line stays asserted
+class IOInterruptEventSource : public IOEventSource {
+public:
+    static IOInterruptEventSource *interruptEventSource(OSObject *owner, IOInterruptEventAction action, IOService *provider = NULL, int intIndex = 0);
+    virtual void enable() override;
+    virtual void free() override;
+
+protected:
+    virtual void fire() override;
+
+private:
+    IOInterruptEventAction action;
+    IOService *provider;
+    int intIndex;
+    bool refireScheduled;
+
+    friend void HostInterruptSetLevel(IOService *provider, int intIndex, bool asserted);
+    void update();
+};
+
+#define kHostInterruptRefireNs 50000
+
+//Drives the interrupt line that interrupt sources created against provider and intIndex listen on
+void HostInterruptSetLevel(IOService *provider, int intIndex, bool asserted);
+
+class IOCommandGate : public IOEventSource {
+protected:
+    virtual void fire() override {}
+};
+
+//Objects evaluated by name, set up by whoever builds the device tree
+class IOACPIPlatformDevice : public IOService {
+public:
+    virtual bool init(OSDictionary *dictionary = NULL) override;
+    virtual void free() override;
+
+    IOReturn evaluateObject(const char *objectName, OSObject **result = NULL, OSObject *params[] = NULL, IOItemCount paramCount = 0, IOOptionBits options = 0);
+    void setObject(const char *objectName, OSObject *value);
+
+private:
+    OSDictionary *objects;
+};
+
+// HID
+
+enum {
+    kIOHIDReportTypeInput = 0,
+    kIOHIDReportTypeOutput,
+    kIOHIDReportTypeFeature,
+    kIOHIDReportTypeCount
+};
+typedef UInt32 IOHIDReportType;
+
+class IOHIDDevice : public IOService {
+public:
+    virtual bool start(IOService *provider) override;
+
+    virtual IOReturn newReportDescriptor(IOMemoryDescriptor **descriptor) const = 0;
+    virtual IOReturn setReport(IOMemoryDescriptor *report, IOHIDReportType reportType, IOOptionBits options = 0) { return kIOReturnUnsupported; }
+    virtual OSNumber *newVendorIDNumber() const { return NULL; }
+    virtual OSNumber *newProductIDNumber() const { return NULL; }
+    virtual OSNumber *newVersionNumber() const { return NULL; }
+    virtual OSString *newTransportString() const { return NULL; }
+    virtual OSString *newManufacturerString() const { return NULL; }
+    virtual OSNumber *newPrimaryUsageNumber() const { return NULL; }
+    virtual OSNumber *newPrimaryUsagePageNumber() const { return NULL; }
+
+    IOReturn handleReport(IOMemoryDescriptor *report, IOHIDReportType reportType = kIOHIDReportTypeInput, IOOptionBits options = 0);
+    IOReturn handleReportWithTime(AbsoluteTime timeStamp, IOMemoryDescriptor *report, IOHIDReportType reportType = kIOHIDReportTypeInput, IOOptionBits options = 0);
+};
+
+//Receives every report any IOHIDDevice hands to the HID stack, timeStamp in absolute time
+typedef std::function<void(IOHIDDevice *device, AbsoluteTime timeStamp, const UInt8 *report, UInt32 length)> HostHIDReportHandler;
+void HostHIDSetReportHandler(HostHIDReportHandler handler);
+
+#endif /* HostKernel_hpp */
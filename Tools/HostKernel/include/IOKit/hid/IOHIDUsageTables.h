@@ -0,0 +1,47 @@
+//The usages the driver refers to, with the values from Apple's IOHIDUsageTables.h
+
+#ifndef IOHIDUsageTables_h
+#define IOHIDUsageTables_h
+
+enum {
+    kHIDPage_GenericDesktop = 0x01,
+    kHIDPage_KeyboardOrKeypad = 0x07,
+    kHIDPage_Button = 0x09,
+    kHIDPage_Digitizer = 0x0D,
+    kHIDPage_VendorDefinedStart = 0xFF00
+};
+
+enum {
+    kHIDUsage_GD_Pointer = 0x01,
+    kHIDUsage_GD_Mouse = 0x02,
+    kHIDUsage_GD_Keyboard = 0x06,
+    kHIDUsage_GD_X = 0x30,
+    kHIDUsage_GD_Y = 0x31
+};
+
+enum {
+    kHIDUsage_KeyboardErrorRollOver = 0x01,
+    kHIDUsage_KeyboardPOSTFail = 0x02,
+    kHIDUsage_KeyboardErrorUndefined = 0x03,
+    kHIDUsage_KeyboardA = 0x04,
+    kHIDUsage_KeyboardLeftControl = 0xE0
+};
+
+enum {
+    kHIDUsage_Dig_Digitizer = 0x01,
+    kHIDUsage_Dig_Pen = 0x02,
+    kHIDUsage_Dig_TouchScreen = 0x04,
+    kHIDUsage_Dig_TouchPad = 0x05,
+    kHIDUsage_Dig_Finger = 0x22,
+    kHIDUsage_Dig_TipPressure = 0x30,
+    kHIDUsage_Dig_InRange = 0x32,
+    kHIDUsage_Dig_XTilt = 0x3D,
+    kHIDUsage_Dig_YTilt = 0x3E,
+    kHIDUsage_Dig_TipSwitch = 0x42,
+    kHIDUsage_Dig_Confidence = 0x47,
+    kHIDUsage_Dig_ContactIdentifier = 0x51,
+    kHIDUsage_Dig_DeviceMode = 0x52,
+    kHIDUsage_Dig_ContactCount = 0x54
+};
+
+#endif /* IOHIDUsageTables_h */
@@ -0,0 +1 @@
+#include <HostKernel.hpp>
@@ -0,0 +1,188 @@
+//
+//  AutosuspendTest.cpp
+//  VoodooI2CHID
+//
+//  Created on 10/19/26.
+//  Copyright © 2026 VoodooI2C contributors. All rights reserved.
+//
+//  Runs the driver on the simulated bus with autosuspend: off unless
+//  configured, the device put to sleep only after the idle time, woken by
+//  its own interrupt with the report that raised it delivered, including
+//  one that takes a while to latch after SET_POWER(ON). Also checks that
+//  polled devices never suspend and that system sleep and wake while
+//  suspended leave the device awake.
+//
+
+#include "HostTest.hpp"
+#include "HIDDeviceRig.hpp"
+
+#define kAddress 0x2c
+#define kReportLength 8
+#define kIdleMs 50
+#define kMs 1000000ULL
+
+static std::vector<UInt8> vendorReportDescriptor(){
+    return {
+        0x06, 0x00, 0xFF,           //Usage Page (Vendor Defined 0xFF00)
+        0x09, 0x01,                 //Usage (0x01)
+        0xA1, 0x01,                 //Collection (Application)
+        0x85, 0x01,                 //  Report ID (1)
+        0x09, 0x02,                 //  Usage (0x02)
+        0x15, 0x00,                 //  Logical Minimum (0)
+        0x26, 0xFF, 0x00,           //  Logical Maximum (255)
+        0x75, 0x08,                 //  Report Size (8)
+        0x95, kReportLength - 1,    //  Report Count
+        0x81, 0x02,                 //  Input (Data, Variable, Absolute)
+        0xC0                        //End Collection
+    };
+}
+
+static std::vector<UInt8> report(UInt8 value){
+    std::vector<UInt8> bytes(kReportLength, value);
+    bytes[0] = 1;
+    return bytes;
+}
+
+static void offByDefault(){
+    DesignWareBus bus;
+    HIDTargetConfig targetConfig;
+    targetConfig.reportDescriptor = vendorReportDescriptor();
+    HIDTarget target(targetConfig);
+    HIDDeviceRig rig(&bus, &target, kAddress);
+    CHECK(rig.start());
+
+    HostSimulationWait(4 * kIdleMs * kMs);
+    CHECK(target.isAwake());
+    CHECK_EQUAL(target.stats.sleeps, 0);
+    CHECK_EQUAL(rig.statistic("Autosuspend", "Suspends"), ~0ULL);
+
+    rig.stop();
+}
+
+static void suspendsWhenIdleAndWakesOnInput(){
+    DesignWareBus bus;
+    HIDTargetConfig targetConfig;
+    targetConfig.reportDescriptor = vendorReportDescriptor();
+    targetConfig.wakeLatchNs = 500000;
+    HIDTarget target(targetConfig);
+    HIDDeviceRig rig(&bus, &target, kAddress);
+    rig.setProperty("AutosuspendIdleMs", (UInt32)kIdleMs);
+    CHECK(rig.start());
+
+    //Input keeps pushing the idle time out
+    for (int i = 0; i < 5; i++){
+        HostSimulationWait(kIdleMs / 2 * kMs);
+        target.queueReport(report((UInt8)i));
+    }
+    HostSimulationWait(kIdleMs / 2 * kMs);
+    CHECK(target.isAwake());
+    CHECK_EQUAL(rig.reports.size(), 5);
+
+    HostSimulationWait(kIdleMs * kMs);
+    CHECK(!target.isAwake());
+    CHECK_EQUAL(rig.statistic("Autosuspend", "Suspends"), 1);
+
+    //The report that raises the interrupt is read once it latches, not lost to an empty read
+    target.queueReport(report(0x42));
+    HostSimulationWait(5 * kMs);
+    CHECK(target.isAwake());
+    CHECK_EQUAL(target.stats.wakes, 1);
+    CHECK_EQUAL(rig.reports.size(), 6);
+    if (rig.reports.size() == 6)
+        CHECK_EQUAL(rig.reports[5].bytes[1], 0x42);
+    CHECK_EQUAL(rig.statistic("Autosuspend", "EmptyWakes"), 0);
+    UInt64 wakeNs = rig.statistic("Autosuspend", "LastWakeToReportNs");
+    CHECK(wakeNs >= targetConfig.wakeLatchNs && wakeNs < 10 * kMs);
+    CHECK(rig.statistic("Autosuspend", "SuspendedMs") > 0);
+
+    //And back to sleep once idle again
+    HostSimulationWait(2 * kIdleMs * kMs);
+    CHECK(!target.isAwake());
+    CHECK_EQUAL(rig.statistic("Autosuspend", "Suspends"), 2);
+
+    rig.stop();
+}
+
+static void slowLatchCountsAnEmptyWake(){
+    DesignWareBus bus;
+    HIDTargetConfig targetConfig;
+    targetConfig.reportDescriptor = vendorReportDescriptor();
+    targetConfig.wakeLatchNs = 30 * kMs;
+    HIDTarget target(targetConfig);
+    HIDDeviceRig rig(&bus, &target, kAddress);
+    rig.setProperty("AutosuspendIdleMs", (UInt32)kIdleMs);
+    CHECK(rig.start());
+
+    HostSimulationWait(2 * kIdleMs * kMs);
+    CHECK(!target.isAwake());
+
+    //Longer than the wake reads wait: the wake comes up empty, and the still pending report is read on the next interrupt
+    target.queueReport(report(0x42));
+    HostSimulationWait(20 * kMs);
+    CHECK(target.isAwake());
+    CHECK_EQUAL(rig.statistic("Autosuspend", "EmptyWakes"), 1);
+    CHECK_EQUAL(rig.reports.size(), 0);
+    HostSimulationWait(20 * kMs);
+    CHECK_EQUAL(rig.reports.size(), 1);
+
+    rig.stop();
+}
+
+static void pollingNeverSuspends(){
+    DesignWareBus bus;
+    HIDTargetConfig targetConfig;
+    targetConfig.reportDescriptor = vendorReportDescriptor();
+    HIDTarget target(targetConfig);
+    HIDDeviceRig rig(&bus, &target, kAddress);
+    rig.setProperty("AutosuspendIdleMs", (UInt32)kIdleMs);
+    rig.setProperty("QuirkPollIntervalMs", (UInt32)10);
+    CHECK(rig.start());
+
+    HostSimulationWait(4 * kIdleMs * kMs);
+    CHECK(target.isAwake());
+    CHECK_EQUAL(target.stats.sleeps, 0);
+    CHECK_EQUAL(rig.statistic("Autosuspend", "Suspends"), ~0ULL);
+
+    rig.stop();
+}
+
+static void systemWakeWhileSuspended(){
+    DesignWareBus bus;
+    HIDTargetConfig targetConfig;
+    targetConfig.reportDescriptor = vendorReportDescriptor();
+    HIDTarget target(targetConfig);
+    HIDDeviceRig rig(&bus, &target, kAddress);
+    rig.setProperty("AutosuspendIdleMs", (UInt32)kIdleMs);
+    CHECK(rig.start());
+
+    HostSimulationWait(2 * kIdleMs * kMs);
+    CHECK(!target.isAwake());
+
+    rig.setPowerState(0);
+    HostSimulationWait(10 * kMs);
+    rig.setPowerState(1);
+    HostSimulationWait(10 * kMs);
+    CHECK(target.isAwake());
+
+    //Awake again with a fresh idle time before the next suspend
+    target.queueReport(report(0x42));
+    HostSimulationWait(10 * kMs);
+    CHECK_EQUAL(rig.reports.size(), 1);
+    CHECK_EQUAL(rig.statistic("Autosuspend", "Suspends"), 1);
+    HostSimulationWait(2 * kIdleMs * kMs);
+    CHECK(!target.isAwake());
+    CHECK_EQUAL(rig.statistic("Autosuspend", "Suspends"), 2);
+
+    rig.stop();
+}
+
+int main(){
+    HostSimulationStart();
+
+    offByDefault();
+    suspendsWhenIdleAndWakesOnInput();
+    slowLatchCountsAnEmptyWake();
+    pollingNeverSuspends();
+    systemWakeWhileSuspended();
+    return hostTestResult("AutosuspendTest");
+}
@@ -0,0 +1,169 @@
+//
+//  BusSpeedTest.cpp
+//  VoodooI2CHID
+//
+//  Created on 10/19/26.
+//  Copyright © 2026 VoodooI2C contributors. All rights reserved.
+//
+//  Checks the SCL counts derived for each connection speed against the
+//  controller clock, then starts the driver on the simulated DesignWare bus
+//  and checks that the speed its _CRS declares is what every transfer asks
+//  the controller for, and that an undeclared speed asks for nothing.
+//
+
+#include "HostTest.hpp"
+#include "HIDDeviceRig.hpp"
+
+#define kAddress 0x2c
+
+static std::vector<UInt8> vendorReportDescriptor(){
+    return {
+        0x06, 0x00, 0xFF,           //Usage Page (Vendor Defined 0xFF00)
+        0x09, 0x01,                 //Usage (0x01)
+        0xA1, 0x01,                 //Collection (Application)
+        0x09, 0x02,                 //  Usage (0x02)
+        0x15, 0x00,                 //  Logical Minimum (0)
+        0x26, 0xFF, 0x00,           //  Logical Maximum (255)
+        0x75, 0x08,                 //  Report Size (8)
+        0x95, 0x08,                 //  Report Count (8)
+        0x81, 0x02,                 //  Input (Data, Variable, Absolute)
+        0xC0                        //End Collection
+    };
+}
+
+static void countsFromConfig(){
+    DesignWareBus bus;
+    VoodooI2CControllerBusConfig counts;
+    VoodooI2CHIDBusTiming timing;
+
+    VoodooI2CHIDBusTimingFromController(bus.controller, kVoodooI2CHIDBusSpeedStandard, &timing);
+    CHECK_EQUAL(timing.speed, kVoodooI2CHIDBusSpeedStandard);
+    CHECK_EQUAL(timing.hcnt, counts.ss_hcnt);
+    CHECK_EQUAL(timing.lcnt, counts.ss_lcnt);
+
+    VoodooI2CHIDBusTimingFromController(bus.controller, kVoodooI2CHIDBusSpeedFast, &timing);
+    CHECK_EQUAL(timing.speed, kVoodooI2CHIDBusSpeedFast);
+    CHECK_EQUAL(timing.hcnt, counts.fs_hcnt);
+    CHECK_EQUAL(timing.lcnt, counts.fs_lcnt);
+
+    //Speeds between the modes round down, 0 follows the controller's configured mode
+    VoodooI2CHIDBusTimingFromController(bus.controller, 250000, &timing);
+    CHECK_EQUAL(timing.speed, kVoodooI2CHIDBusSpeedStandard);
+    VoodooI2CHIDBusTimingFromController(bus.controller, kVoodooI2CHIDBusSpeedUnspecified, &timing);
+    CHECK_EQUAL(timing.speed, kVoodooI2CHIDBusSpeedFast);
+}
+
+static void fastPlusFromClock(){
+    UInt32 clocks[] = { 100000, 133000, 216000 };
+    for (UInt32 clock : clocks){
+        DesignWareConfig config;
+        config.clockKHz = clock;
+        DesignWareBus bus(config);
+
+        VoodooI2CHIDBusTiming timing;
+        VoodooI2CHIDBusTimingFromController(bus.controller, kVoodooI2CHIDBusSpeedFastPlus, &timing);
+        CHECK_EQUAL(timing.speed, kVoodooI2CHIDBusSpeedFastPlus);
+
+        //At most 1MHz, with SCL high and low for at least the 260ns and 500ns the mode requires
+        UInt64 periodNs = bus.bitTimeNs(timing.hcnt, timing.lcnt);
+        CHECK(periodNs >= 1000);
+        CHECK(periodNs < 2000);
+        CHECK((timing.hcnt + 8) * 1000000ULL / clock >= 260);
+        CHECK((timing.lcnt + 1) * 1000000ULL / clock >= 500);
+    }
+
+    //The Haswell clock gives what the DesignWare drivers program for it
+    DesignWareBus bus;
+    VoodooI2CHIDBusTiming timing;
+    VoodooI2CHIDBusTimingFromController(bus.controller, kVoodooI2CHIDBusSpeedFastPlus, &timing);
+    CHECK_EQUAL(timing.hcnt, 53);
+    CHECK_EQUAL(timing.lcnt, 79);
+
+    //A controller that doesn't report its clock gets counts close to those from its fast-mode period
+    bus.controller->bus_device->clock_rate = 0;
+    VoodooI2CHIDBusTiming inferred;
+    VoodooI2CHIDBusTimingFromController(bus.controller, kVoodooI2CHIDBusSpeedFastPlus, &inferred);
+    CHECK(inferred.hcnt + 3 >= timing.hcnt && inferred.hcnt <= timing.hcnt);
+    CHECK(inferred.lcnt + 4 >= timing.lcnt && inferred.lcnt <= timing.lcnt);
+    CHECK(bus.bitTimeNs(inferred.hcnt, inferred.lcnt) >= 950);
+}
+
+struct DeviceRun {
+    bool started;
+    UInt64 transfers;
+    UInt64 speedRequests;
+    UInt32 sclHz;
+    bool speedPublished;
+    UInt64 highCount;
+};
+
+static DeviceRun runDevice(UInt32 speedHz, UInt16 declaredAddress = kAddress){
+    DesignWareBus bus;
+    HIDTargetConfig targetConfig;
+    targetConfig.reportDescriptor = vendorReportDescriptor();
+    HIDTarget target(targetConfig);
+
+    HIDDeviceRig rig(&bus, &target, kAddress, speedHz);
+    if (declaredAddress != kAddress)
+        rig.setConnection(speedHz, declaredAddress);
+
+    DeviceRun run;
+    run.started = rig.start();
+    HostSimulationWait(20000000);
+    run.transfers = bus.stats.transfers;
+    run.speedRequests = bus.stats.speedRequests;
+    run.sclHz = bus.lastSclHz();
+
+    OSObject *speed = rig.copyProperty("ConnectionSpeed");
+    run.speedPublished = speed != NULL;
+    OSSafeReleaseNULL(speed);
+    OSNumber *highCount = OSDynamicCast(OSNumber, rig.copyProperty("RequestedSCLHighCount"));
+    run.highCount = highCount ? highCount->unsigned64BitValue() : 0;
+    OSSafeReleaseNULL(highCount);
+
+    rig.stop();
+    return run;
+}
+
+static void deviceRequestsDeclaredSpeed(){
+    DesignWareBus reference;
+    VoodooI2CControllerBusConfig counts;
+    UInt32 configuredHz = (UInt32)(1000000000ULL / reference.bitTimeNs(counts.fs_hcnt, counts.fs_lcnt));
+
+    //Fast-mode Plus from _CRS: every transfer carries it and the bus runs above fast mode
+    DeviceRun fastPlus = runDevice(kVoodooI2CHIDBusSpeedFastPlus);
+    CHECK(fastPlus.started);
+    CHECK(fastPlus.transfers > 0);
+    CHECK_EQUAL(fastPlus.speedRequests, fastPlus.transfers);
+    CHECK(fastPlus.sclHz > configuredHz && fastPlus.sclHz <= kVoodooI2CHIDBusSpeedFastPlus);
+    CHECK(fastPlus.speedPublished);
+    CHECK_EQUAL(fastPlus.highCount, 53);
+
+    DeviceRun fast = runDevice(kVoodooI2CHIDBusSpeedFast);
+    CHECK(fast.started);
+    CHECK_EQUAL(fast.speedRequests, fast.transfers);
+    CHECK_EQUAL(fast.sclHz, configuredHz);
+    CHECK_EQUAL(fast.highCount, counts.fs_hcnt);
+
+    //No I2cSerialBus resource, or none for this address: the controller keeps its configured speed
+    DeviceRun undeclared = runDevice(0);
+    CHECK(undeclared.started);
+    CHECK(undeclared.transfers > 0);
+    CHECK_EQUAL(undeclared.speedRequests, 0);
+    CHECK_EQUAL(undeclared.sclHz, configuredHz);
+    CHECK(!undeclared.speedPublished);
+
+    DeviceRun otherAddress = runDevice(kVoodooI2CHIDBusSpeedFastPlus, kAddress + 1);
+    CHECK(otherAddress.started);
+    CHECK_EQUAL(otherAddress.speedRequests, 0);
+    CHECK(!otherAddress.speedPublished);
+}
+
+int main(){
+    HostSimulationStart();
+
+    countsFromConfig();
+    fastPlusFromClock();
+    deviceRequestsDeclaredSpeed();
+    return hostTestResult("BusSpeedTest");
+}
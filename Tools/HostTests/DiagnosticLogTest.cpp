@@ -0,0 +1,195 @@
+//
+//  DiagnosticLogTest.cpp
+//  VoodooI2CHID
+//
+//  Created on 10/19/26.
+//  Copyright © 2026 VoodooI2C contributors. All rights reserved.
+//
+//  Checks the diagnostic log ring: the per-code rate limit and its window,
+//  drain scheduling, overruns when nothing drains, and that concurrent
+//  producers neither lose count nor tear records. Then floods a simulated
+//  device with bad reads and checks the driver's log stays within the limit.
+//
+
+#include "HostTest.hpp"
+#include "HIDDeviceRig.hpp"
+
+#include <thread>
+
+#define kAddress 0x2c
+#define kMs 1000000ULL
+
+static VoodooI2CHIDLog diagnosticLog;
+
+static UInt64 logStatistic(OSDictionary *stats, const char *code, const char *key){
+    OSDictionary *entry = OSDynamicCast(OSDictionary, stats->getObject(code));
+    OSNumber *number = entry ? OSDynamicCast(OSNumber, entry->getObject(key)) : NULL;
+    return number ? number->unsigned64BitValue() : ~0ULL;
+}
+
+static UInt64 overruns(OSDictionary *stats){
+    OSNumber *number = OSDynamicCast(OSNumber, stats->getObject("Overruns"));
+    return number ? number->unsigned64BitValue() : ~0ULL;
+}
+
+static std::string recentLine(unsigned int fromEnd){
+    OSArray *recent = diagnosticLog.copyRecent(kVoodooI2CHIDLogRecords);
+    std::string line;
+    if (recent && recent->getCount() > fromEnd){
+        OSString *string = OSDynamicCast(OSString, recent->getObject(recent->getCount() - 1 - fromEnd));
+        if (string)
+            line = string->getCStringNoCopy();
+    }
+    if (recent)
+        recent->release();
+    return line;
+}
+
+//Producers on host threads, against the real clock: every call is either recorded or rate limited, and every record is whole
+static void concurrentProducers(){
+    diagnosticLog.init();
+    const int threads = 4, calls = 5000;
+    std::vector<std::thread> producers;
+    for (int t = 0; t < threads; t++){
+        producers.emplace_back([t]{
+            for (int i = 0; i < calls; i++)
+                diagnosticLog.record((VoodooI2CHIDLogCode)(i % 3), t, i, t ^ i);
+        });
+    }
+    for (std::thread &producer : producers)
+        producer.join();
+
+    OSDictionary *stats = diagnosticLog.copyStatistics();
+    UInt64 total = 0;
+    for (const char *code : { "BadRead", "EmptyReport", "IncompleteReport" }){
+        UInt64 recorded = logStatistic(stats, code, "Recorded");
+        total += recorded + logStatistic(stats, code, "RateLimited");
+        CHECK(recorded >= kVoodooI2CHIDLogRateLimit);
+    }
+    CHECK_EQUAL(total, threads * calls);
+    stats->release();
+
+    //The third argument ties each record's arguments together, a torn one wouldn't match
+    OSArray *recent = diagnosticLog.copyRecent(kVoodooI2CHIDLogRecords);
+    CHECK(recent && recent->getCount() > 0);
+    for (unsigned int i = 0; recent && i < recent->getCount(); i++){
+        OSString *line = OSDynamicCast(OSString, recent->getObject(i));
+        unsigned int thread, call;
+        const char *incomplete = line ? strstr(line->getCStringNoCopy(), "Incomplete report ") : NULL;
+        if (incomplete && sscanf(incomplete, "Incomplete report %u/%u", &thread, &call) == 2)
+            CHECK(thread < threads && call < calls && call % 3 == 2);
+    }
+    if (recent)
+        recent->release();
+}
+
+static void rateLimitsEachCode(){
+    diagnosticLog.init();
+
+    //Only the first record since the last drain asks for one
+    CHECK(diagnosticLog.record(kVoodooI2CHIDLogBadRead));
+    for (int i = 1; i < 40; i++)
+        CHECK(!diagnosticLog.record(kVoodooI2CHIDLogBadRead));
+
+    //Each code has its own budget
+    for (int i = 0; i < 10; i++)
+        diagnosticLog.record(kVoodooI2CHIDLogIncompleteReport, 64, 70 + i);
+
+    OSDictionary *stats = diagnosticLog.copyStatistics();
+    CHECK_EQUAL(logStatistic(stats, "BadRead", "Recorded"), kVoodooI2CHIDLogRateLimit);
+    CHECK_EQUAL(logStatistic(stats, "BadRead", "RateLimited"), 40 - kVoodooI2CHIDLogRateLimit);
+    CHECK_EQUAL(logStatistic(stats, "IncompleteReport", "Recorded"), 10);
+    CHECK_EQUAL(logStatistic(stats, "IncompleteReport", "RateLimited"), 0);
+    stats->release();
+    CHECK(recentLine(0).find("Incomplete report 64/79") != std::string::npos);
+
+    //The next window has a fresh budget
+    HostSimulationWait(kVoodooI2CHIDLogRateWindowMs * kMs);
+    for (int i = 0; i < 40; i++)
+        diagnosticLog.record(kVoodooI2CHIDLogBadRead);
+    stats = diagnosticLog.copyStatistics();
+    CHECK_EQUAL(logStatistic(stats, "BadRead", "Recorded"), 2 * kVoodooI2CHIDLogRateLimit);
+    stats->release();
+
+    //Drained once, nothing is pending until the next record
+    CHECK(diagnosticLog.isDrainPending());
+    CHECK(!diagnosticLog.drain("DiagnosticLogTest"));
+    CHECK(!diagnosticLog.isDrainPending());
+    HostSimulationWait(kVoodooI2CHIDLogRateWindowMs * kMs);
+    CHECK(diagnosticLog.record(kVoodooI2CHIDLogThreadError, 5));
+    CHECK(recentLine(0).find("Thread error! 0x00000005") != std::string::npos);
+}
+
+static void countsOverruns(){
+    diagnosticLog.init();
+
+    //Fill the ring one and a quarter times over without draining
+    unsigned int records = kVoodooI2CHIDLogRecords + kVoodooI2CHIDLogRecords / 4;
+    for (unsigned int i = 0; i < records; i++){
+        if (i && i % kVoodooI2CHIDLogRateLimit == 0)
+            HostSimulationWait(kVoodooI2CHIDLogRateWindowMs * kMs);
+        diagnosticLog.record(kVoodooI2CHIDLogIncompleteReport, 64, i);
+    }
+
+    CHECK(!diagnosticLog.drain("DiagnosticLogTest"));
+    OSDictionary *stats = diagnosticLog.copyStatistics();
+    CHECK_EQUAL(overruns(stats), records - kVoodooI2CHIDLogRecords);
+    CHECK_EQUAL(logStatistic(stats, "IncompleteReport", "RateLimited"), 0);
+    stats->release();
+
+    //The oldest records are the ones lost
+    char expected[32];
+    snprintf(expected, sizeof(expected), "64/%u", records - kVoodooI2CHIDLogRecords);
+    CHECK(recentLine(kVoodooI2CHIDLogRecords - 1).find(expected) != std::string::npos);
+}
+
+static void limitsADeviceFlood(){
+    DesignWareBus bus;
+    HIDTargetConfig targetConfig;
+    targetConfig.reportDescriptor = {
+        0x06, 0x00, 0xFF,           //Usage Page (Vendor Defined 0xFF00)
+        0x09, 0x01,                 //Usage (0x01)
+        0xA1, 0x01,                 //Collection (Application)
+        0x09, 0x02,                 //  Usage (0x02)
+        0x15, 0x00,                 //  Logical Minimum (0)
+        0x26, 0xFF, 0x00,           //  Logical Maximum (255)
+        0x75, 0x08,                 //  Report Size (8)
+        0x95, 0x07,                 //  Report Count (7)
+        0x81, 0x02,                 //  Input (Data, Variable, Absolute)
+        0xC0                        //End Collection
+    };
+    HIDTarget target(targetConfig);
+    HIDDeviceRig rig(&bus, &target, kAddress);
+    CHECK(rig.start());
+    HostSimulationWait(20 * kMs);
+
+    //A device stuck sending garbage fails every read it interrupts for, well past the budget for one window
+    target.desync(kHIDTargetDesyncForever, 0);
+    for (int i = 0; i < 40; i++){
+        target.queueReport(std::vector<UInt8>(7, (UInt8)i));
+        HostSimulationWait(20 * kMs);
+    }
+
+    OSObject *value = rig.copyProperty("DiagnosticLog");
+    OSDictionary *stats = OSDynamicCast(OSDictionary, value);
+    CHECK(stats != NULL);
+    if (stats){
+        CHECK_EQUAL(logStatistic(stats, "BadRead", "Recorded"), kVoodooI2CHIDLogRateLimit);
+        CHECK(logStatistic(stats, "BadRead", "RateLimited") > 0);
+    }
+    if (value)
+        value->release();
+
+    target.desync(kHIDTargetDesyncNone, 0);
+    rig.stop();
+}
+
+int main(){
+    concurrentProducers();
+
+    HostSimulationStart();
+    rateLimitsEachCode();
+    countsOverruns();
+    limitsADeviceFlood();
+    return hostTestResult("DiagnosticLogTest");
+}
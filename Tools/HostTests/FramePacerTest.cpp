@@ -0,0 +1,152 @@
+//
+//  FramePacerTest.cpp
+//  VoodooI2CHID
+//
+//  Created on 10/19/26.
+//  Copyright © 2026 VoodooI2C contributors. All rights reserved.
+//
+//  Runs the driver on the simulated bus with frame pacing: a device reporting
+//  every millisecond is delivered once per interval with the latest position,
+//  button transitions survive the coalescing, and with intermediates every
+//  report gets through carrying the time it was read. The published counters
+//  have to add up whichever way reports were handled.
+//
+
+#include "HostTest.hpp"
+#include "HIDDeviceRig.hpp"
+
+#define kAddress 0x2c
+#define kReportID 1
+#define kPacingMs 8
+#define kReports 40
+#define kMs 1000000ULL
+
+static std::vector<UInt8> mouseReportDescriptor(){
+    return {
+        0x05, 0x01,                 //Usage Page (Generic Desktop)
+        0x09, 0x02,                 //Usage (Mouse)
+        0xA1, 0x01,                 //Collection (Application)
+        0x85, kReportID,            //  Report ID
+        0x09, 0x01,                 //  Usage (Pointer)
+        0xA1, 0x00,                 //  Collection (Physical)
+        0x05, 0x09,                 //    Usage Page (Button)
+        0x19, 0x01,                 //    Usage Minimum (1)
+        0x29, 0x03,                 //    Usage Maximum (3)
+        0x15, 0x00,                 //    Logical Minimum (0)
+        0x25, 0x01,                 //    Logical Maximum (1)
+        0x75, 0x01,                 //    Report Size (1)
+        0x95, 0x03,                 //    Report Count (3)
+        0x81, 0x02,                 //    Input (Data, Variable, Absolute)
+        0x95, 0x05,                 //    Report Count (5)
+        0x81, 0x03,                 //    Input (Constant)
+        0x05, 0x01,                 //    Usage Page (Generic Desktop)
+        0x09, 0x30,                 //    Usage (X)
+        0x09, 0x31,                 //    Usage (Y)
+        0x26, 0xFF, 0x00,           //    Logical Maximum (255)
+        0x75, 0x08,                 //    Report Size (8)
+        0x95, 0x02,                 //    Report Count (2)
+        0x81, 0x02,                 //    Input (Data, Variable, Absolute)
+        0xC0,                       //  End Collection
+        0xC0                        //End Collection
+    };
+}
+
+static std::vector<UInt8> report(UInt8 buttons, UInt8 x){
+    return { kReportID, buttons, x, 0x20 };
+}
+
+//Counters always add up: every report queued was delivered, replaced by a newer one, or pushed out
+static void checkCounters(HIDDeviceRig &rig, UInt64 queued){
+    UInt64 delivered = rig.statistic("FramePacing", "Delivered");
+    CHECK_EQUAL(rig.statistic("FramePacing", "Queued"), queued);
+    CHECK_EQUAL(delivered, rig.reports.size());
+    CHECK_EQUAL(delivered + rig.statistic("FramePacing", "Replaced") + rig.statistic("FramePacing", "Overflowed"), queued);
+}
+
+static void coalescesToTheLatestState(){
+    DesignWareBus bus;
+    HIDTargetConfig targetConfig;
+    targetConfig.reportDescriptor = mouseReportDescriptor();
+    targetConfig.maxInputLength = 16;
+    HIDTarget target(targetConfig);
+    HIDDeviceRig rig(&bus, &target, kAddress);
+    rig.setProperty("FramePacingMs", (UInt32)kPacingMs);
+    CHECK(rig.start());
+    HostSimulationWait(20 * kMs);
+
+    //Moving every millisecond, with a click in the middle
+    for (int i = 0; i < kReports; i++){
+        target.queueReport(report(i == 10 ? 1 : 0, (UInt8)i));
+        HostSimulationWait(kMs);
+    }
+    HostSimulationWait(2 * kPacingMs * kMs);
+
+    //One frame per interval however many reports the device sent, each carrying one report but for the click
+    UInt64 frames = rig.statistic("FramePacing", "Frames");
+    CHECK(frames >= kReports / kPacingMs && frames <= kReports / kPacingMs + 2);
+    CHECK(rig.reports.size() >= frames && rig.reports.size() <= frames + 2);
+    CHECK(rig.statistic("FramePacing", "MaxDelayNs") <= (kPacingMs + 1) * kMs);
+    checkCounters(rig, kReports);
+
+    //The click and the release after it are delivered, and the frames end on the latest position
+    int clicks = 0;
+    for (size_t i = 0; i < rig.reports.size(); i++){
+        const std::vector<UInt8> &bytes = rig.reports[i].bytes;
+        CHECK(bytes.size() == 4 && bytes[0] == kReportID);
+        if (bytes.size() == 4 && bytes[1]){
+            clicks++;
+            CHECK_EQUAL(bytes[2], 10);
+            CHECK(i + 1 < rig.reports.size() && !rig.reports[i + 1].bytes[1]);
+        }
+    }
+    CHECK_EQUAL(clicks, 1);
+    if (!rig.reports.empty())
+        CHECK_EQUAL(rig.reports.back().bytes[2], kReports - 1);
+
+    rig.stop();
+}
+
+static void deliversIntermediates(){
+    DesignWareBus bus;
+    HIDTargetConfig targetConfig;
+    targetConfig.reportDescriptor = mouseReportDescriptor();
+    targetConfig.maxInputLength = 16;
+    HIDTarget target(targetConfig);
+    HIDDeviceRig rig(&bus, &target, kAddress);
+    rig.setProperty("FramePacingMs", (UInt32)kPacingMs);
+    rig.setProperty("FramePacingIntermediates", true);
+    CHECK(rig.start());
+    HostSimulationWait(20 * kMs);
+
+    for (int i = 0; i < kReports; i++){
+        target.queueReport(report(0, (UInt8)i));
+        HostSimulationWait(kMs);
+    }
+    HostSimulationWait(2 * kPacingMs * kMs);
+
+    //Every sample, in order, batched into frames but stamped with when it was read
+    CHECK_EQUAL(rig.reports.size(), kReports);
+    CHECK(rig.statistic("FramePacing", "Frames") <= kReports / kPacingMs + 2);
+    checkCounters(rig, kReports);
+    CHECK_EQUAL(rig.statistic("FramePacing", "Replaced"), 0);
+    int batched = 0;
+    for (size_t i = 0; i < rig.reports.size(); i++){
+        CHECK_EQUAL(rig.reports[i].bytes[2], i);
+        CHECK(rig.reports[i].timeStamp <= rig.reports[i].time);
+        if (i && rig.reports[i].time == rig.reports[i - 1].time){
+            batched++;
+            CHECK(rig.reports[i].timeStamp > rig.reports[i - 1].timeStamp);
+        }
+    }
+    CHECK(batched > kReports / 2);
+
+    rig.stop();
+}
+
+int main(){
+    HostSimulationStart();
+
+    coalescesToTheLatestState();
+    deliversIntermediates();
+    return hostTestResult("FramePacerTest");
+}
@@ -0,0 +1,53 @@
+//
+//  HostTest.hpp
+//  VoodooI2CHID
+//
+//  Created on 10/19/26.
+//  Copyright © 2026 VoodooI2C contributors. All rights reserved.
+//
+//  Minimal check macros shared by the host tests. A failed check is
+//  reported and counted, and the test exits non-zero at the end.
+//
+
+#ifndef HostTest_hpp
+#define HostTest_hpp
+
+#include <stdio.h>
+
+#include <algorithm>
+#include <vector>
+
+static int hostTestFailures = 0;
+
+#define CHECK(condition) do { \
+    if (!(condition)){ \
+        fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+        hostTestFailures++; \
+    } \
+} while (0)
+
+#define CHECK_EQUAL(actual, expected) do { \
+    long long actualValue = (long long)(actual); \
+    long long expectedValue = (long long)(expected); \
+    if (actualValue != expectedValue){ \
+        fprintf(stderr, "%s:%d: check failed: %s is %lld, expected %lld\n", __FILE__, __LINE__, #actual, actualValue, expectedValue); \
+        hostTestFailures++; \
+    } \
+} while (0)
+
+static inline int hostTestResult(const char *name){
+    if (hostTestFailures)
+        fprintf(stderr, "%s: %d check(s) failed\n", name, hostTestFailures);
+    else
+        printf("%s: ok\n", name);
+    return hostTestFailures ? 1 : 0;
+}
+
+static inline unsigned long long hostTestPercentile(std::vector<unsigned long long> samples, unsigned int perMille){
+    if (samples.empty())
+        return 0;
+    std::sort(samples.begin(), samples.end());
+    return samples[(samples.size() - 1) * perMille / 1000];
+}
+
+#endif /* HostTest_hpp */
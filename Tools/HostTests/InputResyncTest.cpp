@@ -0,0 +1,153 @@
+//
+//  InputResyncTest.cpp
+//  VoodooI2CHID
+//
+//  Created on 10/19/26.
+//  Copyright © 2026 VoodooI2C contributors. All rights reserved.
+//
+//  Desynchronizes the simulated device's input register in each of the ways
+//  the driver's recovery tiers are meant for, and checks that recovery stops
+//  at the cheapest tier that works, that only a device still unreadable after
+//  the reset counts as a failure, and that input flows again afterwards.
+//
+
+#include "HostTest.hpp"
+#include "HIDDeviceRig.hpp"
+
+#define kAddress 0x2c
+#define kReportLength 8
+
+static std::vector<UInt8> vendorReportDescriptor(){
+    return {
+        0x06, 0x00, 0xFF,           //Usage Page (Vendor Defined 0xFF00)
+        0x09, 0x01,                 //Usage (0x01)
+        0xA1, 0x01,                 //Collection (Application)
+        0x85, 0x01,                 //  Report ID (1)
+        0x09, 0x02,                 //  Usage (0x02)
+        0x15, 0x00,                 //  Logical Minimum (0)
+        0x26, 0xFF, 0x00,           //  Logical Maximum (255)
+        0x75, 0x08,                 //  Report Size (8)
+        0x95, kReportLength - 1,    //  Report Count
+        0x81, 0x02,                 //  Input (Data, Variable, Absolute)
+        0xC0                        //End Collection
+    };
+}
+
+struct Tiers {
+    UInt64 retries;
+    UInt64 flushes;
+    UInt64 powerCycles;
+    UInt64 resets;
+    UInt64 failures;
+};
+
+struct Case {
+    const char *name;
+    HIDTargetDesync desync;
+    unsigned int reads;
+    Tiers expected;
+};
+
+static void queueReports(HIDTarget *target, unsigned int count){
+    for (unsigned int i = 0; i < count; i++){
+        std::vector<UInt8> report(kReportLength, (UInt8)i);
+        report[0] = 1;
+        target->queueReport(report);
+        HostSimulationWait(2000000);
+    }
+}
+
+//The reset at start ends with an empty report of its own, which would otherwise be the read that gets desynchronized
+static bool startSettled(HIDDeviceRig *rig){
+    bool started = rig->start();
+    HostSimulationWait(20000000);
+    return started;
+}
+
+static Tiers tiers(HIDDeviceRig *rig){
+    Tiers tiers = {
+        rig->statistic("InputRecovery", "Retries"),
+        rig->statistic("InputRecovery", "Flushes"),
+        rig->statistic("InputRecovery", "PowerCycles"),
+        rig->statistic("InputRecovery", "Resets"),
+        rig->statistic("InputRecovery", "Failures")
+    };
+    return tiers;
+}
+
+static void recoversAtEachTier(){
+    //Tiers run in order, so each later one counts the attempts before it
+    Case cases[] = {
+        { "one bad read", kHIDTargetDesyncReads, 1, { 1, 0, 0, 0, 0 } },
+        { "a few bad reads", kHIDTargetDesyncReads, 4, { 1, 1, 0, 0, 0 } },
+        { "until power cycle", kHIDTargetDesyncUntilPowerCycle, 0, { 1, 1, 1, 0, 0 } },
+        { "until reset", kHIDTargetDesyncUntilReset, 0, { 1, 1, 1, 1, 0 } },
+    };
+
+    for (const Case &test : cases){
+        DesignWareBus bus;
+        HIDTargetConfig targetConfig;
+        targetConfig.reportDescriptor = vendorReportDescriptor();
+        HIDTarget target(targetConfig);
+        HIDDeviceRig rig(&bus, &target, kAddress);
+        CHECK(startSettled(&rig));
+
+        target.desync(test.desync, test.reads);
+        queueReports(&target, 1);
+        HostSimulationWait(50000000);
+
+        Tiers actual = tiers(&rig);
+        if (actual.retries != test.expected.retries || actual.flushes != test.expected.flushes ||
+            actual.powerCycles != test.expected.powerCycles || actual.resets != test.expected.resets ||
+            actual.failures != test.expected.failures)
+            fprintf(stderr, "%s: tiers %llu/%llu/%llu/%llu failures %llu\n", test.name,
+                    (unsigned long long)actual.retries, (unsigned long long)actual.flushes,
+                    (unsigned long long)actual.powerCycles, (unsigned long long)actual.resets,
+                    (unsigned long long)actual.failures);
+        CHECK_EQUAL(actual.retries, test.expected.retries);
+        CHECK_EQUAL(actual.flushes, test.expected.flushes);
+        CHECK_EQUAL(actual.powerCycles, test.expected.powerCycles);
+        CHECK_EQUAL(actual.resets, test.expected.resets);
+        CHECK_EQUAL(actual.failures, test.expected.failures);
+
+        //Recovered means the next reports get through untouched
+        size_t delivered = rig.reports.size();
+        queueReports(&target, 4);
+        HostSimulationWait(20000000);
+        CHECK_EQUAL(rig.reports.size() - delivered, 4);
+        CHECK_EQUAL(tiers(&rig).retries, test.expected.retries);
+
+        rig.stop();
+    }
+}
+
+static void failsOnlyWhenResetDoesNotHelp(){
+    DesignWareBus bus;
+    HIDTargetConfig targetConfig;
+    targetConfig.reportDescriptor = vendorReportDescriptor();
+    HIDTarget target(targetConfig);
+    HIDDeviceRig rig(&bus, &target, kAddress);
+    CHECK(startSettled(&rig));
+
+    target.desync(kHIDTargetDesyncForever, 0);
+    queueReports(&target, 1);
+    HostSimulationWait(50000000);
+
+    //Every pass through the tiers ends in a reset that doesn't bring the device back
+    Tiers actual = tiers(&rig);
+    CHECK(actual.resets > 0);
+    CHECK(actual.failures > 0);
+    CHECK(actual.failures + 1 >= actual.resets && actual.failures <= actual.resets);
+    CHECK_EQUAL(rig.reports.size(), 0);
+
+    target.desync(kHIDTargetDesyncNone, 0);
+    rig.stop();
+}
+
+int main(){
+    HostSimulationStart();
+
+    recoversAtEachTier();
+    failsOnlyWhenResetDoesNotHelp();
+    return hostTestResult("InputResyncTest");
+}
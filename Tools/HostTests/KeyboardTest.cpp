@@ -0,0 +1,335 @@
+//
+//  KeyboardTest.cpp
+//  VoodooI2CHID
+//
+//  Created on 10/19/26.
+//  Copyright © 2026 VoodooI2C contributors. All rights reserved.
+//
+//  Checks the keyboard bitmap diff: presses and releases across the modifier
+//  bits and the key array, repeats and reordered arrays counted as
+//  duplicates, and rollover error reports dropped without losing the held
+//  keys. Then checks the generic keyboard personality only matches devices
+//  with a keyboard collection, and that the driver suppresses duplicates and
+//  logs rollover reports. Ends with the per-report cost of the bitmap diff
+//  against scanning the key arrays, over a synthetic typing stream.
+//
+
+#include "HostTest.hpp"
+#include "HIDDeviceRig.hpp"
+
+#include <chrono>
+#include <random>
+
+typedef std::chrono::steady_clock Clock;
+
+#define kAddress 0x2c
+#define kKeyboardReportID 1
+#define kKeySlots 6
+
+#define kUsageA 0x04
+#define kUsageB 0x05
+#define kUsageC 0x06
+#define kUsageLeftShift 0xE1
+
+static std::vector<UInt8> keyboardReportDescriptor(bool vendorByte = false){
+    std::vector<UInt8> descriptor = {
+        0x05, 0x01,                 //Usage Page (Generic Desktop)
+        0x09, 0x06,                 //Usage (Keyboard)
+        0xA1, 0x01,                 //Collection (Application)
+        0x85, kKeyboardReportID,    //  Report ID
+        0x05, 0x07,                 //  Usage Page (Keyboard)
+        0x19, 0xE0,                 //  Usage Minimum (Left Control)
+        0x29, 0xE7,                 //  Usage Maximum (Right GUI)
+        0x15, 0x00,                 //  Logical Minimum (0)
+        0x25, 0x01,                 //  Logical Maximum (1)
+        0x75, 0x01,                 //  Report Size (1)
+        0x95, 0x08,                 //  Report Count (8)
+        0x81, 0x02,                 //  Input (Data, Variable, Absolute)
+        0x95, 0x01,                 //  Report Count (1)
+        0x75, 0x08,                 //  Report Size (8)
+        0x81, 0x03,                 //  Input (Constant)
+        0x19, 0x00,                 //  Usage Minimum (0)
+        0x29, 0x65,                 //  Usage Maximum (Keyboard Application)
+        0x15, 0x00,                 //  Logical Minimum (0)
+        0x25, 0x65,                 //  Logical Maximum (101)
+        0x95, kKeySlots,            //  Report Count
+        0x81, 0x00,                 //  Input (Data, Array)
+    };
+    if (vendorByte){
+        std::vector<UInt8> vendor = {
+            0x06, 0x00, 0xFF,       //  Usage Page (Vendor Defined 0xFF00)
+            0x09, 0x01,             //  Usage (0x01)
+            0x26, 0xFF, 0x00,       //  Logical Maximum (255)
+            0x95, 0x01,             //  Report Count (1)
+            0x81, 0x02,             //  Input (Data, Variable, Absolute)
+        };
+        descriptor.insert(descriptor.end(), vendor.begin(), vendor.end());
+    }
+    descriptor.push_back(0xC0);     //End Collection
+    return descriptor;
+}
+
+static std::vector<UInt8> vendorReportDescriptor(){
+    return {
+        0x06, 0x00, 0xFF,           //Usage Page (Vendor Defined 0xFF00)
+        0x09, 0x01,                 //Usage (0x01)
+        0xA1, 0x01,                 //Collection (Application)
+        0x85, 0x01,                 //  Report ID (1)
+        0x09, 0x02,                 //  Usage (0x02)
+        0x15, 0x00,                 //  Logical Minimum (0)
+        0x26, 0xFF, 0x00,           //  Logical Maximum (255)
+        0x75, 0x08,                 //  Report Size (8)
+        0x95, 0x07,                 //  Report Count (7)
+        0x81, 0x02,                 //  Input (Data, Variable, Absolute)
+        0xC0                        //End Collection
+    };
+}
+
+static std::vector<UInt8> keyReport(UInt8 modifiers, std::vector<UInt8> keys){
+    std::vector<UInt8> report = { kKeyboardReportID, modifiers, 0 };
+    keys.resize(kKeySlots, 0);
+    report.insert(report.end(), keys.begin(), keys.end());
+    return report;
+}
+
+static std::vector<UInt8> rolloverReport(){
+    return keyReport(0, std::vector<UInt8>(kKeySlots, kHIDUsage_KeyboardErrorRollOver));
+}
+
+static VoodooI2CHIDKeyboardResult process(VoodooI2CHIDKeyboard *keyboard, const std::vector<UInt8> &report){
+    return keyboard->process(report.data(), (UInt32)report.size());
+}
+
+static void diffsKeyState(){
+    std::vector<UInt8> bytes = keyboardReportDescriptor();
+    VoodooI2CHIDReportDescriptor descriptor;
+    CHECK(descriptor.parse(bytes.data(), (UInt32)bytes.size()));
+
+    VoodooI2CHIDKeyboard keyboard;
+    CHECK(keyboard.configure(&descriptor));
+    CHECK(keyboard.isKeysOnly());
+
+    CHECK_EQUAL(process(&keyboard, keyReport(0, { kUsageA })), kKeyboardReportChanged);
+    CHECK_EQUAL(process(&keyboard, keyReport(0, { kUsageA })), kKeyboardReportUnchanged);
+    CHECK_EQUAL(process(&keyboard, keyReport(0x02, { kUsageA, kUsageB })), kKeyboardReportChanged);
+
+    //The same keys in other slots are the same state
+    CHECK_EQUAL(process(&keyboard, keyReport(0x02, { kUsageB, kUsageA })), kKeyboardReportUnchanged);
+    CHECK_EQUAL(process(&keyboard, keyReport(0, {})), kKeyboardReportChanged);
+
+    CHECK_EQUAL(keyboard.reports, 5);
+    CHECK_EQUAL(keyboard.presses, 3);
+    CHECK_EQUAL(keyboard.releases, 3);
+    CHECK_EQUAL(keyboard.duplicates, 2);
+
+    //Reports with other data besides keys can't be dropped on an unchanged key state
+    bytes = keyboardReportDescriptor(true);
+    CHECK(descriptor.parse(bytes.data(), (UInt32)bytes.size()));
+    CHECK(keyboard.configure(&descriptor));
+    CHECK(!keyboard.isKeysOnly());
+}
+
+static void dropsRolloverReports(){
+    std::vector<UInt8> bytes = keyboardReportDescriptor();
+    VoodooI2CHIDReportDescriptor descriptor;
+    CHECK(descriptor.parse(bytes.data(), (UInt32)bytes.size()));
+
+    VoodooI2CHIDKeyboard keyboard;
+    CHECK(keyboard.configure(&descriptor));
+
+    CHECK_EQUAL(process(&keyboard, keyReport(0, { kUsageA, kUsageB })), kKeyboardReportChanged);
+    CHECK_EQUAL(process(&keyboard, rolloverReport()), kKeyboardReportRollover);
+    CHECK_EQUAL(keyboard.rolloverErrors, 1);
+    CHECK_EQUAL(keyboard.lastErrorUsage, kHIDUsage_KeyboardErrorRollOver);
+
+    //The held keys survive the phantom report, releasing one is the only change
+    CHECK_EQUAL(process(&keyboard, keyReport(0, { kUsageA, kUsageB })), kKeyboardReportUnchanged);
+    CHECK_EQUAL(process(&keyboard, keyReport(0, { kUsageA })), kKeyboardReportChanged);
+    CHECK_EQUAL(keyboard.releases, 1);
+}
+
+static UInt64 rolloversLogged(HIDDeviceRig *rig){
+    OSObject *value = rig->copyProperty("DiagnosticLog");
+    OSDictionary *log = OSDynamicCast(OSDictionary, value);
+    OSDictionary *code = log ? OSDynamicCast(OSDictionary, log->getObject("KeyboardRollover")) : NULL;
+    OSNumber *recorded = code ? OSDynamicCast(OSNumber, code->getObject("Recorded")) : NULL;
+    UInt64 result = recorded ? recorded->unsigned64BitValue() : ~0ULL;
+    if (value)
+        value->release();
+    return result;
+}
+
+static void matchesOnlyKeyboards(){
+    DesignWareBus bus;
+    HIDTargetConfig targetConfig;
+    targetConfig.reportDescriptor = vendorReportDescriptor();
+    HIDTarget target(targetConfig);
+    HIDDeviceRig rig(&bus, &target, kAddress);
+    rig.setProperty("MatchKeyboardsOnly", true);
+    CHECK(!rig.start());
+}
+
+static void deliversKeyChangesOnly(){
+    DesignWareBus bus;
+    HIDTargetConfig targetConfig;
+    targetConfig.reportDescriptor = keyboardReportDescriptor();
+    HIDTarget target(targetConfig);
+    HIDDeviceRig rig(&bus, &target, kAddress);
+    rig.setProperty("MatchKeyboardsOnly", true);
+    CHECK(rig.start());
+    HostSimulationWait(20000000);
+
+    std::vector<std::vector<UInt8>> stream = {
+        keyReport(0, { kUsageA }),
+        keyReport(0, { kUsageA }),
+        rolloverReport(),
+        keyReport(0, { kUsageA, kUsageC }),
+        keyReport(0, {}),
+    };
+    for (const std::vector<UInt8> &report : stream){
+        target.queueReport(report);
+        HostSimulationWait(4000000);
+    }
+    HostSimulationWait(20000000);
+
+    //The HID stack is handed the whole input buffer, the report is at the start of it
+    CHECK_EQUAL(rig.reports.size(), 3);
+    if (rig.reports.size() == 3){
+        CHECK(std::equal(stream[0].begin(), stream[0].end(), rig.reports[0].bytes.begin()));
+        CHECK(std::equal(stream[3].begin(), stream[3].end(), rig.reports[1].bytes.begin()));
+        CHECK(std::equal(stream[4].begin(), stream[4].end(), rig.reports[2].bytes.begin()));
+    }
+    CHECK_EQUAL(rig.statistic("Keyboard", "DuplicateReports"), 1);
+    CHECK_EQUAL(rig.statistic("Keyboard", "RolloverErrors"), 1);
+    CHECK_EQUAL(rolloversLogged(&rig), 1);
+
+    rig.stop();
+}
+
+//What the bitmap replaces: decode the report into modifier bits and a list of pressed
+//usages, then match every pressed usage against the previous report's list
+struct DecodedKeys {
+    UInt32 modifiers;
+    UInt8 count;
+    UInt32 usages[kKeySlots];
+};
+
+static void decodeKeys(const VoodooI2CHIDReportDescriptor *descriptor, const std::vector<UInt8> &report, DecodedKeys *keys){
+    UInt8 id;
+    UInt8 *data;
+    UInt32 dataLength;
+    keys->modifiers = 0;
+    keys->count = 0;
+    if (!descriptor->reportData((UInt8 *)report.data(), (UInt32)report.size(), &id, &data, &dataLength))
+        return;
+    for (int i = 0; i < descriptor->fieldCount; i++){
+        const VoodooI2CHIDField *field = &descriptor->fields[i];
+        if (field->reportType != kIOHIDReportTypeInput || field->usagePage != kHIDPage_KeyboardOrKeypad)
+            continue;
+        if (field->flags & kVoodooI2CHIDFieldVariable){
+            if (VoodooI2CHIDReportDescriptor::getUnsigned(data, dataLength, field))
+                keys->modifiers |= 1U << (field->usage & 7);
+            continue;
+        }
+        VoodooI2CHIDField slot = *field;
+        for (int j = 0; j < field->count && keys->count < kKeySlots; j++){
+            slot.bitOffset = field->bitOffset + j * field->bitSize;
+            SInt32 value = VoodooI2CHIDReportDescriptor::getValue(data, dataLength, &slot);
+            if (value > 0)
+                keys->usages[keys->count++] = field->usage + value;
+        }
+    }
+}
+
+static bool scanChanged(const DecodedKeys &previous, const DecodedKeys &current){
+    if (previous.modifiers != current.modifiers || previous.count != current.count)
+        return true;
+    for (int i = 0; i < current.count; i++){
+        bool found = false;
+        for (int j = 0; j < previous.count && !found; j++)
+            found = previous.usages[j] == current.usages[i];
+        if (!found)
+            return true;
+    }
+    return false;
+}
+
+//Overlapping key presses with shift now and then, and the repeats a device sends while keys are held
+static std::vector<std::vector<UInt8>> typingStream(unsigned int reports){
+    std::mt19937 random(33);
+    std::vector<std::vector<UInt8>> stream;
+    std::vector<UInt8> held;
+    UInt8 modifiers = 0;
+    while (stream.size() < reports){
+        unsigned int action = random() % 10;
+        UInt8 key = (UInt8)(kUsageA + random() % 36);
+        if (action < 4 && held.size() < 3 && std::find(held.begin(), held.end(), key) == held.end())
+            held.push_back(key);
+        else if (action < 8 && !held.empty())
+            held.erase(held.begin());
+        else if (action == 8)
+            modifiers ^= 0x02;
+        stream.push_back(keyReport(modifiers, held));
+    }
+    return stream;
+}
+
+static void benchmarkDiff(){
+    std::vector<UInt8> bytes = keyboardReportDescriptor();
+    VoodooI2CHIDReportDescriptor descriptor;
+    CHECK(descriptor.parse(bytes.data(), (UInt32)bytes.size()));
+    std::vector<std::vector<UInt8>> stream = typingStream(20000);
+
+    //Both ways agree on which reports change anything
+    VoodooI2CHIDKeyboard keyboard;
+    CHECK(keyboard.configure(&descriptor));
+    unsigned int disagreements = 0;
+    DecodedKeys previous, current;
+    decodeKeys(&descriptor, keyReport(0, {}), &previous);
+    for (const std::vector<UInt8> &report : stream){
+        bool changed = process(&keyboard, report) == kKeyboardReportChanged;
+        decodeKeys(&descriptor, report, &current);
+        if (changed != scanChanged(previous, current))
+            disagreements++;
+        previous = current;
+    }
+    CHECK_EQUAL(disagreements, 0);
+
+    //Best of several passes, per report
+    const int passes = 20;
+    double bitmapNs = 1e30, scanNs = 1e30;
+    volatile unsigned int sink = 0;
+    for (int pass = 0; pass < passes; pass++){
+        keyboard.configure(&descriptor);
+        Clock::time_point start = Clock::now();
+        for (const std::vector<UInt8> &report : stream)
+            sink += process(&keyboard, report);
+        double elapsed = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+        bitmapNs = std::min(bitmapNs, elapsed / stream.size());
+
+        DecodedKeys keys[2];
+        decodeKeys(&descriptor, keyReport(0, {}), &keys[0]);
+        start = Clock::now();
+        for (size_t i = 0; i < stream.size(); i++){
+            decodeKeys(&descriptor, stream[i], &keys[(i + 1) & 1]);
+            sink += scanChanged(keys[i & 1], keys[(i + 1) & 1]);
+        }
+        elapsed = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+        scanNs = std::min(scanNs, elapsed / stream.size());
+    }
+
+    printf("keyboard diff (ns/report, %zu reports, %llu changed)\n", stream.size(), (unsigned long long)(keyboard.reports - keyboard.duplicates));
+    printf("  usage bitmap     %7.1f\n", bitmapNs);
+    printf("  slot scan        %7.1f\n", scanNs);
+}
+
+int main(){
+    HostSimulationStart();
+
+    diffsKeyState();
+    dropsRolloverReports();
+    matchesOnlyKeyboards();
+    deliversKeyChangesOnly();
+    benchmarkDiff();
+    return hostTestResult("KeyboardTest");
+}
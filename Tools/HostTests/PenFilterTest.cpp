@@ -0,0 +1,250 @@
+//
+//  PenFilterTest.cpp
+//  VoodooI2CHID
+//
+//  Created on 10/19/26.
+//  Copyright © 2026 VoodooI2C contributors. All rights reserved.
+//
+//  Checks the pen filter on synthetic strokes: pressure and the tip switch
+//  pass through untouched, contact changes restart smoothing, predictions
+//  are extrapolated along the stroke and come out as a report of their own
+//  in the vendor-defined collection appended to the descriptor. Then starts
+//  the driver on the simulated bus and checks predictions reach the HID
+//  stack right behind the samples they were made from.
+//
+
+#include "HostTest.hpp"
+#include "HIDDeviceRig.hpp"
+
+#define kAddress 0x2c
+#define kPenReportID 2
+#define kPenReportLength 10
+#define kSamplePeriodUs 4000
+
+static std::vector<UInt8> penReportDescriptor(bool reportIDs = true){
+    std::vector<UInt8> descriptor = {
+        0x05, 0x0D,                 //Usage Page (Digitizer)
+        0x09, 0x02,                 //Usage (Pen)
+        0xA1, 0x01,                 //Collection (Application)
+        0x85, kPenReportID,         //  Report ID
+        0x09, 0x20,                 //  Usage (Stylus)
+        0xA1, 0x00,                 //  Collection (Physical)
+        0x09, 0x42,                 //    Usage (Tip Switch)
+        0x09, 0x32,                 //    Usage (In Range)
+        0x15, 0x00,                 //    Logical Minimum (0)
+        0x25, 0x01,                 //    Logical Maximum (1)
+        0x75, 0x01,                 //    Report Size (1)
+        0x95, 0x02,                 //    Report Count (2)
+        0x81, 0x02,                 //    Input (Data, Variable, Absolute)
+        0x95, 0x06,                 //    Report Count (6)
+        0x81, 0x03,                 //    Input (Constant)
+        0x05, 0x01,                 //    Usage Page (Generic Desktop)
+        0x09, 0x30,                 //    Usage (X)
+        0x26, 0xFF, 0x7F,           //    Logical Maximum (32767)
+        0x75, 0x10,                 //    Report Size (16)
+        0x95, 0x01,                 //    Report Count (1)
+        0x81, 0x02,                 //    Input (Data, Variable, Absolute)
+        0x09, 0x31,                 //    Usage (Y)
+        0x81, 0x02,                 //    Input (Data, Variable, Absolute)
+        0x05, 0x0D,                 //    Usage Page (Digitizer)
+        0x09, 0x30,                 //    Usage (Tip Pressure)
+        0x26, 0xFF, 0x0F,           //    Logical Maximum (4095)
+        0x81, 0x02,                 //    Input (Data, Variable, Absolute)
+        0x09, 0x3D,                 //    Usage (X Tilt)
+        0x09, 0x3E,                 //    Usage (Y Tilt)
+        0x15, 0xC4,                 //    Logical Minimum (-60)
+        0x25, 0x3C,                 //    Logical Maximum (60)
+        0x75, 0x08,                 //    Report Size (8)
+        0x95, 0x02,                 //    Report Count (2)
+        0x81, 0x02,                 //    Input (Data, Variable, Absolute)
+        0xC0,                       //  End Collection
+        0xC0                        //End Collection
+    };
+    if (!reportIDs)
+        descriptor.erase(descriptor.begin() + 6, descriptor.begin() + 8);
+    return descriptor;
+}
+
+struct PenSample {
+    bool tip;
+    bool inRange;
+    int x;
+    int y;
+    int pressure;
+};
+
+static std::vector<UInt8> penReport(const PenSample &sample){
+    return {
+        kPenReportID, (UInt8)((sample.tip ? 0x01 : 0) | (sample.inRange ? 0x02 : 0)),
+        (UInt8)sample.x, (UInt8)(sample.x >> 8), (UInt8)sample.y, (UInt8)(sample.y >> 8),
+        (UInt8)sample.pressure, (UInt8)(sample.pressure >> 8), 0, 0
+    };
+}
+
+static int readX(const std::vector<UInt8> &report){ return report[2] | report[3] << 8; }
+static int readPressure(const std::vector<UInt8> &report){ return report[6] | report[7] << 8; }
+
+static SInt32 predictedAxis(const UInt8 *predicted, int axis){
+    return (SInt32)(predicted[1 + 4 * axis] | predicted[2 + 4 * axis] << 8 | predicted[3 + 4 * axis] << 16 | (UInt32)predicted[4 + 4 * axis] << 24);
+}
+
+static void pressureAndTipPassThrough(){
+    std::vector<UInt8> bytes = penReportDescriptor();
+    VoodooI2CHIDReportDescriptor descriptor;
+    CHECK(descriptor.parse(bytes.data(), (UInt32)bytes.size()));
+
+    VoodooI2CHIDPenFilter filter;
+    CHECK(filter.configure(&descriptor, 64, 0));
+    CHECK(!filter.isPredicting());
+
+    //Jittery pressure comes out exactly as it went in while X is smoothed
+    UInt64 timeNs = 0;
+    int smoothedSteps = 0;
+    for (int i = 0; i < 50; i++){
+        PenSample sample = { true, true, 1000 + (i % 2) * 40, 2000, 1500 + (i % 3) * 300 };
+        std::vector<UInt8> report = penReport(sample);
+        CHECK(!filter.process(report.data(), (UInt32)report.size(), timeNs, NULL));
+        CHECK_EQUAL(readPressure(report), sample.pressure);
+        CHECK_EQUAL(report[1], 0x03);
+        if (i > 10 && readX(report) > 1000 && readX(report) < 1040)
+            smoothedSteps++;
+        timeNs += kSamplePeriodUs * 1000ULL;
+    }
+    CHECK(smoothedSteps > 30);
+
+    //The first sample in contact is where the tip actually came down, not blended with the hover before it
+    PenSample hover = { false, true, 5000, 5000, 0 };
+    for (int i = 0; i < 5; i++){
+        std::vector<UInt8> report = penReport(hover);
+        filter.process(report.data(), (UInt32)report.size(), timeNs, NULL);
+        timeNs += kSamplePeriodUs * 1000ULL;
+    }
+    PenSample down = { true, true, 6000, 5000, 100 };
+    std::vector<UInt8> report = penReport(down);
+    filter.process(report.data(), (UInt32)report.size(), timeNs, NULL);
+    CHECK_EQUAL(readX(report), 6000);
+}
+
+static void predictsAlongTheStroke(){
+    std::vector<UInt8> bytes = penReportDescriptor();
+    VoodooI2CHIDReportDescriptor descriptor;
+    CHECK(descriptor.parse(bytes.data(), (UInt32)bytes.size()));
+
+    VoodooI2CHIDPenFilter filter;
+    CHECK(filter.configure(&descriptor, kPenFilterWeightOne, 8000));
+    CHECK(filter.isPredicting());
+    UInt8 predictedID = filter.predictionReportID();
+    CHECK(predictedID != 0 && predictedID != kPenReportID);
+
+    //The appended collection parses as a vendor application of its own, and the pen is still found first
+    UInt8 appended[kPenPredictionDescriptorLength];
+    UInt32 appendedLength = filter.predictionDescriptor(appended, sizeof(appended));
+    CHECK_EQUAL(appendedLength, kPenPredictionDescriptorLength);
+    bytes.insert(bytes.end(), appended, appended + appendedLength);
+    VoodooI2CHIDReportDescriptor extended;
+    CHECK(extended.parse(bytes.data(), (UInt32)bytes.size()));
+    CHECK(extended.hasApplication(kPenPredictionUsagePage, kPenPredictionUsage));
+    CHECK_EQUAL(extended.reportLength(kIOHIDReportTypeInput, predictedID), kPenPredictionReportLength - 1);
+    const VoodooI2CHIDField *penX = extended.findField(kIOHIDReportTypeInput, kHIDPage_GenericDesktop, kHIDUsage_GD_X);
+    CHECK(penX && penX->reportID == kPenReportID);
+    CHECK(extended.findFieldInReport(kIOHIDReportTypeInput, predictedID, kHIDPage_GenericDesktop, kHIDUsage_GD_X) == NULL);
+
+    //25 units per ms: 8ms ahead is 200 units further along
+    UInt8 predicted[kPenPredictionReportLength];
+    UInt64 timeNs = 0;
+    int x = 1000;
+    int predictions = 0;
+    for (int i = 0; i < 40; i++){
+        std::vector<UInt8> report = penReport({ true, true, x, 3000, 800 });
+        bool havePrediction = filter.process(report.data(), (UInt32)report.size(), timeNs, predicted);
+        if (i == 0)
+            CHECK(!havePrediction);
+        if (havePrediction){
+            predictions++;
+            CHECK_EQUAL(predicted[0], predictedID);
+            CHECK_EQUAL(predicted[9] | predicted[10] << 8, 8000);
+            if (i >= 20){
+                CHECK(abs(predictedAxis(predicted, 0) - (x + 200)) <= 2);
+                CHECK_EQUAL(predictedAxis(predicted, 1), 3000);
+            }
+        }
+        x += 100;
+        timeNs += kSamplePeriodUs * 1000ULL;
+    }
+    CHECK_EQUAL(predictions, 39);
+    CHECK_EQUAL(filter.predictions, 39);
+
+    //Nothing is predicted while hovering, and predictions stay inside the pen's range
+    std::vector<UInt8> hover = penReport({ false, true, x, 3000, 0 });
+    CHECK(!filter.process(hover.data(), (UInt32)hover.size(), timeNs, predicted));
+    timeNs += kSamplePeriodUs * 1000ULL;
+    x = 32000;
+    for (int i = 0; i < 10; i++){
+        std::vector<UInt8> report = penReport({ true, true, x, 3000, 800 });
+        if (filter.process(report.data(), (UInt32)report.size(), timeNs, predicted))
+            CHECK(predictedAxis(predicted, 0) <= 32767);
+        x = std::min(x + 300, 32767);
+        timeNs += kSamplePeriodUs * 1000ULL;
+    }
+}
+
+static void predictionNeedsReportIDs(){
+    std::vector<UInt8> bytes = penReportDescriptor(false);
+    VoodooI2CHIDReportDescriptor descriptor;
+    CHECK(descriptor.parse(bytes.data(), (UInt32)bytes.size()));
+
+    VoodooI2CHIDPenFilter filter;
+    CHECK(!filter.configure(&descriptor, kPenFilterWeightOne, 8000));
+    CHECK(filter.configure(&descriptor, 128, 8000));
+    CHECK(!filter.isPredicting());
+}
+
+static void deliversPredictionsAfterSamples(){
+    DesignWareBus bus;
+    HIDTargetConfig targetConfig;
+    targetConfig.reportDescriptor = penReportDescriptor();
+    HIDTarget target(targetConfig);
+    HIDDeviceRig rig(&bus, &target, kAddress);
+    rig.setProperty("PenPredictionUs", (UInt32)8000);
+    CHECK(rig.start());
+    HostSimulationWait(20000000);
+
+    //The HID stack is handed the device's descriptor with the prediction collection on the end
+    CHECK_EQUAL(rig.device->ReportDesc->getLength(), targetConfig.reportDescriptor.size() + kPenPredictionDescriptorLength);
+    UInt8 predictedID = (UInt8)rig.statistic("PenFilter", "PredictionReportID");
+
+    int x = 1000;
+    for (int i = 0; i < 20; i++){
+        target.queueReport(penReport({ true, true, x, 3000, 800 }));
+        x += 100;
+        HostSimulationWait(kSamplePeriodUs * 1000ULL);
+    }
+    HostSimulationWait(20000000);
+
+    size_t samples = 0, predictions = 0;
+    for (size_t i = 0; i < rig.reports.size(); i++){
+        const std::vector<UInt8> &bytes = rig.reports[i].bytes;
+        if (bytes[0] == kPenReportID){
+            samples++;
+        } else if (bytes[0] == predictedID){
+            predictions++;
+            CHECK_EQUAL(bytes.size(), kPenPredictionReportLength);
+            CHECK(i > 0 && rig.reports[i - 1].bytes[0] == kPenReportID);
+        }
+    }
+    CHECK_EQUAL(samples, 20);
+    CHECK_EQUAL(predictions, 19);
+    CHECK_EQUAL(rig.statistic("PenFilter", "Predictions"), 19);
+
+    rig.stop();
+}
+
+int main(){
+    HostSimulationStart();
+
+    pressureAndTipPassThrough();
+    predictsAlongTheStroke();
+    predictionNeedsReportIDs();
+    deliversPredictionsAfterSamples();
+    return hostTestResult("PenFilterTest");
+}
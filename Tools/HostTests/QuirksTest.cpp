@@ -0,0 +1,133 @@
+//
+//  QuirksTest.cpp
+//  VoodooI2CHID
+//
+//  Created on 10/19/26.
+//  Copyright © 2026 VoodooI2C contributors. All rights reserved.
+//
+//  Checks the quirk table lookup: device entries are found, everything else
+//  falls back to the defaults, and the lookup gives the same answer at run
+//  time as at compile time. Then starts the driver on the simulated bus to
+//  check that a device that never signals reset gets its settle time, and
+//  that the read length override is clamped to what the device can send.
+//
+
+#include "HostTest.hpp"
+#include "HIDDeviceRig.hpp"
+
+#define kAddress 0x2c
+#define kMs 1000000ULL
+
+static void findsDeviceEntries(){
+    //Every device entry is found by its own IDs, unless an earlier entry already covers them
+    for (unsigned int i = 0; i < kVoodooI2CHIDQuirkCount - 1; i++){
+        const VoodooI2CHIDQuirkEntry &entry = kVoodooI2CHIDQuirkTable[i];
+        unsigned int index = VoodooI2CHIDQuirkIndex(entry.vendorID, entry.productID);
+        CHECK(index <= i);
+        CHECK(VoodooI2CHIDQuirkMatches(kVoodooI2CHIDQuirkTable[index], entry.vendorID, entry.productID));
+    }
+
+    //No device entry may be the same as the defaults, it would be dead weight
+    const VoodooI2CHIDQuirks &defaults = kVoodooI2CHIDQuirkTable[kVoodooI2CHIDQuirkCount - 1].quirks;
+    for (unsigned int i = 0; i < kVoodooI2CHIDQuirkCount - 1; i++){
+        const VoodooI2CHIDQuirks &quirks = kVoodooI2CHIDQuirkTable[i].quirks;
+        CHECK(quirks.resetDelayMs != defaults.resetDelayMs || quirks.waitForReset != defaults.waitForReset ||
+              quirks.resetSettleMs != defaults.resetSettleMs || quirks.maxInputLength != defaults.maxInputLength ||
+              quirks.multiReportDrain != defaults.multiReportDrain || quirks.pollIntervalMs != defaults.pollIntervalMs ||
+              quirks.relaxedDescriptor != defaults.relaxedDescriptor);
+    }
+
+    const VoodooI2CHIDQuirks &hantick = VoodooI2CHIDQuirksFor(0x0911, 0x5288);
+    CHECK(!hantick.waitForReset);
+    CHECK_EQUAL(hantick.resetSettleMs, 100);
+    CHECK_EQUAL(VoodooI2CHIDQuirksFor(0x2386, 0x3118).resetSettleMs, 100);
+
+    //Neighbouring IDs and the wildcard value itself get the defaults
+    volatile UInt16 vendorID = 0x0911, productID = 0x5289;
+    CHECK(&VoodooI2CHIDQuirksFor(vendorID, productID) == &defaults);
+    CHECK(&VoodooI2CHIDQuirksFor(0x2386, 0x5288) == &defaults);
+    CHECK(&VoodooI2CHIDQuirksFor(kVoodooI2CHIDQuirkAnyID, kVoodooI2CHIDQuirkAnyID) == &defaults);
+    CHECK_EQUAL(defaults.resetSettleMs, 0);
+    CHECK(!defaults.waitForReset);
+
+    //Folded at compile time, the lookup agrees with the one made at run time
+    constexpr unsigned int raydium = VoodooI2CHIDQuirkIndex(0x2386, 0x3118);
+    static_assert(raydium == 1, "Raydium 3118 must have its own entry");
+    vendorID = 0x2386;
+    productID = 0x3118;
+    CHECK_EQUAL(VoodooI2CHIDQuirkIndex(vendorID, productID), raydium);
+}
+
+static std::vector<UInt8> vendorReportDescriptor(){
+    return {
+        0x06, 0x00, 0xFF,           //Usage Page (Vendor Defined 0xFF00)
+        0x09, 0x01,                 //Usage (0x01)
+        0xA1, 0x01,                 //Collection (Application)
+        0x09, 0x02,                 //  Usage (0x02)
+        0x15, 0x00,                 //  Logical Minimum (0)
+        0x26, 0xFF, 0x00,           //  Logical Maximum (255)
+        0x75, 0x08,                 //  Report Size (8)
+        0x95, 0x07,                 //  Report Count (7)
+        0x81, 0x02,                 //  Input (Data, Variable, Absolute)
+        0xC0                        //End Collection
+    };
+}
+
+static UInt64 startNs(UInt16 vendorID, UInt16 productID, UInt64 *resetSettleMs){
+    DesignWareBus bus;
+    HIDTargetConfig targetConfig;
+    targetConfig.vendorID = vendorID;
+    targetConfig.productID = productID;
+    targetConfig.reportDescriptor = vendorReportDescriptor();
+    HIDTarget target(targetConfig);
+    HIDDeviceRig rig(&bus, &target, kAddress);
+
+    uint64_t startedAt = mach_absolute_time();
+    CHECK(rig.start());
+    uint64_t elapsedNs;
+    absolutetime_to_nanoseconds(mach_absolute_time() - startedAt, &elapsedNs);
+    *resetSettleMs = rig.statistic("Quirks", "ResetSettleMs");
+    CHECK_EQUAL(target.stats.resets, 1);
+
+    rig.stop();
+    return elapsedNs;
+}
+
+static void settlesAfterUnsignalledReset(){
+    UInt64 settleMs;
+    UInt64 defaultNs = startNs(0x1234, 0x5678, &settleMs);
+    CHECK_EQUAL(settleMs, 0);
+    UInt64 hantickNs = startNs(0x0911, 0x5288, &settleMs);
+    CHECK_EQUAL(settleMs, 100);
+    CHECK(hantickNs >= defaultNs + 100 * kMs);
+}
+
+static UInt64 inputReadLength(UInt32 maxInputLength){
+    DesignWareBus bus;
+    HIDTargetConfig targetConfig;
+    targetConfig.reportDescriptor = vendorReportDescriptor();
+    targetConfig.maxInputLength = 16;
+    HIDTarget target(targetConfig);
+    HIDDeviceRig rig(&bus, &target, kAddress);
+    rig.setProperty("QuirkMaxInputLength", maxInputLength);
+    rig.start();
+    UInt64 length = rig.statistic("Quirks", "InputReadLength");
+    rig.stop();
+    return length;
+}
+
+static void clampsInputLength(){
+    CHECK_EQUAL(inputReadLength(0), 16);
+    CHECK_EQUAL(inputReadLength(12), 12);
+    CHECK_EQUAL(inputReadLength(4096), 16);
+    CHECK_EQUAL(inputReadLength(1), 2);
+}
+
+int main(){
+    HostSimulationStart();
+
+    findsDeviceEntries();
+    settlesAfterUnsignalledReset();
+    clampsInputLength();
+    return hostTestResult("QuirksTest");
+}
@@ -0,0 +1,247 @@
+//
+//  TouchTransformTest.cpp
+//  VoodooI2CHID
+//
+//  Created on 10/19/26.
+//  Copyright © 2026 VoodooI2C contributors. All rights reserved.
+//
+//  Checks the touchscreen transform math: the orientation matrices, mapping
+//  of contacts through a rotation and a calibration matrix, clamping to the
+//  logical range, and that slots without an active contact are left alone.
+//  Then starts the driver on the simulated bus with a rotation and checks
+//  the transformed contacts reach the HID stack and are counted.
+//
+
+#include "HostTest.hpp"
+#include "HIDDeviceRig.hpp"
+
+#define kAddress 0x2c
+#define kTouchReportID 3
+#define kMaxX 4095
+#define kMaxY 2047
+
+#define kOne kTouchTransformOne
+
+static std::vector<UInt8> fingerCollection(){
+    return {
+        0x05, 0x0D,                 //  Usage Page (Digitizer)
+        0x09, 0x22,                 //  Usage (Finger)
+        0xA1, 0x02,                 //  Collection (Logical)
+        0x09, 0x42,                 //    Usage (Tip Switch)
+        0x09, 0x47,                 //    Usage (Confidence)
+        0x15, 0x00,                 //    Logical Minimum (0)
+        0x25, 0x01,                 //    Logical Maximum (1)
+        0x75, 0x01,                 //    Report Size (1)
+        0x95, 0x02,                 //    Report Count (2)
+        0x81, 0x02,                 //    Input (Data, Variable, Absolute)
+        0x95, 0x06,                 //    Report Count (6)
+        0x81, 0x03,                 //    Input (Constant)
+        0x05, 0x01,                 //    Usage Page (Generic Desktop)
+        0x09, 0x30,                 //    Usage (X)
+        0x26, 0xFF, 0x0F,           //    Logical Maximum (4095)
+        0x75, 0x10,                 //    Report Size (16)
+        0x95, 0x01,                 //    Report Count (1)
+        0x81, 0x02,                 //    Input (Data, Variable, Absolute)
+        0x09, 0x31,                 //    Usage (Y)
+        0x26, 0xFF, 0x07,           //    Logical Maximum (2047)
+        0x81, 0x02,                 //    Input (Data, Variable, Absolute)
+        0xC0                        //  End Collection
+    };
+}
+
+static std::vector<UInt8> touchscreenReportDescriptor(UInt8 application = 0x04){
+    std::vector<UInt8> descriptor = {
+        0x05, 0x0D,                 //Usage Page (Digitizer)
+        0x09, application,          //Usage (Touch Screen)
+        0xA1, 0x01,                 //Collection (Application)
+        0x85, kTouchReportID,       //  Report ID
+    };
+    std::vector<UInt8> finger = fingerCollection();
+    descriptor.insert(descriptor.end(), finger.begin(), finger.end());
+    descriptor.insert(descriptor.end(), finger.begin(), finger.end());
+    descriptor.push_back(0xC0);     //End Collection
+    return descriptor;
+}
+
+struct Contact {
+    bool tip;
+    bool confident;
+    int x;
+    int y;
+};
+
+static std::vector<UInt8> touchReport(const Contact &first, const Contact &second){
+    std::vector<UInt8> report = { kTouchReportID };
+    for (const Contact *contact : { &first, &second }){
+        report.push_back((UInt8)((contact->tip ? 0x01 : 0) | (contact->confident ? 0x02 : 0)));
+        report.push_back((UInt8)contact->x);
+        report.push_back((UInt8)(contact->x >> 8));
+        report.push_back((UInt8)contact->y);
+        report.push_back((UInt8)(contact->y >> 8));
+    }
+    return report;
+}
+
+static int readX(const std::vector<UInt8> &report, int contact){ return report[2 + 5 * contact] | report[3 + 5 * contact] << 8; }
+static int readY(const std::vector<UInt8> &report, int contact){ return report[4 + 5 * contact] | report[5 + 5 * contact] << 8; }
+
+static bool near(int actual, int expected){
+    return abs(actual - expected) <= 2;
+}
+
+static void orientationMatrices(){
+    SInt32 matrix[6];
+
+    VoodooI2CHIDTouchTransform::matrixForOrientation(0, false, false, matrix);
+    SInt32 identity[6] = { kOne, 0, 0, 0, kOne, 0 };
+    CHECK(memcmp(matrix, identity, sizeof(identity)) == 0);
+
+    //90 degrees clockwise: x' = 1 - y, y' = x
+    VoodooI2CHIDTouchTransform::matrixForOrientation(90, false, false, matrix);
+    SInt32 quarter[6] = { 0, -kOne, kOne, kOne, 0, 0 };
+    CHECK(memcmp(matrix, quarter, sizeof(quarter)) == 0);
+
+    //Half a turn is the same as flipping both axes, and a full set of flips undoes it
+    SInt32 flipped[6];
+    VoodooI2CHIDTouchTransform::matrixForOrientation(180, false, false, matrix);
+    VoodooI2CHIDTouchTransform::matrixForOrientation(0, true, true, flipped);
+    CHECK(memcmp(matrix, flipped, sizeof(flipped)) == 0);
+    VoodooI2CHIDTouchTransform::matrixForOrientation(180, true, true, matrix);
+    CHECK(memcmp(matrix, identity, sizeof(identity)) == 0);
+
+    //270 is 90 with both flips
+    VoodooI2CHIDTouchTransform::matrixForOrientation(270, false, false, matrix);
+    VoodooI2CHIDTouchTransform::matrixForOrientation(90, true, true, flipped);
+    CHECK(memcmp(matrix, flipped, sizeof(flipped)) == 0);
+}
+
+static void rotatesContacts(){
+    std::vector<UInt8> bytes = touchscreenReportDescriptor();
+    VoodooI2CHIDReportDescriptor descriptor;
+    CHECK(descriptor.parse(bytes.data(), (UInt32)bytes.size()));
+
+    SInt32 matrix[6];
+    VoodooI2CHIDTouchTransform::matrixForOrientation(90, false, false, matrix);
+    VoodooI2CHIDTouchTransform transform;
+    CHECK(transform.configure(&descriptor, matrix));
+
+    //Corners go to the rotated corners, in each axis's own range
+    std::vector<UInt8> report = touchReport({ true, true, kMaxX, 0 }, { true, true, 0, kMaxY });
+    transform.process(report.data(), (UInt32)report.size());
+    CHECK_EQUAL(readX(report, 0), kMaxX);
+    CHECK_EQUAL(readY(report, 0), kMaxY);
+    CHECK_EQUAL(readX(report, 1), 0);
+    CHECK_EQUAL(readY(report, 1), 0);
+
+    //A quarter of the way along both axes lands three quarters across and a quarter down
+    report = touchReport({ true, true, 1024, 512 }, { true, true, 2048, 1024 });
+    transform.process(report.data(), (UInt32)report.size());
+    CHECK(near(readX(report, 0), kMaxX * 3 / 4));
+    CHECK(near(readY(report, 0), kMaxY / 4));
+    CHECK(near(readX(report, 1), kMaxX / 2));
+    CHECK(near(readY(report, 1), kMaxY / 2));
+
+    CHECK_EQUAL(transform.frames, 2);
+    CHECK_EQUAL(transform.contacts, 4);
+}
+
+static void calibratesAndClamps(){
+    std::vector<UInt8> bytes = touchscreenReportDescriptor();
+    VoodooI2CHIDReportDescriptor descriptor;
+    CHECK(descriptor.parse(bytes.data(), (UInt32)bytes.size()));
+
+    //Stretch by two around the centre: the middle half of the panel covers the whole screen
+    SInt32 matrix[6] = { 2 * kOne, 0, -kOne / 2, 0, 2 * kOne, -kOne / 2 };
+    VoodooI2CHIDTouchTransform transform;
+    CHECK(transform.configure(&descriptor, matrix));
+
+    std::vector<UInt8> report = touchReport({ true, true, 3072, 1536 }, { true, true, 100, 2000 });
+    transform.process(report.data(), (UInt32)report.size());
+    CHECK(near(readX(report, 0), kMaxX));
+    CHECK(near(readY(report, 0), kMaxY));
+    CHECK_EQUAL(readX(report, 1), 0);
+    CHECK_EQUAL(readY(report, 1), kMaxY);
+
+    //The identity leaves the transform off
+    SInt32 identity[6] = { kOne, 0, 0, 0, kOne, 0 };
+    CHECK(!transform.configure(&descriptor, identity));
+}
+
+static void skipsInactiveSlots(){
+    std::vector<UInt8> bytes = touchscreenReportDescriptor();
+    VoodooI2CHIDReportDescriptor descriptor;
+    CHECK(descriptor.parse(bytes.data(), (UInt32)bytes.size()));
+
+    SInt32 matrix[6];
+    VoodooI2CHIDTouchTransform::matrixForOrientation(180, false, false, matrix);
+    VoodooI2CHIDTouchTransform transform;
+    CHECK(transform.configure(&descriptor, matrix));
+
+    //An empty second slot keeps its zeroes instead of being mapped to the far corner
+    std::vector<UInt8> report = touchReport({ true, true, 0, 0 }, { false, false, 0, 0 });
+    transform.process(report.data(), (UInt32)report.size());
+    CHECK_EQUAL(readX(report, 0), kMaxX);
+    CHECK_EQUAL(readY(report, 0), kMaxY);
+    CHECK_EQUAL(readX(report, 1), 0);
+    CHECK_EQUAL(readY(report, 1), 0);
+
+    //A contact the device flags as not confident (a palm) is also left as reported
+    report = touchReport({ true, false, 100, 100 }, { true, true, 100, 100 });
+    transform.process(report.data(), (UInt32)report.size());
+    CHECK_EQUAL(readX(report, 0), 100);
+    CHECK_EQUAL(readY(report, 0), 100);
+    CHECK(near(readX(report, 1), kMaxX - 100));
+    CHECK(near(readY(report, 1), kMaxY - 100));
+
+    CHECK_EQUAL(transform.frames, 2);
+    CHECK_EQUAL(transform.contacts, 2);
+}
+
+static void ignoresOtherDigitizers(){
+    std::vector<UInt8> bytes = touchscreenReportDescriptor(0x05);
+    VoodooI2CHIDReportDescriptor descriptor;
+    CHECK(descriptor.parse(bytes.data(), (UInt32)bytes.size()));
+
+    SInt32 matrix[6];
+    VoodooI2CHIDTouchTransform::matrixForOrientation(90, false, false, matrix);
+    VoodooI2CHIDTouchTransform transform;
+    CHECK(!transform.configure(&descriptor, matrix));
+}
+
+static void rotatesDeliveredReports(){
+    DesignWareBus bus;
+    HIDTargetConfig targetConfig;
+    targetConfig.reportDescriptor = touchscreenReportDescriptor();
+    HIDTarget target(targetConfig);
+    HIDDeviceRig rig(&bus, &target, kAddress);
+    rig.setProperty("TouchRotation", (UInt32)180);
+    CHECK(rig.start());
+    HostSimulationWait(20000000);
+
+    target.queueReport(touchReport({ true, true, 1000, 500 }, { false, false, 0, 0 }));
+    HostSimulationWait(20000000);
+
+    CHECK_EQUAL(rig.reports.size(), 1);
+    if (rig.reports.size() == 1){
+        const std::vector<UInt8> &delivered = rig.reports[0].bytes;
+        CHECK(near(readX(delivered, 0), kMaxX - 1000));
+        CHECK(near(readY(delivered, 0), kMaxY - 500));
+        CHECK_EQUAL(readX(delivered, 1), 0);
+    }
+    CHECK_EQUAL(rig.statistic("TouchTransformStats", "Frames"), 1);
+    CHECK_EQUAL(rig.statistic("TouchTransformStats", "Contacts"), 1);
+
+    rig.stop();
+}
+
+int main(){
+    HostSimulationStart();
+
+    orientationMatrices();
+    rotatesContacts();
+    calibratesAndClamps();
+    skipsInactiveSlots();
+    ignoresOtherDigitizers();
+    rotatesDeliveredReports();
+    return hostTestResult("TouchTransformTest");
+}
@@ -0,0 +1,233 @@
+//
+//  TouchpadModesTest.cpp
+//  VoodooI2CHID
+//
+//  Created on 10/19/26.
+//  Copyright © 2026 VoodooI2C contributors. All rights reserved.
+//
+//  Checks the Precision Touchpad policy: input mode selection is opt-in and
+//  only trusts the touch pad's own features, the input mode report turns on
+//  surface and button reporting, and the latency mode follows activity with
+//  the configured idle time. Then starts the driver on the simulated bus and
+//  follows the feature reports the device is sent through idle and touch.
+//
+
+#include "HostTest.hpp"
+#include "HIDDeviceRig.hpp"
+
+#define kAddress 0x2c
+#define kTouchReportID 1
+#define kInputModeReportID 3
+#define kLatencyReportID 5
+
+#define kIdleMs 50
+#define kMs 1000000ULL
+
+//A touch pad with one finger, its input mode report optionally carrying the selective reporting switches
+static std::vector<UInt8> touchpadReportDescriptor(bool switchesWithInputMode = true, UInt8 application = kPTPUsageTouchPad){
+    std::vector<UInt8> descriptor = {
+        0x05, 0x0D,                 //Usage Page (Digitizer)
+        0x09, application,          //Usage (Touch Pad)
+        0xA1, 0x01,                 //Collection (Application)
+        0x85, kTouchReportID,       //  Report ID
+        0x09, 0x22,                 //  Usage (Finger)
+        0xA1, 0x02,                 //  Collection (Logical)
+        0x09, 0x42,                 //    Usage (Tip Switch)
+        0x15, 0x00,                 //    Logical Minimum (0)
+        0x25, 0x01,                 //    Logical Maximum (1)
+        0x75, 0x01,                 //    Report Size (1)
+        0x95, 0x01,                 //    Report Count (1)
+        0x81, 0x02,                 //    Input (Data, Variable, Absolute)
+        0x95, 0x07,                 //    Report Count (7)
+        0x81, 0x03,                 //    Input (Constant)
+        0x05, 0x01,                 //    Usage Page (Generic Desktop)
+        0x09, 0x30,                 //    Usage (X)
+        0x26, 0xFF, 0x0F,           //    Logical Maximum (4095)
+        0x75, 0x10,                 //    Report Size (16)
+        0x81, 0x02,                 //    Input (Data, Variable, Absolute)
+        0x09, 0x31,                 //    Usage (Y)
+        0x81, 0x02,                 //    Input (Data, Variable, Absolute)
+        0xC0,                       //  End Collection
+        0x05, 0x0D,                 //  Usage Page (Digitizer)
+        0x85, kInputModeReportID,   //  Report ID
+        0x09, 0x52,                 //  Usage (Input Mode)
+        0x15, 0x00,                 //  Logical Minimum (0)
+        0x25, 0x0A,                 //  Logical Maximum (10)
+        0x75, 0x08,                 //  Report Size (8)
+        0x95, 0x01,                 //  Report Count (1)
+        0xB1, 0x02,                 //  Feature (Data, Variable, Absolute)
+    };
+    if (!switchesWithInputMode){
+        descriptor.push_back(0x85); //  Report ID (4)
+        descriptor.push_back(0x04);
+    }
+    std::vector<UInt8> rest = {
+        0x09, 0x57,                 //  Usage (Surface Switch)
+        0x09, 0x58,                 //  Usage (Button Switch)
+        0x25, 0x01,                 //  Logical Maximum (1)
+        0x75, 0x01,                 //  Report Size (1)
+        0x95, 0x02,                 //  Report Count (2)
+        0xB1, 0x02,                 //  Feature (Data, Variable, Absolute)
+        0x95, 0x06,                 //  Report Count (6)
+        0xB1, 0x03,                 //  Feature (Constant)
+        0x85, kLatencyReportID,     //  Report ID
+        0x09, 0x60,                 //  Usage (Latency Mode)
+        0x95, 0x01,                 //  Report Count (1)
+        0xB1, 0x02,                 //  Feature (Data, Variable, Absolute)
+        0x95, 0x07,                 //  Report Count (7)
+        0xB1, 0x03,                 //  Feature (Constant)
+        0xC0                        //End Collection
+    };
+    descriptor.insert(descriptor.end(), rest.begin(), rest.end());
+    return descriptor;
+}
+
+static std::vector<UInt8> touchReport(bool tip, int x, int y){
+    return { kTouchReportID, (UInt8)(tip ? 1 : 0), (UInt8)x, (UInt8)(x >> 8), (UInt8)y, (UInt8)(y >> 8) };
+}
+
+static void selectsTouchPadFeatures(){
+    std::vector<UInt8> bytes = touchpadReportDescriptor();
+    VoodooI2CHIDReportDescriptor descriptor;
+    CHECK(descriptor.parse(bytes.data(), (UInt32)bytes.size()));
+
+    //Input mode only when asked for, latency mode only with an idle time
+    VoodooI2CHIDTouchpadModes modes;
+    CHECK(!modes.configure(&descriptor, false, 0));
+    CHECK(modes.configure(&descriptor, false, kIdleMs));
+    CHECK(!modes.hasInputMode());
+    CHECK(modes.hasLatencyMode());
+    CHECK(modes.configure(&descriptor, true, 0));
+    CHECK(modes.hasInputMode());
+    CHECK(!modes.hasLatencyMode());
+
+    //Input mode 3 with surface and button reporting on in the same report
+    UInt8 reportID;
+    UInt8 buffer[kPTPMaxFeatureReport];
+    UInt16 length;
+    CHECK(modes.buildInputModeReport(&reportID, buffer, &length));
+    CHECK_EQUAL(reportID, kInputModeReportID);
+    CHECK_EQUAL(length, 2);
+    CHECK_EQUAL(buffer[0], kPTPInputModeTouchpad);
+    CHECK_EQUAL(buffer[1], 0x03);
+
+    //Switches in a report of their own are left to the device's defaults
+    bytes = touchpadReportDescriptor(false);
+    CHECK(descriptor.parse(bytes.data(), (UInt32)bytes.size()));
+    CHECK(modes.configure(&descriptor, true, kIdleMs));
+    CHECK(modes.buildInputModeReport(&reportID, buffer, &length));
+    CHECK_EQUAL(length, 1);
+    CHECK_EQUAL(buffer[0], kPTPInputModeTouchpad);
+
+    CHECK(modes.buildLatencyModeReport(kPTPLatencyHigh, &reportID, buffer, &length));
+    CHECK_EQUAL(reportID, kLatencyReportID);
+    CHECK_EQUAL(buffer[0], kPTPLatencyModeHigh);
+    CHECK(modes.buildLatencyModeReport(kPTPLatencyNormal, &reportID, buffer, &length));
+    CHECK_EQUAL(buffer[0], kPTPLatencyModeNormal);
+
+    //The same usages under a touch screen mean something else
+    bytes = touchpadReportDescriptor(true, 0x04);
+    CHECK(descriptor.parse(bytes.data(), (UInt32)bytes.size()));
+    CHECK(!modes.configure(&descriptor, true, kIdleMs));
+}
+
+static void followsActivity(){
+    std::vector<UInt8> bytes = touchpadReportDescriptor();
+    VoodooI2CHIDReportDescriptor descriptor;
+    CHECK(descriptor.parse(bytes.data(), (UInt32)bytes.size()));
+
+    VoodooI2CHIDTouchpadModes modes;
+    CHECK(modes.configure(&descriptor, true, kIdleMs));
+    UInt64 now = 1000 * kMs;
+    modes.reset(now);
+
+    //Touches keep it in normal latency, and the remaining idle time counts from the last one
+    UInt64 remainingNs;
+    CHECK(!modes.activity(now + 10 * kMs));
+    CHECK(!modes.idle(now + 40 * kMs, &remainingNs));
+    CHECK_EQUAL(remainingNs, 20 * kMs);
+    CHECK(modes.idle(now + 60 * kMs, &remainingNs));
+
+    //Once switched, idling again asks for nothing and the next touch switches back
+    modes.modeChanged(kPTPLatencyHigh, now + 60 * kMs, 300000);
+    CHECK(!modes.idle(now + 500 * kMs, &remainingNs));
+    CHECK_EQUAL(remainingNs, 0);
+    CHECK(modes.activity(now + 500 * kMs));
+    modes.modeChanged(kPTPLatencyNormal, now + 501 * kMs, 900000);
+
+    CHECK_EQUAL(modes.latencySwitches, 2);
+    CHECK_EQUAL(modes.maxSwitchNs, 900000);
+    CHECK_EQUAL(modes.timeInMode(kPTPLatencyNormal, now + 600 * kMs), 159 * kMs);
+    CHECK_EQUAL(modes.timeInMode(kPTPLatencyHigh, now + 600 * kMs), 441 * kMs);
+
+    //A reset puts the device back in normal latency without counting a switch
+    modes.modeChanged(kPTPLatencyHigh, now + 600 * kMs, 0);
+    modes.reset(now + 700 * kMs);
+    CHECK(!modes.activity(now + 700 * kMs));
+    CHECK_EQUAL(modes.latencySwitches, 3);
+    CHECK_EQUAL(modes.timeInMode(kPTPLatencyHigh, now + 800 * kMs), 541 * kMs);
+}
+
+static std::vector<UInt8> latencyFeature(const HIDTarget &target){
+    return target.feature(kLatencyReportID);
+}
+
+static void switchesTheDevice(){
+    DesignWareBus bus;
+    HIDTargetConfig targetConfig;
+    targetConfig.reportDescriptor = touchpadReportDescriptor();
+    HIDTarget target(targetConfig);
+    HIDDeviceRig rig(&bus, &target, kAddress);
+    rig.setProperty("TouchpadInputMode", true);
+    rig.setProperty("TouchpadIdleLatencyMs", (UInt32)kIdleMs);
+    CHECK(rig.start());
+
+    std::vector<UInt8> inputMode = target.feature(kInputModeReportID);
+    CHECK(inputMode.size() == 2 && inputMode[0] == kPTPInputModeTouchpad && inputMode[1] == 0x03);
+    CHECK(latencyFeature(target).empty());
+
+    //Idle past the timeout goes to high latency
+    HostSimulationWait(2 * kIdleMs * kMs);
+    CHECK(latencyFeature(target) == std::vector<UInt8>({ kPTPLatencyModeHigh }));
+    CHECK_EQUAL(rig.statistic("TouchpadModes", "LatencySwitches"), 1);
+
+    //A touch switches back after it's delivered, and touches keep it there
+    for (int i = 0; i < 10; i++){
+        target.queueReport(touchReport(true, 100 + i, 200));
+        HostSimulationWait(10 * kMs);
+        CHECK(latencyFeature(target) == std::vector<UInt8>({ kPTPLatencyModeNormal }));
+    }
+    CHECK_EQUAL(rig.reports.size(), 10);
+    CHECK_EQUAL(rig.statistic("TouchpadModes", "LatencySwitches"), 2);
+
+    HostSimulationWait(2 * kIdleMs * kMs);
+    CHECK(latencyFeature(target) == std::vector<UInt8>({ kPTPLatencyModeHigh }));
+    CHECK_EQUAL(rig.statistic("TouchpadModes", "LatencySwitches"), 3);
+
+    rig.stop();
+}
+
+static void leavesMouseModeAlone(){
+    DesignWareBus bus;
+    HIDTargetConfig targetConfig;
+    targetConfig.reportDescriptor = touchpadReportDescriptor();
+    HIDTarget target(targetConfig);
+    HIDDeviceRig rig(&bus, &target, kAddress);
+    CHECK(rig.start());
+    HostSimulationWait(2 * kIdleMs * kMs);
+
+    CHECK(target.feature(kInputModeReportID).empty());
+    CHECK(latencyFeature(target).empty());
+
+    rig.stop();
+}
+
+int main(){
+    HostSimulationStart();
+
+    selectsTouchPadFeatures();
+    followsActivity();
+    switchesTheDevice();
+    leavesMouseModeAlone();
+    return hostTestResult("TouchpadModesTest");
+}
@@ -0,0 +1,240 @@
+//
+//  TransferSchedulerTest.cpp
+//  VoodooI2CHID
+//
+//  Created on 10/19/26.
+//  Copyright © 2026 VoodooI2C contributors. All rights reserved.
+//
+//  Checks the transfer scheduler's arbitration (priority classes, FIFO order
+//  within a class, the starvation limit) against a mocked controller, then
+//  simulates a pen, a touchscreen and a device issuing bursts of feature
+//  writes on one bus and compares input tail latency with plain
+//  arrival-order access to the controller.
+//
+
+#include "HostTest.hpp"
+#include "HostController.hpp"
+#include "VoodooI2CHIDTransferScheduler.hpp"
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+typedef std::chrono::steady_clock Clock;
+
+static thread_local Clock::time_point busGrantedAt;
+
+//Records the order transfers reach the controller. A transfer to the blocker address holds the bus until released.
+class GatedBus : public HostBus {
+public:
+    enum : UInt16 { kBlocker = 0x10 };
+
+    std::mutex lock;
+    std::condition_variable changed;
+    bool held = true;
+    std::vector<UInt16> order;
+
+    IOReturn transfer(VoodooI2CControllerDriver *controller, VoodooI2CControllerBusMessage *messages, int number) override {
+        std::unique_lock<std::mutex> guard(this->lock);
+        this->order.push_back(messages[0].address);
+        this->changed.notify_all();
+        if (messages[0].address == kBlocker)
+            this->changed.wait(guard, [this]{ return !this->held; });
+        return kIOReturnSuccess;
+    }
+
+    void waitForTransfers(size_t count){
+        std::unique_lock<std::mutex> guard(this->lock);
+        this->changed.wait(guard, [this, count]{ return this->order.size() >= count; });
+    }
+
+    void release(){
+        std::lock_guard<std::mutex> guard(this->lock);
+        this->held = false;
+        this->changed.notify_all();
+    }
+};
+
+static void submit(VoodooI2CHIDTransferScheduler *scheduler, VoodooI2CHIDTransferClass transferClass, UInt16 address){
+    UInt8 byte = 0;
+    VoodooI2CControllerBusMessage message = { address, &byte, 0, 1 };
+    scheduler->transfer(transferClass, &message, 1);
+}
+
+//Starts each transfer in turn and gives it time to queue behind the blocker before the next one
+static std::vector<UInt16> arbitrate(VoodooI2CHIDTransferClass blockerClass, const std::vector<std::pair<VoodooI2CHIDTransferClass, UInt16>> &waiters, OSDictionary **stats){
+    GatedBus bus;
+    VoodooI2CControllerDriver *controller = HostControllerCreate(&bus);
+    VoodooI2CHIDTransferScheduler *scheduler = VoodooI2CHIDTransferScheduler::acquire(controller);
+
+    std::vector<std::thread> threads;
+    threads.emplace_back(submit, scheduler, blockerClass, GatedBus::kBlocker);
+    bus.waitForTransfers(1);
+    for (const auto &waiter : waiters){
+        threads.emplace_back(submit, scheduler, waiter.first, waiter.second);
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+
+    bus.release();
+    for (std::thread &thread : threads)
+        thread.join();
+
+    *stats = scheduler->copyStatistics();
+    scheduler->relinquish();
+    controller->release();
+    return bus.order;
+}
+
+static UInt64 classStatistic(OSDictionary *stats, const char *transferClass, const char *key){
+    OSDictionary *classStats = OSDynamicCast(OSDictionary, stats->getObject(transferClass));
+    OSNumber *number = classStats ? OSDynamicCast(OSNumber, classStats->getObject(key)) : NULL;
+    return number ? number->unsigned64BitValue() : ~0ULL;
+}
+
+static void testPriorityOrder(){
+    OSDictionary *stats;
+    std::vector<UInt16> order = arbitrate(kVoodooI2CHIDTransferManagement, {
+        { kVoodooI2CHIDTransferManagement, 0x20 },
+        { kVoodooI2CHIDTransferOutput, 0x30 },
+        { kVoodooI2CHIDTransferInput, 0x40 },
+        { kVoodooI2CHIDTransferInput, 0x41 },
+    }, &stats);
+
+    std::vector<UInt16> expected = { GatedBus::kBlocker, 0x40, 0x41, 0x30, 0x20 };
+    CHECK(order == expected);
+    CHECK_EQUAL(classStatistic(stats, "Input", "Transfers"), 2);
+    CHECK_EQUAL(classStatistic(stats, "Output", "Transfers"), 1);
+    CHECK_EQUAL(classStatistic(stats, "Management", "Transfers"), 2);
+    CHECK_EQUAL(classStatistic(stats, "Management", "StarvationGrants"), 0);
+    stats->release();
+}
+
+static void testStarvationLimit(){
+    std::vector<std::pair<VoodooI2CHIDTransferClass, UInt16>> waiters = { { kVoodooI2CHIDTransferManagement, 0x20 } };
+    for (UInt16 i = 0; i < kVoodooI2CHIDTransferStarvationLimit + 2; i++)
+        waiters.push_back({ kVoodooI2CHIDTransferInput, (UInt16)(0x41 + i) });
+
+    OSDictionary *stats;
+    std::vector<UInt16> order = arbitrate(kVoodooI2CHIDTransferInput, waiters, &stats);
+
+    //Passed over by four inputs, then granted ahead of the rest
+    std::vector<UInt16> expected = { GatedBus::kBlocker, 0x41, 0x42, 0x43, 0x44, 0x20, 0x45, 0x46 };
+    CHECK(order == expected);
+    CHECK_EQUAL(classStatistic(stats, "Management", "StarvationGrants"), 1);
+    CHECK_EQUAL(classStatistic(stats, "Input", "StarvationGrants"), 0);
+    stats->release();
+}
+
+//Holds the bus for the time a transfer of this length takes at 400 kHz
+class TimedBus : public HostBus {
+public:
+    IOReturn transfer(VoodooI2CControllerDriver *controller, VoodooI2CControllerBusMessage *messages, int number) override {
+        busGrantedAt = Clock::now();
+        unsigned int bytes = 0;
+        for (int i = 0; i < number; i++)
+            bytes += 1 + messages[i].length;
+        std::this_thread::sleep_for(std::chrono::microseconds(bytes * 9 * 1000000 / 400000));
+        return kIOReturnSuccess;
+    }
+};
+
+//What every device did before the scheduler: call into the controller in arrival order
+class ArrivalOrderBus {
+public:
+    ArrivalOrderBus(VoodooI2CControllerDriver *controller) : controller(controller) {}
+
+    void transfer(VoodooI2CControllerBusMessage *messages, int number){
+        std::unique_lock<std::mutex> guard(this->lock);
+        unsigned long ticket = this->nextTicket++;
+        this->turn.wait(guard, [this, ticket]{ return this->serving == ticket; });
+        guard.unlock();
+
+        this->controller->transferI2C(messages, number);
+
+        guard.lock();
+        this->serving++;
+        this->turn.notify_all();
+    }
+
+private:
+    VoodooI2CControllerDriver *controller;
+    std::mutex lock;
+    std::condition_variable turn;
+    unsigned long nextTicket = 0;
+    unsigned long serving = 0;
+};
+
+struct LoadResult {
+    std::vector<unsigned long long> inputWaitUs;
+    std::vector<unsigned long long> outputWaitUs;
+};
+
+static void runLoad(bool useScheduler, unsigned int milliseconds, LoadResult *result){
+    TimedBus bus;
+    VoodooI2CControllerDriver *controller = HostControllerCreate(&bus);
+    VoodooI2CHIDTransferScheduler *scheduler = VoodooI2CHIDTransferScheduler::acquire(controller);
+    ArrivalOrderBus arrivalOrder(controller);
+
+    std::mutex resultLock;
+    Clock::time_point end = Clock::now() + std::chrono::milliseconds(milliseconds);
+
+    auto device = [&](VoodooI2CHIDTransferClass transferClass, unsigned int periodUs, UInt16 length, unsigned int offsetUs){
+        std::vector<UInt8> buffer(length);
+        VoodooI2CControllerBusMessage message = { 0x2c, buffer.data(), (UInt16)(transferClass == kVoodooI2CHIDTransferInput ? I2C_M_RD : 0), length };
+        Clock::time_point next = Clock::now() + std::chrono::microseconds(offsetUs);
+        while (next < end){
+            std::this_thread::sleep_until(next);
+            next += std::chrono::microseconds(periodUs);
+
+            Clock::time_point queuedAt = Clock::now();
+            if (useScheduler)
+                scheduler->transfer(transferClass, &message, 1);
+            else
+                arrivalOrder.transfer(&message, 1);
+            unsigned long long waitUs = std::chrono::duration_cast<std::chrono::microseconds>(busGrantedAt - queuedAt).count();
+
+            std::lock_guard<std::mutex> guard(resultLock);
+            (transferClass == kVoodooI2CHIDTransferInput ? result->inputWaitUs : result->outputWaitUs).push_back(waitUs);
+        }
+    };
+
+    std::vector<std::thread> threads;
+    //240 Hz pen and 120 Hz touchscreen reports
+    threads.emplace_back(device, kVoodooI2CHIDTransferInput, 4167, 32, 0);
+    threads.emplace_back(device, kVoodooI2CHIDTransferInput, 8333, 64, 1000);
+    //A user client pushing a burst of four 40 byte feature reports every 50ms
+    for (unsigned int i = 0; i < 4; i++)
+        threads.emplace_back(device, kVoodooI2CHIDTransferOutput, 50000, 40, 2000 + i * 10);
+
+    for (std::thread &thread : threads)
+        thread.join();
+
+    scheduler->relinquish();
+    controller->release();
+}
+
+static void testInputTailLatency(){
+    LoadResult arrival, scheduled;
+    runLoad(false, 2000, &arrival);
+    runLoad(true, 2000, &scheduled);
+
+    printf("input wait (us)        p50     p99     max   output p99\n");
+    printf("  arrival order    %7llu %7llu %7llu %10llu\n",
+           hostTestPercentile(arrival.inputWaitUs, 500), hostTestPercentile(arrival.inputWaitUs, 990),
+           hostTestPercentile(arrival.inputWaitUs, 1000), hostTestPercentile(arrival.outputWaitUs, 990));
+    printf("  scheduler        %7llu %7llu %7llu %10llu\n",
+           hostTestPercentile(scheduled.inputWaitUs, 500), hostTestPercentile(scheduled.inputWaitUs, 990),
+           hostTestPercentile(scheduled.inputWaitUs, 1000), hostTestPercentile(scheduled.outputWaitUs, 990));
+
+    CHECK(!scheduled.inputWaitUs.empty());
+    //An input read waits behind at most the transfer already on the bus instead of the whole burst
+    CHECK(hostTestPercentile(scheduled.inputWaitUs, 990) < hostTestPercentile(arrival.inputWaitUs, 990));
+}
+
+int main(){
+    testPriorityOrder();
+    testStarvationLimit();
+    testInputTailLatency();
+    return hostTestResult("TransferSchedulerTest");
+}
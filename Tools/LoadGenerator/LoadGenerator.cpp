@@ -0,0 +1,449 @@
+//
+//  LoadGenerator.cpp
+//  VoodooI2CHID
+//
+//  Created on 10/19/26.
+//  Copyright © 2026 VoodooI2C contributors. All rights reserved.
+//
+//  Host-side load generator for the VoodooI2CHIDDevice input path. Simulates N
+//  I2C-HID devices spread across M mocked controllers and drives each at a fixed
+//  report rate, reproducing the driver's structure:
+//    - each device's interrupt is handled on its own thread, standing in for the
+//      workloop, and is dropped while a read is in flight (IsReading)
+//    - every accepted interrupt starts a fresh reader thread (kernel_thread_start)
+//    - readers share their controller's bus through the transfer scheduler:
+//      one ticket queue per priority class, input before output before
+//      management, with a class granted the bus after being passed over
+//      kStarvationLimit times (VoodooI2CHIDTransferScheduler::transfer)
+//    - the bus is held for the time the transfer takes at the configured bus
+//      speed (transferI2C), optionally contended by output and management
+//      writes from each device
+//  Results are printed as JSON for regression tracking.
+//
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <vector>
+
+//Priority classes, highest priority first, as in VoodooI2CHIDTransferScheduler.hpp
+enum TransferClass {
+    kTransferInput = 0,
+    kTransferOutput,
+    kTransferManagement,
+    kTransferClassCount
+};
+
+static const char *kTransferClassNames[kTransferClassCount] = { "input", "output", "management" };
+
+//kVoodooI2CHIDTransferStarvationLimit
+#define kStarvationLimit 4
+
+//SET_REPORT: command register, opcode, data register, length, then the report
+#define kOutputOverheadBytes 8
+//SET_POWER: command register and opcode
+#define kManagementBytes 4
+
+struct Options {
+    unsigned int devices = 3;
+    unsigned int controllers = 1;
+    unsigned int rateHz = 125;
+    unsigned int reportSize = 32;
+    unsigned int busSpeedHz = 400000;
+    unsigned int dispatchUs = 20;
+    unsigned int outputHz = 0;
+    unsigned int managementHz = 0;
+    unsigned int starvationLimit = kStarvationLimit;
+    double seconds = 5;
+};
+
+struct ClassStats {
+    uint64_t transfers = 0;
+    uint64_t starvationGrants = 0;
+    std::vector<uint64_t> waits;
+};
+
+//Mirrors the driver's per-controller transfer scheduler, everything is guarded by lock
+struct Controller {
+    pthread_mutex_t lock;
+    pthread_cond_t released;
+    bool busy = false;
+
+    uint32_t nextTicket[kTransferClassCount] = {};
+    uint32_t servingTicket[kTransferClassCount] = {};
+    uint32_t passedOver[kTransferClassCount] = {};
+
+    ClassStats classes[kTransferClassCount];
+    uint64_t busyNs = 0;
+    uint64_t transfers = 0;
+};
+
+struct Device {
+    unsigned int index;
+    Controller *controller;
+    const Options *options;
+
+    pthread_t interruptThread;
+    pthread_t writeThread;
+    std::atomic<bool> isReading;
+
+    //Single report input register, a newer report replaces one nobody read
+    pthread_mutex_t registerLock;
+    bool pending = false;
+    uint64_t pendingAt = 0;
+
+    uint64_t interrupts = 0;
+    uint64_t droppedInterrupts = 0;
+    uint64_t overwritten = 0;
+    uint64_t threadErrors = 0;
+    std::atomic<uint64_t> reports;
+    std::atomic<uint64_t> emptyReads;
+    std::atomic<uint64_t> cpuNs;
+    std::vector<uint64_t> latencies;    //Only touched by the single reader in flight
+};
+
+static std::atomic<bool> running;
+
+static uint64_t clockNs(clockid_t clock){
+    struct timespec now;
+    clock_gettime(clock, &now);
+    return (uint64_t)now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
+
+static void sleepUntil(uint64_t deadlineNs){
+    struct timespec deadline;
+    deadline.tv_sec = deadlineNs / 1000000000ULL;
+    deadline.tv_nsec = deadlineNs % 1000000000ULL;
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, NULL) == EINTR){}
+}
+
+//Bits on the wire for a write, followed by a repeated-start read when there is one
+static uint64_t transferBits(unsigned int writeBytes, unsigned int readBytes){
+    unsigned int frames = 1 + writeBytes + (readBytes ? 1 + readBytes : 0);   //Address, register and data, address, data
+    return 2 + frames * 9;                                                      //Start and stop plus 8 bits and ACK per frame
+}
+
+static int nextClass(const Controller *controller, unsigned int starvationLimit){
+    //A starved class is served first, otherwise the highest priority waiter wins
+    for (int i = 0; i < kTransferClassCount; i++){
+        if (controller->nextTicket[i] != controller->servingTicket[i] && controller->passedOver[i] >= starvationLimit)
+            return i;
+    }
+    for (int i = 0; i < kTransferClassCount; i++){
+        if (controller->nextTicket[i] != controller->servingTicket[i])
+            return i;
+    }
+    return -1;
+}
+
+static void transferI2C(Device *device, TransferClass transferClass, unsigned int writeBytes, unsigned int readBytes){
+    Controller *controller = device->controller;
+    unsigned int starvationLimit = device->options->starvationLimit;
+    uint64_t busNs = transferBits(writeBytes, readBytes) * 1000000000ULL / device->options->busSpeedHz;
+    uint64_t queuedAt = clockNs(CLOCK_MONOTONIC);
+
+    //Take a ticket in this class and wait until the scheduler grants the bus to it
+    pthread_mutex_lock(&controller->lock);
+    uint32_t ticket = controller->nextTicket[transferClass]++;
+    while (controller->busy || nextClass(controller, starvationLimit) != transferClass || controller->servingTicket[transferClass] != ticket)
+        pthread_cond_wait(&controller->released, &controller->lock);
+
+    ClassStats *stats = &controller->classes[transferClass];
+    if (controller->passedOver[transferClass] >= starvationLimit)
+        stats->starvationGrants++;
+
+    controller->busy = true;
+    controller->servingTicket[transferClass]++;
+    controller->passedOver[transferClass] = 0;
+    for (int i = transferClass + 1; i < kTransferClassCount; i++){
+        if (controller->nextTicket[i] != controller->servingTicket[i])
+            controller->passedOver[i]++;
+    }
+    stats->transfers++;
+    stats->waits.push_back(clockNs(CLOCK_MONOTONIC) - queuedAt);
+    pthread_mutex_unlock(&controller->lock);
+
+    //The controller driver blocks the caller until the transfer completes
+    uint64_t start = clockNs(CLOCK_MONOTONIC);
+    sleepUntil(start + busNs);
+    uint64_t busyNs = clockNs(CLOCK_MONOTONIC) - start;
+
+    pthread_mutex_lock(&controller->lock);
+    controller->busy = false;
+    controller->busyNs += busyNs;
+    controller->transfers++;
+    pthread_cond_broadcast(&controller->released);
+    pthread_mutex_unlock(&controller->lock);
+}
+
+static void *readReport(void *context){
+    Device *device = (Device *)context;
+    uint64_t cpuStart = clockNs(CLOCK_THREAD_CPUTIME_ID);
+
+    transferI2C(device, kTransferInput, 2, device->options->reportSize);
+
+    pthread_mutex_lock(&device->registerLock);
+    bool havePending = device->pending;
+    uint64_t reportAt = device->pendingAt;
+    device->pending = false;
+    pthread_mutex_unlock(&device->registerLock);
+
+    if (havePending){
+        //Stand-in for the filters and handleReport
+        std::vector<uint8_t> buffer(device->options->reportSize, 0xA5);
+        if (device->options->dispatchUs){
+            uint64_t until = clockNs(CLOCK_THREAD_CPUTIME_ID) + device->options->dispatchUs * 1000ULL;
+            volatile uint32_t sink = 0;
+            while (clockNs(CLOCK_THREAD_CPUTIME_ID) < until)
+                for (uint8_t byte : buffer)
+                    sink += byte;
+        }
+        device->latencies.push_back(clockNs(CLOCK_MONOTONIC) - reportAt);
+        device->reports++;
+    } else {
+        device->emptyReads++;
+    }
+
+    device->cpuNs += clockNs(CLOCK_THREAD_CPUTIME_ID) - cpuStart;
+    device->isReading = false;
+    return NULL;
+}
+
+static void interruptOccured(Device *device){
+    uint64_t cpuStart = clockNs(CLOCK_THREAD_CPUTIME_ID);
+
+    if (device->isReading){
+        device->droppedInterrupts++;
+        return;
+    }
+
+    device->isReading = true;
+    device->interrupts++;
+
+    pthread_t reader;
+    pthread_attr_t attributes;
+    pthread_attr_init(&attributes);
+    pthread_attr_setdetachstate(&attributes, PTHREAD_CREATE_DETACHED);
+    if (pthread_create(&reader, &attributes, readReport, device) != 0){
+        device->threadErrors++;
+        device->isReading = false;
+    }
+    pthread_attr_destroy(&attributes);
+
+    device->cpuNs += clockNs(CLOCK_THREAD_CPUTIME_ID) - cpuStart;
+}
+
+static void *generateInterrupts(void *context){
+    Device *device = (Device *)context;
+    uint64_t periodNs = 1000000000ULL / device->options->rateHz;
+
+    //Stagger devices so they don't all fire on the same tick
+    uint64_t next = clockNs(CLOCK_MONOTONIC) + periodNs * device->index / 7;
+    while (running){
+        sleepUntil(next);
+        next += periodNs;
+
+        pthread_mutex_lock(&device->registerLock);
+        if (device->pending)
+            device->overwritten++;
+        device->pending = true;
+        device->pendingAt = clockNs(CLOCK_MONOTONIC);
+        pthread_mutex_unlock(&device->registerLock);
+
+        interruptOccured(device);
+    }
+    return NULL;
+}
+
+//Output reports and power management from the same device, competing with input for the bus
+static void *generateWrites(void *context){
+    Device *device = (Device *)context;
+    const Options *options = device->options;
+    uint64_t outputPeriodNs = options->outputHz ? 1000000000ULL / options->outputHz : 0;
+    uint64_t managementPeriodNs = options->managementHz ? 1000000000ULL / options->managementHz : 0;
+
+    uint64_t start = clockNs(CLOCK_MONOTONIC);
+    uint64_t nextOutput = outputPeriodNs ? start + outputPeriodNs * device->index / 5 : UINT64_MAX;
+    uint64_t nextManagement = managementPeriodNs ? start + managementPeriodNs * device->index / 3 : UINT64_MAX;
+    while (running){
+        bool output = nextOutput <= nextManagement;
+        sleepUntil(output ? nextOutput : nextManagement);
+        if (!running)
+            break;
+        if (output){
+            nextOutput += outputPeriodNs;
+            transferI2C(device, kTransferOutput, kOutputOverheadBytes + options->reportSize, 0);
+        } else {
+            nextManagement += managementPeriodNs;
+            transferI2C(device, kTransferManagement, kManagementBytes, 0);
+        }
+    }
+    return NULL;
+}
+
+static uint64_t percentile(const std::vector<uint64_t> &sorted, unsigned int perMille){
+    if (sorted.empty())
+        return 0;
+    return sorted[(sorted.size() - 1) * perMille / 1000];
+}
+
+static void usage(const char *name){
+    fprintf(stderr, "usage: %s [-n devices] [-m controllers] [-r rate_hz] [-s report_bytes]\n"
+                    "          [-b bus_hz] [-c dispatch_us] [-o output_hz] [-g management_hz]\n"
+                    "          [-l starvation_limit] [-d seconds]\n"
+                    "  devices are assigned to controllers round robin, JSON results go to stdout\n"
+                    "  output and management writes are per device and off by default\n", name);
+}
+
+int main(int argc, char **argv){
+    Options options;
+
+    int option;
+    while ((option = getopt(argc, argv, "n:m:r:s:b:c:o:g:l:d:h")) != -1){
+        switch (option){
+            case 'n': options.devices = (unsigned int)strtoul(optarg, NULL, 10); break;
+            case 'm': options.controllers = (unsigned int)strtoul(optarg, NULL, 10); break;
+            case 'r': options.rateHz = (unsigned int)strtoul(optarg, NULL, 10); break;
+            case 's': options.reportSize = (unsigned int)strtoul(optarg, NULL, 10); break;
+            case 'b': options.busSpeedHz = (unsigned int)strtoul(optarg, NULL, 10); break;
+            case 'c': options.dispatchUs = (unsigned int)strtoul(optarg, NULL, 10); break;
+            case 'o': options.outputHz = (unsigned int)strtoul(optarg, NULL, 10); break;
+            case 'g': options.managementHz = (unsigned int)strtoul(optarg, NULL, 10); break;
+            case 'l': options.starvationLimit = (unsigned int)strtoul(optarg, NULL, 10); break;
+            case 'd': options.seconds = strtod(optarg, NULL); break;
+            default:
+                usage(argv[0]);
+                return 2;
+        }
+    }
+    if (optind != argc || !options.devices || !options.controllers || !options.rateHz || !options.reportSize ||
+        !options.busSpeedHz || options.seconds <= 0){
+        usage(argv[0]);
+        return 2;
+    }
+
+    uint64_t expected = (uint64_t)(options.rateHz * options.seconds) + 16;
+    uint64_t perController = (options.devices + options.controllers - 1) / options.controllers;
+
+    std::vector<Controller> controllers(options.controllers);
+    for (Controller &controller : controllers){
+        pthread_mutex_init(&controller.lock, NULL);
+        pthread_cond_init(&controller.released, NULL);
+        controller.classes[kTransferInput].waits.reserve(expected * perController);
+        controller.classes[kTransferOutput].waits.reserve((uint64_t)(options.outputHz * options.seconds + 16) * perController);
+        controller.classes[kTransferManagement].waits.reserve((uint64_t)(options.managementHz * options.seconds + 16) * perController);
+    }
+
+    std::vector<Device> devices(options.devices);
+    for (unsigned int i = 0; i < options.devices; i++){
+        Device &device = devices[i];
+        device.index = i;
+        device.controller = &controllers[i % options.controllers];
+        device.options = &options;
+        device.isReading = false;
+        device.reports = 0;
+        device.emptyReads = 0;
+        device.cpuNs = 0;
+        device.latencies.reserve(expected);
+        pthread_mutex_init(&device.registerLock, NULL);
+    }
+
+    running = true;
+    uint64_t processCpuStart = clockNs(CLOCK_PROCESS_CPUTIME_ID);
+    uint64_t start = clockNs(CLOCK_MONOTONIC);
+    bool writes = options.outputHz || options.managementHz;
+    for (Device &device : devices){
+        if (pthread_create(&device.interruptThread, NULL, generateInterrupts, &device) != 0 ||
+            (writes && pthread_create(&device.writeThread, NULL, generateWrites, &device) != 0)){
+            perror("pthread_create");
+            return 1;
+        }
+    }
+
+    sleepUntil(start + (uint64_t)(options.seconds * 1e9));
+    running = false;
+    for (Device &device : devices){
+        pthread_join(device.interruptThread, NULL);
+        if (writes)
+            pthread_join(device.writeThread, NULL);
+    }
+    for (Device &device : devices)
+        while (device.isReading)
+            usleep(100);
+    uint64_t elapsedNs = clockNs(CLOCK_MONOTONIC) - start;
+    uint64_t processCpuNs = clockNs(CLOCK_PROCESS_CPUTIME_ID) - processCpuStart;
+
+    uint64_t reports = 0, interrupts = 0, dropped = 0, overwritten = 0, empty = 0, threadErrors = 0, cpuNs = 0;
+    std::vector<uint64_t> latencies;
+    for (Device &device : devices){
+        reports += device.reports;
+        interrupts += device.interrupts;
+        dropped += device.droppedInterrupts;
+        overwritten += device.overwritten;
+        empty += device.emptyReads;
+        threadErrors += device.threadErrors;
+        cpuNs += device.cpuNs;
+        latencies.insert(latencies.end(), device.latencies.begin(), device.latencies.end());
+        std::sort(device.latencies.begin(), device.latencies.end());
+    }
+    std::sort(latencies.begin(), latencies.end());
+    double seconds = elapsedNs / 1e9;
+
+    printf("{\n");
+    printf("  \"config\": {\"devices\": %u, \"controllers\": %u, \"rate_hz\": %u, \"report_bytes\": %u, "
+           "\"bus_hz\": %u, \"dispatch_us\": %u, \"output_hz\": %u, \"management_hz\": %u, \"starvation_limit\": %u, \"seconds\": %.3f},\n",
+           options.devices, options.controllers, options.rateHz, options.reportSize, options.busSpeedHz, options.dispatchUs,
+           options.outputHz, options.managementHz, options.starvationLimit, seconds);
+    printf("  \"reports\": %llu,\n", (unsigned long long)reports);
+    printf("  \"reports_per_second\": %.1f,\n", reports / seconds);
+    printf("  \"bytes_per_second\": %.1f,\n", (double)reports * options.reportSize / seconds);
+    printf("  \"interrupts\": %llu,\n", (unsigned long long)interrupts);
+    printf("  \"dropped_interrupts\": %llu,\n", (unsigned long long)dropped);
+    printf("  \"overwritten_reports\": %llu,\n", (unsigned long long)overwritten);
+    printf("  \"empty_reads\": %llu,\n", (unsigned long long)empty);
+    printf("  \"thread_errors\": %llu,\n", (unsigned long long)threadErrors);
+    printf("  \"cpu_ns_per_report\": %llu,\n", (unsigned long long)(reports ? cpuNs / reports : 0));
+    printf("  \"process_cpu_ns_per_report\": %llu,\n", (unsigned long long)(reports ? processCpuNs / reports : 0));
+    printf("  \"latency_ns\": {\"p50\": %llu, \"p99\": %llu, \"p999\": %llu, \"max\": %llu},\n",
+           (unsigned long long)percentile(latencies, 500), (unsigned long long)percentile(latencies, 990),
+           (unsigned long long)percentile(latencies, 999), (unsigned long long)(latencies.empty() ? 0 : latencies.back()));
+
+    printf("  \"controllers_detail\": [\n");
+    for (unsigned int i = 0; i < options.controllers; i++){
+        Controller &controller = controllers[i];
+        printf("    {\"controller\": %u, \"transfers\": %llu, \"bus_utilization\": %.4f, \"classes\": {", i,
+               (unsigned long long)controller.transfers, controller.busyNs / (double)elapsedNs);
+        for (int j = 0; j < kTransferClassCount; j++){
+            ClassStats &stats = controller.classes[j];
+            std::sort(stats.waits.begin(), stats.waits.end());
+            printf("%s\"%s\": {\"transfers\": %llu, \"starvation_grants\": %llu, \"wait_ns\": {\"p50\": %llu, \"p99\": %llu, \"max\": %llu}}",
+                   j ? ", " : "", kTransferClassNames[j], (unsigned long long)stats.transfers, (unsigned long long)stats.starvationGrants,
+                   (unsigned long long)percentile(stats.waits, 500), (unsigned long long)percentile(stats.waits, 990),
+                   (unsigned long long)(stats.waits.empty() ? 0 : stats.waits.back()));
+        }
+        printf("}}%s\n", i + 1 < options.controllers ? "," : "");
+    }
+    printf("  ],\n");
+
+    printf("  \"devices_detail\": [\n");
+    for (unsigned int i = 0; i < options.devices; i++){
+        Device &device = devices[i];
+        printf("    {\"device\": %u, \"controller\": %u, \"reports\": %llu, \"interrupts\": %llu, \"dropped_interrupts\": %llu, "
+               "\"overwritten_reports\": %llu, \"latency_ns\": {\"p50\": %llu, \"p99\": %llu, \"p999\": %llu}}%s\n",
+               i, i % options.controllers, (unsigned long long)device.reports.load(), (unsigned long long)device.interrupts,
+               (unsigned long long)device.droppedInterrupts, (unsigned long long)device.overwritten,
+               (unsigned long long)percentile(device.latencies, 500), (unsigned long long)percentile(device.latencies, 990),
+               (unsigned long long)percentile(device.latencies, 999), i + 1 < options.devices ? "," : "");
+    }
+    printf("  ]\n");
+    printf("}\n");
+    return 0;
+}
@@ -0,0 +1,315 @@
+//
+//  PenEvaluator.cpp
+//  VoodooI2CHID
+//
+//  Created on 10/19/26.
+//  Copyright © 2026 VoodooI2C contributors. All rights reserved.
+//
+//  Offline evaluation of the driver's pen filter on recorded strokes. Takes
+//  hid-recorder captures of the pen, e.g. on Linux
+//      hid-recorder /dev/hidraw0 > strokes.hid
+//      PenEvaluator strokes.hid
+//  and replays every pen report through VoodooI2CHIDPenFilter for each
+//  smoothing weight and prediction horizon asked for. For each setting it
+//  prints how far the delivered position trails the raw one, how much
+//  sample-to-sample jitter is left, and for predictions the error against
+//  where the pen really was that far ahead, next to the error of showing
+//  the delivered position that late without prediction. Distances are in
+//  the pen's logical units.
+//
+
+#include "VoodooI2CHIDPenFilter.hpp"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+struct Recording {
+    std::string name;
+    std::vector<UInt8> descriptor;
+    std::vector<UInt64> times;
+    std::vector<std::vector<UInt8>> reports;
+};
+
+struct Point {
+    double x;
+    double y;
+};
+
+//A replayed pen sample: raw and delivered position, and the prediction made from it if any
+struct Sample {
+    UInt64 timeUs;
+    unsigned int stroke;
+    Point raw;
+    Point delivered;
+    bool predicted;
+    UInt32 leadUs;
+    Point prediction;
+};
+
+static void usage(const char *name){
+    fprintf(stderr, "usage: %s [-w weights] [-p horizons] recording.hid ...\n"
+                    "  -w    comma separated smoothing weights out of 256 (default 256,192,128,64)\n"
+                    "  -p    comma separated prediction horizons in us (default 0,4000,8000,12000,16000)\n", name);
+}
+
+static bool parseList(const char *text, std::vector<UInt32> *values){
+    values->clear();
+    const char *p = text;
+    while (*p){
+        char *end;
+        unsigned long value = strtoul(p, &end, 0);
+        if (end == p)
+            return false;
+        values->push_back((UInt32)value);
+        p = *end == ',' ? end + 1 : end;
+        if (*end && *end != ',')
+            return false;
+    }
+    return !values->empty();
+}
+
+static std::vector<UInt8> parseBytes(const char *text, unsigned int count){
+    std::vector<UInt8> bytes;
+    const char *p = text;
+    while (bytes.size() < count){
+        char *end;
+        unsigned long value = strtoul(p, &end, 16);
+        if (end == p)
+            break;
+        bytes.push_back((UInt8)value);
+        p = end;
+    }
+    return bytes;
+}
+
+//hid-recorder output: "R: <length> <bytes>" is the report descriptor, "E: <sec>.<usec> <length> <bytes>" an input report
+static bool readRecording(const char *path, Recording *recording){
+    FILE *file = fopen(path, "r");
+    if (!file){
+        perror(path);
+        return false;
+    }
+    recording->name = path;
+
+    char line[16384];
+    while (fgets(line, sizeof(line), file)){
+        if (!strncmp(line, "R: ", 3) && recording->descriptor.empty()){
+            char *end;
+            unsigned long length = strtoul(line + 3, &end, 10);
+            recording->descriptor = parseBytes(end, (unsigned int)length);
+        } else if (!strncmp(line, "E: ", 3)){
+            unsigned long seconds, microseconds, length;
+            int consumed;
+            if (sscanf(line + 3, "%lu.%lu %lu%n", &seconds, &microseconds, &length, &consumed) != 3)
+                continue;
+            recording->times.push_back((UInt64)seconds * 1000000ULL + microseconds);
+            recording->reports.push_back(parseBytes(line + 3 + consumed, (unsigned int)length));
+        }
+    }
+    fclose(file);
+
+    if (recording->descriptor.empty()){
+        fprintf(stderr, "%s: no report descriptor\n", path);
+        return false;
+    }
+    return true;
+}
+
+//The same pen X/Y the filter picks
+static bool findPenAxes(const VoodooI2CHIDReportDescriptor *descriptor, const VoodooI2CHIDField **x, const VoodooI2CHIDField **y, const VoodooI2CHIDField **tip, const VoodooI2CHIDField **inRange){
+    *x = NULL;
+    while ((*x = descriptor->findField(kIOHIDReportTypeInput, kHIDPage_GenericDesktop, kHIDUsage_GD_X, *x))){
+        if ((*x)->application < descriptor->applicationCount &&
+            descriptor->applications[(*x)->application].usagePage == kHIDPage_Digitizer &&
+            descriptor->applications[(*x)->application].usage == kHIDUsage_Dig_Pen)
+            break;
+    }
+    if (!*x)
+        return false;
+    *y = descriptor->findFieldInReport(kIOHIDReportTypeInput, (*x)->reportID, kHIDPage_GenericDesktop, kHIDUsage_GD_Y);
+    *tip = descriptor->findFieldInReport(kIOHIDReportTypeInput, (*x)->reportID, kHIDPage_Digitizer, kHIDUsage_Dig_TipSwitch);
+    *inRange = descriptor->findFieldInReport(kIOHIDReportTypeInput, (*x)->reportID, kHIDPage_Digitizer, kHIDUsage_Dig_InRange);
+    return *y != NULL;
+}
+
+static SInt32 readPredicted(const UInt8 *report, int offset){
+    return (SInt32)(report[offset] | report[offset + 1] << 8 | report[offset + 2] << 16 | (UInt32)report[offset + 3] << 24);
+}
+
+//Replays the in-contact pen samples through the filter; strokes are split where the tip lifts or samples stop
+static std::vector<Sample> replay(const Recording &recording, const VoodooI2CHIDReportDescriptor *descriptor, UInt32 weight, UInt32 predictionUs){
+    const VoodooI2CHIDField *x, *y, *tip, *inRange;
+    std::vector<Sample> samples;
+    if (!findPenAxes(descriptor, &x, &y, &tip, &inRange))
+        return samples;
+
+    VoodooI2CHIDPenFilter filter;
+    bool enabled = filter.configure(descriptor, weight, predictionUs);
+
+    unsigned int stroke = 0;
+    bool inStroke = false;
+    UInt64 lastTimeUs = 0;
+    for (size_t i = 0; i < recording.reports.size(); i++){
+        std::vector<UInt8> report = recording.reports[i];
+        UInt8 id;
+        UInt8 *data;
+        UInt32 dataLength;
+        if (!descriptor->reportData(report.data(), (UInt32)report.size(), &id, &data, &dataLength) || id != x->reportID)
+            continue;
+
+        Sample sample;
+        sample.timeUs = recording.times[i];
+        sample.raw.x = VoodooI2CHIDReportDescriptor::getValue(data, dataLength, x);
+        sample.raw.y = VoodooI2CHIDReportDescriptor::getValue(data, dataLength, y);
+        bool touching = (!inRange || VoodooI2CHIDReportDescriptor::getUnsigned(data, dataLength, inRange)) &&
+                        (!tip || VoodooI2CHIDReportDescriptor::getUnsigned(data, dataLength, tip));
+
+        UInt8 predicted[kPenPredictionReportLength];
+        sample.predicted = enabled && filter.process(report.data(), (UInt32)report.size(), sample.timeUs * 1000ULL, predicted);
+        sample.delivered.x = VoodooI2CHIDReportDescriptor::getValue(data, dataLength, x);
+        sample.delivered.y = VoodooI2CHIDReportDescriptor::getValue(data, dataLength, y);
+        if (sample.predicted){
+            sample.prediction.x = readPredicted(predicted, 1);
+            sample.prediction.y = readPredicted(predicted, 5);
+            sample.leadUs = predicted[9] | predicted[10] << 8;
+        }
+
+        if (!touching){
+            inStroke = false;
+            continue;
+        }
+        if (!inStroke || sample.timeUs - lastTimeUs > kPenFilterMaxGapUs)
+            stroke++;
+        inStroke = true;
+        lastTimeUs = sample.timeUs;
+        sample.stroke = stroke;
+        samples.push_back(sample);
+    }
+    return samples;
+}
+
+static double distance(const Point &a, const Point &b){
+    return sqrt((a.x - b.x) * (a.x - b.x) + (a.y - b.y) * (a.y - b.y));
+}
+
+//Where the pen really was at timeUs, between the raw samples of the stroke around it
+static bool rawAt(const std::vector<Sample> &samples, size_t from, UInt64 timeUs, Point *point){
+    for (size_t i = from; i + 1 < samples.size() && samples[i + 1].stroke == samples[from].stroke; i++){
+        if (samples[i + 1].timeUs < timeUs)
+            continue;
+        double span = (double)(samples[i + 1].timeUs - samples[i].timeUs);
+        double t = span > 0 ? (double)(timeUs - samples[i].timeUs) / span : 0;
+        point->x = samples[i].raw.x + (samples[i + 1].raw.x - samples[i].raw.x) * t;
+        point->y = samples[i].raw.y + (samples[i + 1].raw.y - samples[i].raw.y) * t;
+        return true;
+    }
+    return false;
+}
+
+static double mean(const std::vector<double> &values){
+    double total = 0;
+    for (double value : values)
+        total += value;
+    return values.empty() ? 0 : total / values.size();
+}
+
+static double percentile(std::vector<double> values, unsigned int perMille){
+    if (values.empty())
+        return 0;
+    std::sort(values.begin(), values.end());
+    return values[(values.size() - 1) * perMille / 1000];
+}
+
+static void evaluate(const Recording &recording, const std::vector<UInt32> &weights, const std::vector<UInt32> &horizons){
+    VoodooI2CHIDReportDescriptor descriptor;
+    if (!descriptor.parse(recording.descriptor.data(), (UInt32)recording.descriptor.size())){
+        fprintf(stderr, "%s: unable to parse the report descriptor\n", recording.name.c_str());
+        return;
+    }
+
+    std::vector<Sample> baseline = replay(recording, &descriptor, kPenFilterWeightOne, 0);
+    unsigned int strokes = baseline.empty() ? 0 : baseline.back().stroke;
+    printf("%s: %zu samples in contact over %u strokes\n", recording.name.c_str(), baseline.size(), strokes);
+    if (baseline.empty())
+        return;
+
+    printf("  weight  ahead us   trail mean  jitter    predicted mean   p95    unpredicted mean   p95\n");
+    for (UInt32 weight : weights){
+        for (UInt32 horizon : horizons){
+            std::vector<Sample> samples = replay(recording, &descriptor, weight, horizon);
+
+            std::vector<double> trail, jitter, predictedError, unpredictedError;
+            for (size_t i = 0; i < samples.size(); i++){
+                trail.push_back(distance(samples[i].delivered, samples[i].raw));
+                if (i >= 2 && samples[i - 2].stroke == samples[i].stroke){
+                    Point second = {
+                        samples[i].delivered.x - 2 * samples[i - 1].delivered.x + samples[i - 2].delivered.x,
+                        samples[i].delivered.y - 2 * samples[i - 1].delivered.y + samples[i - 2].delivered.y
+                    };
+                    jitter.push_back(distance(second, { 0, 0 }));
+                }
+
+                Point actual;
+                if (samples[i].predicted && rawAt(samples, i, samples[i].timeUs + samples[i].leadUs, &actual)){
+                    predictedError.push_back(distance(samples[i].prediction, actual));
+                    unpredictedError.push_back(distance(samples[i].delivered, actual));
+                }
+            }
+
+            printf("  %6u  %8u   %10.1f  %6.1f", weight, horizon, mean(trail), mean(jitter));
+            if (predictedError.empty())
+                printf("                 -      -                  -      -\n");
+            else
+                printf("    %13.1f %6.1f   %16.1f %6.1f\n", mean(predictedError), percentile(predictedError, 950),
+                       mean(unpredictedError), percentile(unpredictedError, 950));
+        }
+    }
+}
+
+int main(int argc, char **argv){
+    std::vector<UInt32> weights = { 256, 192, 128, 64 };
+    std::vector<UInt32> horizons = { 0, 4000, 8000, 12000, 16000 };
+
+    int option;
+    while ((option = getopt(argc, argv, "w:p:")) != -1){
+        switch (option){
+            case 'w':
+                if (!parseList(optarg, &weights)){
+                    usage(argv[0]);
+                    return 2;
+                }
+                break;
+            case 'p':
+                if (!parseList(optarg, &horizons)){
+                    usage(argv[0]);
+                    return 2;
+                }
+                break;
+            default:
+                usage(argv[0]);
+                return 2;
+        }
+    }
+    if (optind >= argc){
+        usage(argv[0]);
+        return 2;
+    }
+
+    int status = 0;
+    for (int i = optind; i < argc; i++){
+        Recording recording;
+        if (!readRecording(argv[i], &recording)){
+            status = 1;
+            continue;
+        }
+        evaluate(recording, weights, horizons);
+    }
+    return status;
+}
@@ -0,0 +1,356 @@
+//
+//  TraceAnalyzer.cpp
+//  VoodooI2CHID
+//
+//  Created on 10/19/26.
+//  Copyright © 2026 VoodooI2C contributors. All rights reserved.
+//
+//  Offline analyzer for the EventTrace dumps published by VoodooI2CHIDDevice.
+//  Reads either the raw dump or ioreg text output containing it, e.g.
+//      ioreg -r -c VoodooI2CHIDDevice -k EventTrace -w0 > trace.txt
+//      TraceAnalyzer trace.txt
+//
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <map>
+#include <string>
+#include <vector>
+
+//Must match VoodooI2CHIDTrace.hpp
+#define kTraceMagic 0x54483249
+#define kTraceVersion 1
+
+enum {
+    kTraceInterrupt = 0,
+    kTraceReaderWake,
+    kTraceTransferStart,
+    kTraceTransferEnd,
+    kTraceLengthParsed,
+    kTraceDispatchStart,
+    kTraceDispatchEnd,
+    kTracePowerState,
+    kTraceResetStart,
+    kTraceResetComplete,
+    kTraceEventCount
+};
+
+#define kTransferInput 0
+
+#pragma pack(push, 1)
+struct TraceHeader {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t eventSize;
+    uint32_t count;
+    uint32_t lost;
+};
+#pragma pack(pop)
+
+struct TraceEvent {
+    uint64_t timestamp;
+    uint32_t report;
+    uint16_t event;
+    uint16_t arg;
+    uint32_t value;
+    uint32_t committed;
+};
+
+static_assert(sizeof(TraceHeader) == 16 && sizeof(TraceEvent) == 24, "dump layout changed");
+
+static const char *eventNames[kTraceEventCount] = {
+    "Interrupt",
+    "ReaderWake",
+    "TransferStart",
+    "TransferEnd",
+    "LengthParsed",
+    "DispatchStart",
+    "DispatchEnd",
+    "PowerState",
+    "ResetStart",
+    "ResetComplete"
+};
+
+enum {
+    kStageWake = 0,         //Interrupt -> ReaderWake
+    kStageQueue,            //ReaderWake -> first input TransferStart
+    kStageTransfer,         //Input TransferStart -> TransferEnd
+    kStageParse,            //TransferEnd -> LengthParsed
+    kStageFilter,           //LengthParsed -> DispatchStart
+    kStageDispatch,         //DispatchStart -> DispatchEnd
+    kStageTotal,            //Interrupt -> last DispatchEnd
+    kStageCount
+};
+
+static const char *stageNames[kStageCount] = {
+    "interrupt->wake",
+    "wake->transfer",
+    "transfer",
+    "transfer->parse",
+    "parse->dispatch",
+    "dispatch",
+    "total"
+};
+
+struct Report {
+    uint32_t number;
+    std::vector<TraceEvent> events;
+};
+
+static void usage(const char *name){
+    fprintf(stderr, "usage: %s [-t] [-s stall_ms] dump\n"
+                    "  -t    print every report's timeline\n"
+                    "  -s    flag reports slower than this end to end (default 20)\n", name);
+}
+
+static bool readFile(const char *path, std::vector<uint8_t> *out){
+    FILE *file = fopen(path, "rb");
+    if (!file)
+        return false;
+    uint8_t buffer[4096];
+    size_t got;
+    while ((got = fread(buffer, 1, sizeof(buffer), file)) > 0)
+        out->insert(out->end(), buffer, buffer + got);
+    fclose(file);
+    return true;
+}
+
+//ioreg prints OSData as <hex digits>, pull the first run that decodes to a trace header
+static bool decodeHex(const std::vector<uint8_t> &text, std::vector<uint8_t> *out){
+    size_t i = 0;
+    while (i < text.size()){
+        while (i < text.size() && text[i] != '<')
+            i++;
+        if (i == text.size())
+            return false;
+
+        out->clear();
+        size_t j = i + 1;
+        while (j + 1 < text.size() && isxdigit(text[j]) && isxdigit(text[j + 1])){
+            char digits[3] = {(char)text[j], (char)text[j + 1], 0};
+            out->push_back((uint8_t)strtoul(digits, NULL, 16));
+            j += 2;
+        }
+        if (j < text.size() && text[j] == '>' && out->size() >= sizeof(TraceHeader)){
+            uint32_t magic;
+            memcpy(&magic, out->data(), sizeof(magic));
+            if (magic == kTraceMagic)
+                return true;
+        }
+        i = j;
+    }
+    return false;
+}
+
+static uint64_t percentile(const std::vector<uint64_t> &sorted, unsigned int perMille){
+    if (sorted.empty())
+        return 0;
+    size_t index = (sorted.size() - 1) * perMille / 1000;
+    return sorted[index];
+}
+
+static void printUs(uint64_t ns){
+    printf(" %10llu.%01llu", (unsigned long long)(ns / 1000), (unsigned long long)(ns / 100 % 10));
+}
+
+static void printTimeline(const Report &report){
+    uint64_t base = report.events.front().timestamp;
+    printf("report %u\n", report.number);
+    for (const TraceEvent &event : report.events){
+        const char *name = event.event < kTraceEventCount ? eventNames[event.event] : "Unknown";
+        printf("  +%8llu us  %-14s arg %u value 0x%x\n", (unsigned long long)((event.timestamp - base) / 1000), name, event.arg, event.value);
+    }
+}
+
+int main(int argc, char **argv){
+    bool timelines = false;
+    uint64_t stallNs = 20ULL * 1000000ULL;
+
+    int option;
+    while ((option = getopt(argc, argv, "ts:")) != -1){
+        switch (option){
+            case 't':
+                timelines = true;
+                break;
+            case 's':
+                stallNs = strtoull(optarg, NULL, 10) * 1000000ULL;
+                break;
+            default:
+                usage(argv[0]);
+                return 2;
+        }
+    }
+    if (optind != argc - 1){
+        usage(argv[0]);
+        return 2;
+    }
+
+    std::vector<uint8_t> raw, dump;
+    if (!readFile(argv[optind], &raw)){
+        perror(argv[optind]);
+        return 1;
+    }
+
+    uint32_t magic = 0;
+    if (raw.size() >= sizeof(magic))
+        memcpy(&magic, raw.data(), sizeof(magic));
+    if (magic == kTraceMagic)
+        dump.swap(raw);
+    else if (!decodeHex(raw, &dump)){
+        fprintf(stderr, "%s: no trace dump found\n", argv[optind]);
+        return 1;
+    }
+
+    TraceHeader header;
+    memcpy(&header, dump.data(), sizeof(header));
+    if (header.version != kTraceVersion || header.eventSize != sizeof(TraceEvent)){
+        fprintf(stderr, "unsupported dump: version %u, event size %u\n", header.version, header.eventSize);
+        return 1;
+    }
+    size_t available = (dump.size() - sizeof(header)) / sizeof(TraceEvent);
+    if (header.count > available){
+        fprintf(stderr, "dump truncated: header says %u events, found %zu\n", header.count, available);
+        header.count = (uint32_t)available;
+    }
+
+    std::vector<TraceEvent> events(header.count);
+    if (header.count)
+        memcpy(events.data(), dump.data() + sizeof(header), header.count * sizeof(TraceEvent));
+
+    //Events sharing a report number belong to the same interrupt, the dump is oldest first
+    std::vector<Report> reports;
+    std::map<uint32_t, size_t> byNumber;
+    for (const TraceEvent &event : events){
+        std::map<uint32_t, size_t>::iterator found = byNumber.find(event.report);
+        if (found == byNumber.end()){
+            byNumber[event.report] = reports.size();
+            reports.push_back(Report());
+            reports.back().number = event.report;
+            found = byNumber.find(event.report);
+        }
+        reports[found->second].events.push_back(event);
+    }
+
+    printf("%u events, %u lost to wraparound, %zu reports\n", header.count, header.lost, reports.size());
+    if (events.empty())
+        return 0;
+
+    std::vector<uint64_t> stages[kStageCount];
+    unsigned int dropped = 0, failedTransfers = 0, stalls = 0, resets = 0, signalledResets = 0;
+    uint64_t maxResetNs = 0;
+    std::vector<std::string> findings;
+
+    for (const Report &report : reports){
+        uint64_t at[kTraceEventCount] = {0};
+        bool seen[kTraceEventCount] = {false};
+        uint64_t lastDispatchEnd = 0;
+        bool resetOpen = false;
+        uint64_t resetAt = 0;
+        char line[256];
+
+        for (const TraceEvent &event : report.events){
+            if (event.event >= kTraceEventCount)
+                continue;
+            switch (event.event){
+                case kTraceInterrupt:
+                    //A second interrupt record for the same report was dropped while reading
+                    if (event.value){
+                        dropped++;
+                        continue;
+                    }
+                    break;
+                case kTraceTransferStart:
+                    if (event.arg != kTransferInput || seen[kTraceTransferStart])
+                        continue;
+                    break;
+                case kTraceTransferEnd:
+                    if (event.value){
+                        failedTransfers++;
+                        snprintf(line, sizeof(line), "report %u: transfer class %u failed with 0x%08x", report.number, event.arg, event.value);
+                        findings.push_back(line);
+                    }
+                    if (event.arg != kTransferInput || seen[kTraceTransferEnd])
+                        continue;
+                    break;
+                case kTraceDispatchEnd:
+                    lastDispatchEnd = event.timestamp;
+                    break;
+                case kTraceResetStart:
+                    resets++;
+                    resetOpen = true;
+                    resetAt = event.timestamp;
+                    break;
+                case kTraceResetComplete:
+                    //Only recorded by devices that wait for the reset interrupt
+                    if (resetOpen){
+                        signalledResets++;
+                        maxResetNs = std::max(maxResetNs, event.timestamp - resetAt);
+                    }
+                    resetOpen = false;
+                    break;
+            }
+            if (!seen[event.event]){
+                seen[event.event] = true;
+                at[event.event] = event.timestamp;
+            }
+        }
+
+        if (seen[kTraceInterrupt] && seen[kTraceReaderWake])
+            stages[kStageWake].push_back(at[kTraceReaderWake] - at[kTraceInterrupt]);
+        if (seen[kTraceReaderWake] && seen[kTraceTransferStart])
+            stages[kStageQueue].push_back(at[kTraceTransferStart] - at[kTraceReaderWake]);
+        if (seen[kTraceTransferStart] && seen[kTraceTransferEnd])
+            stages[kStageTransfer].push_back(at[kTraceTransferEnd] - at[kTraceTransferStart]);
+        if (seen[kTraceTransferEnd] && seen[kTraceLengthParsed])
+            stages[kStageParse].push_back(at[kTraceLengthParsed] - at[kTraceTransferEnd]);
+        if (seen[kTraceLengthParsed] && seen[kTraceDispatchStart])
+            stages[kStageFilter].push_back(at[kTraceDispatchStart] - at[kTraceLengthParsed]);
+        if (seen[kTraceDispatchStart] && seen[kTraceDispatchEnd])
+            stages[kStageDispatch].push_back(at[kTraceDispatchEnd] - at[kTraceDispatchStart]);
+
+        if (seen[kTraceInterrupt] && lastDispatchEnd){
+            uint64_t total = lastDispatchEnd - at[kTraceInterrupt];
+            stages[kStageTotal].push_back(total);
+            if (total >= stallNs){
+                stalls++;
+                snprintf(line, sizeof(line), "report %u: stalled %llu us from interrupt to dispatch", report.number, (unsigned long long)(total / 1000));
+                findings.push_back(line);
+            }
+        } else if (seen[kTraceInterrupt] && seen[kTraceReaderWake] && !seen[kTraceDispatchStart] && report.number != reports.back().number){
+            //Empty reports legitimately stop after the length parse, anything earlier never finished
+            if (!seen[kTraceLengthParsed]){
+                snprintf(line, sizeof(line), "report %u: reader never parsed a length", report.number);
+                findings.push_back(line);
+            }
+        }
+
+        if (timelines)
+            printTimeline(report);
+    }
+
+    printf("\nstage latency (us)     samples         p50         p90         p99       p99.9         max\n");
+    for (int i = 0; i < kStageCount; i++){
+        std::vector<uint64_t> &samples = stages[i];
+        std::sort(samples.begin(), samples.end());
+        printf("%-20s %10zu", stageNames[i], samples.size());
+        printUs(percentile(samples, 500));
+        printUs(percentile(samples, 900));
+        printUs(percentile(samples, 990));
+        printUs(percentile(samples, 999));
+        printUs(samples.empty() ? 0 : samples.back());
+        printf("\n");
+    }
+
+    printf("\ndropped interrupts: %u\nfailed transfers: %u\nresets: %u (%u signalled completion, slowest %llu us)\nstalls over %llu ms: %u\n",
+           dropped, failedTransfers, resets, signalledResets, (unsigned long long)(maxResetNs / 1000), (unsigned long long)(stallNs / 1000000ULL), stalls);
+    for (const std::string &finding : findings)
+        printf("  %s\n", finding.c_str());
+
+    return 0;
+}
@@ -26,6 +26,11 @@ typedef struct {
     UInt8 *buffer;
     UInt16 flags;
     UInt16 length;
+    // Bus speed in Hz for this message along with its SCL high and low
+    // counts, 0 keeps the speed the controller is configured for
+    UInt32 speed;
+    UInt16 hcnt;
+    UInt16 lcnt;
 } VoodooI2CControllerBusMessage;
 
 typedef struct {
@@ -58,6 +63,8 @@ typedef struct {
     UInt32 transaction_buffer_length;
     UInt8 *transaction_buffer;
     UInt transaction_fifo_depth;
+    // IC_CLK in kHz, 0 if the controller doesn't know it
+    UInt32 clock_rate;
 } VoodooI2CControllerBusDevice;
 
 class VoodooI2CController;
@@ -0,0 +1,114 @@
+//
+//  VoodooI2CHIDBusTiming.hpp
+//  VoodooI2CHID
+//
+//  Created on 10/19/26.
+//  Copyright © 2026 VoodooI2C contributors. All rights reserved.
+//
+
+#ifndef VoodooI2CHIDBusTiming_hpp
+#define VoodooI2CHIDBusTiming_hpp
+
+#include <libkern/OSAtomic.h>
+#include "VoodooI2CControllerDriver.hpp"
+
+// Bus speed selection and the counters gathered around transferI2C. How long
+// a transfer should take on a given controller configuration is modelled
+// off-target by Tools/BusSimulator, which runs this driver against a
+// simulated DesignWare controller.
+
+// Connection speeds declared by I2cSerialBus resources
+#define kVoodooI2CHIDBusSpeedStandard 100000
+#define kVoodooI2CHIDBusSpeedFast 400000
+#define kVoodooI2CHIDBusSpeedFastPlus 1000000
+
+// A device that declares no connection speed leaves the controller alone
+#define kVoodooI2CHIDBusSpeedUnspecified 0
+
+// Fast-mode Plus SCL high and low times in ns, with the fall time the
+// controller counts through, as the DesignWare drivers program them
+#define kVoodooI2CHIDFastPlusHighNs 260
+#define kVoodooI2CHIDFastPlusLowNs 500
+#define kVoodooI2CHIDFallNs 300
+
+// SCL runs HCNT plus the spike filter and sync cycles high and LCNT plus one low
+#define kVoodooI2CHIDSCLOverheadCycles 9
+
+typedef struct {
+    UInt32 speed;
+    UInt16 hcnt;
+    UInt16 lcnt;
+} VoodooI2CHIDBusTiming;
+
+// IC_CLK in kHz. Controllers that don't report it get it back from the
+// fast-mode counts, which are sized for one 400kHz SCL period.
+static inline UInt32 VoodooI2CHIDBusClock(VoodooI2CControllerBusDevice *bus, VoodooI2CControllerBusConfig *config){
+    if (bus && bus->clock_rate)
+        return bus->clock_rate;
+    return (config->fs_hcnt + config->fs_lcnt + kVoodooI2CHIDSCLOverheadCycles) * (kVoodooI2CHIDBusSpeedFast / 1000);
+}
+
+// Derives the SCL counts for the requested speed from the controller's bus
+// config. A speed of 0 selects whatever mode the controller is configured for.
+static inline void VoodooI2CHIDBusTimingFromController(VoodooI2CControllerDriver *controller, UInt32 speed, VoodooI2CHIDBusTiming *timing){
+    VoodooI2CControllerBusConfig defaults;
+    VoodooI2CControllerBusConfig *config = &defaults;
+    UInt32 busConfig = DW_IC_CON_SPEED_FAST | DW_IC_CON_RESTART_EN;
+
+    VoodooI2CControllerBusDevice *bus = controller ? controller->bus_device : NULL;
+    if (bus){
+        if (bus->acpi_config)
+            config = bus->acpi_config;
+        busConfig = bus->bus_config;
+    }
+
+    if (speed == 0)
+        speed = (busConfig & DW_IC_CON_SPEED_FAST) ? kVoodooI2CHIDBusSpeedFast : kVoodooI2CHIDBusSpeedStandard;
+
+    if (speed >= kVoodooI2CHIDBusSpeedFastPlus){
+        // Fast-mode Plus has no counts of its own in the bus config, work them out from the clock
+        UInt64 clock = VoodooI2CHIDBusClock(bus, config);
+        UInt64 hcnt = (clock * (kVoodooI2CHIDFastPlusHighNs + kVoodooI2CHIDFallNs) + 500000) / 1000000;
+        UInt64 lcnt = (clock * (kVoodooI2CHIDFastPlusLowNs + kVoodooI2CHIDFallNs) + 500000) / 1000000;
+        timing->speed = kVoodooI2CHIDBusSpeedFastPlus;
+        // The controller doesn't take counts below 6 high and 8 low
+        timing->hcnt = hcnt >= 9 ? (UInt16)(hcnt - 3) : 6;
+        timing->lcnt = lcnt >= 9 ? (UInt16)(lcnt - 1) : 8;
+    } else if (speed >= kVoodooI2CHIDBusSpeedFast){
+        timing->speed = kVoodooI2CHIDBusSpeedFast;
+        timing->hcnt = config->fs_hcnt;
+        timing->lcnt = config->fs_lcnt;
+    } else {
+        timing->speed = kVoodooI2CHIDBusSpeedStandard;
+        timing->hcnt = config->ss_hcnt;
+        timing->lcnt = config->ss_lcnt;
+    }
+}
+
+// Raw totals gathered on the transfer path, transfers pay for a few atomic adds and nothing more
+typedef struct {
+    volatile SInt64 transfers;
+    volatile SInt64 messages;
+    volatile SInt64 readBytes;
+    volatile SInt64 writeBytes;
+    volatile SInt64 measuredNs;
+} VoodooI2CHIDBusCounters;
+
+static inline void VoodooI2CHIDBusCount(VoodooI2CHIDBusCounters *counters, const VoodooI2CControllerBusMessage *messages, int number, UInt64 measuredNs){
+    SInt64 readBytes = 0;
+    SInt64 writeBytes = 0;
+    for (int i = 0; i < number; i++){
+        if (messages[i].flags & I2C_M_RD)
+            readBytes += messages[i].length;
+        else
+            writeBytes += messages[i].length;
+    }
+
+    OSIncrementAtomic64(&counters->transfers);
+    OSAddAtomic64(number, &counters->messages);
+    OSAddAtomic64(readBytes, &counters->readBytes);
+    OSAddAtomic64(writeBytes, &counters->writeBytes);
+    OSAddAtomic64((SInt64)measuredNs, &counters->measuredNs);
+}
+
+#endif /* VoodooI2CHIDBusTiming_hpp */
@@ -9,6 +9,7 @@
 #include "VoodooI2CHIDDevice.hpp"
 #include "VoodooI2CHIDDeviceWrapper.hpp"
 #include <IOKit/IOLib.h>
+#include <kern/clock.h>
 
 #define super IOService
 
@@ -33,12 +34,33 @@ struct __attribute__((__packed__))  i2c_hid_cmd {
 
 OSDefineMetaClassAndStructors(VoodooI2CHIDDevice, IOService);
 
+IOService *VoodooI2CHIDDevice::probe(IOService *provider, SInt32 *score){
+    if (!super::probe(provider, score))
+        return NULL;
+    
+    //The generic personality matches every HID-over-I2C device, it should only keep the keyboards
+    OSBoolean *keyboardsOnly = OSDynamicCast(OSBoolean, getProperty("MatchKeyboardsOnly"));
+    if (keyboardsOnly && keyboardsOnly->isTrue() && !probeKeyboard(provider)){
+        IOLog("%s::No keyboard collection, not matching\n", getName());
+        return NULL;
+    }
+    return this;
+}
+
 bool VoodooI2CHIDDevice::start(IOService *provider){
     if (!super::start(provider))
         return false;
     
     this->DeviceIsAwake = false;
     this->IsReading = true;
+    this->resetPending = false;
+    this->resetSignalled = false;
+    
+    this->diagnosticLog.init();
+    
+    OSBoolean *tracing = OSDynamicCast(OSBoolean, getProperty("EventTracing"));
+    this->trace.init(tracing && tracing->isTrue());
+    this->traceReport = 0;
     
     PMinit();
     
@@ -50,6 +72,17 @@ bool VoodooI2CHIDDevice::start(IOService *provider){
         return false;
     }
     
+    memset((void *)&this->busCounters, 0, sizeof(this->busCounters));
+    
+    memset(&this->inputRecovery, 0, sizeof(this->inputRecovery));
+    
+#ifdef DEBUG
+    OSNumber *faultInterval = OSDynamicCast(OSNumber, getProperty("FaultInjectionInterval"));
+    this->faultInjectionInterval = faultInterval ? faultInterval->unsigned32BitValue() : 0;
+    this->faultInjectionCounter = 0;
+    this->injectedFaults = 0;
+#endif
+    
     OSNumber *i2cAddress = OSDynamicCast(OSNumber, provider->getProperty("i2cAddress"));
     this->i2cAddress = i2cAddress->unsigned16BitValue();
     
@@ -65,19 +98,58 @@ bool VoodooI2CHIDDevice::start(IOService *provider){
     
     IOLog("%s::Got HID Descriptor Address!\n", getName());
     
+    //Acquired only once nothing before the descriptor fetch can bail out, stop() gives it back from here on
+    this->transferScheduler = VoodooI2CHIDTransferScheduler::acquire(i2cController);
+    if (!this->transferScheduler)
+        IOLog("%s::Unable to get transfer scheduler, using controller directly\n", getName());
+    
+    this->connectionSpeed = getConnectionSpeed(acpiDevice);
+    memset(&this->requestedTiming, 0, sizeof(this->requestedTiming));
+    if (this->connectionSpeed != kVoodooI2CHIDBusSpeedUnspecified){
+        VoodooI2CHIDBusTimingFromController(i2cController, this->connectionSpeed, &this->requestedTiming);
+        setProperty("ConnectionSpeed", this->connectionSpeed, 32);
+        setProperty("RequestedSCLHighCount", this->requestedTiming.hcnt, 32);
+        setProperty("RequestedSCLLowCount", this->requestedTiming.lcnt, 32);
+    }
+    
     if (fetchHIDDescriptor() != kIOReturnSuccess){
         IOLog("%s::Unable to get HID Descriptor!\n", getName());
+        if (this->transferScheduler){
+            this->transferScheduler->relinquish();
+            this->transferScheduler = NULL;
+        }
         PMstop();
         return false;
     }
     
+    this->ReportDesc = NULL;
     this->ReportDescLength = 0;
+    this->predictionBuffer = NULL;
     if (fetchReportDescriptor() != kIOReturnSuccess){
         IOLog("%s::Unable to get Report Descriptor!\n", getName());
         stop(provider);
         return false;
     }
     
+    if (!this->reportDescriptor.parse((UInt8 *)this->ReportDesc->getBytesNoCopy(), this->ReportDescLength))
+        IOLog("%s::Unable to parse Report Descriptor, in-driver report processing disabled\n", getName());
+    
+    if (this->keyboard.configure(&this->reportDescriptor))
+        IOLog("%s::Found keyboard collection\n", getName());
+    configurePenFilter();
+    configureTouchTransform();
+    configureTouchpadModes();
+    
+    OSNumber *autosuspendIdle = OSDynamicCast(OSNumber, getProperty("AutosuspendIdleMs"));
+    this->autosuspendIdleMs = autosuspendIdle ? autosuspendIdle->unsigned32BitValue() : 0;
+    this->DeviceIsSuspended = false;
+    memset(&this->autosuspend, 0, sizeof(this->autosuspend));
+    
+    OSNumber *pacingMs = OSDynamicCast(OSNumber, getProperty("FramePacingMs"));
+    OSBoolean *intermediates = OSDynamicCast(OSBoolean, getProperty("FramePacingIntermediates"));
+    if (this->framePacer.configure(&this->reportDescriptor, pacingMs ? pacingMs->unsigned32BitValue() : 0, intermediates && intermediates->isTrue(), this->inputReadLength))
+        IOLog("%s::Pacing input every %dms\n", getName(), pacingMs->unsigned32BitValue());
+    
     this->IsReading = false;
     
     this->workLoop = getWorkLoop();
@@ -89,15 +161,60 @@ bool VoodooI2CHIDDevice::start(IOService *provider){
     
     this->workLoop->retain();
     
-    this->interruptSource = IOInterruptEventSource::interruptEventSource(this, OSMemberFunctionCast(IOInterruptEventAction, this, &VoodooI2CHIDDevice::InterruptOccured), provider, 0);
-    if (!this->interruptSource) {
-        IOLog("%s::Unable to get interrupt source\n", getName());
-        stop(provider);
-        return false;
+    if (this->touchpadModes.hasLatencyMode()){
+        this->latencyTimer = IOTimerEventSource::timerEventSource(this, OSMemberFunctionCast(IOTimerEventSource::Action, this, &VoodooI2CHIDDevice::latencyTimerFired));
+        if (this->latencyTimer)
+            this->workLoop->addEventSource(this->latencyTimer);
+    }
+    
+    this->logTimer = IOTimerEventSource::timerEventSource(this, OSMemberFunctionCast(IOTimerEventSource::Action, this, &VoodooI2CHIDDevice::logTimerFired));
+    if (this->logTimer){
+        this->workLoop->addEventSource(this->logTimer);
+        if (this->diagnosticLog.isDrainPending())
+            this->logTimer->setTimeoutMS(kLogDrainMs);
     }
     
-    this->workLoop->addEventSource(this->interruptSource);
-    this->interruptSource->enable();
+    if (this->framePacer.isEnabled()){
+        this->pacingTimer = IOTimerEventSource::timerEventSource(this, OSMemberFunctionCast(IOTimerEventSource::Action, this, &VoodooI2CHIDDevice::pacingTimerFired));
+        if (this->pacingTimer)
+            this->workLoop->addEventSource(this->pacingTimer);
+        else
+            this->framePacer.release();
+    }
+    
+    //Every poll would wake a suspended device straight back up
+    if (this->quirks.pollIntervalMs && this->autosuspendIdleMs){
+        IOLog("%s::Autosuspend is unavailable while polling\n", getName());
+        this->autosuspendIdleMs = 0;
+    }
+    
+    if (this->autosuspendIdleMs){
+        this->autosuspendTimer = IOTimerEventSource::timerEventSource(this, OSMemberFunctionCast(IOTimerEventSource::Action, this, &VoodooI2CHIDDevice::autosuspendTimerFired));
+        if (this->autosuspendTimer)
+            this->workLoop->addEventSource(this->autosuspendTimer);
+    }
+    
+    if (this->quirks.pollIntervalMs){
+        //Devices with a broken or missing interrupt line are read on a timer instead
+        this->pollTimer = IOTimerEventSource::timerEventSource(this, OSMemberFunctionCast(IOTimerEventSource::Action, this, &VoodooI2CHIDDevice::pollTimerFired));
+        if (!this->pollTimer) {
+            IOLog("%s::Unable to get poll timer\n", getName());
+            stop(provider);
+            return false;
+        }
+        
+        this->workLoop->addEventSource(this->pollTimer);
+    } else {
+        this->interruptSource = IOInterruptEventSource::interruptEventSource(this, OSMemberFunctionCast(IOInterruptEventAction, this, &VoodooI2CHIDDevice::InterruptOccured), provider, 0);
+        if (!this->interruptSource) {
+            IOLog("%s::Unable to get interrupt source\n", getName());
+            stop(provider);
+            return false;
+        }
+        
+        this->workLoop->addEventSource(this->interruptSource);
+        this->interruptSource->enable();
+    }
     
     this->wrapper = new VoodooI2CHIDDeviceWrapper;
     if (this->wrapper->init()){
@@ -111,10 +228,18 @@ bool VoodooI2CHIDDevice::start(IOService *provider){
     registerService();
     
     reset_dev();
+    setInputMode();
+    
+    this->lastInputAt = mach_absolute_time();
+    if (this->autosuspendTimer)
+        this->autosuspendTimer->setTimeoutMS(this->autosuspendIdleMs);
     
     this->DeviceIsAwake = true;
     this->IsReading = false;
     
+    if (this->pollTimer)
+        this->pollTimer->setTimeoutMS(this->quirks.pollIntervalMs);
+    
 #define kMyNumberOfStates 2
     
     static IOPMPowerState myPowerStates[kMyNumberOfStates];
@@ -143,10 +268,49 @@ void VoodooI2CHIDDevice::stop(IOService *provider){
     this->DeviceIsAwake = false;
     IOSleep(1);
     
-    if (this->ReportDescLength != 0){
-        IOFree(this->ReportDesc, this->ReportDescLength);
+    //Readers and mode switches record into buffers freed below
+    while (this->IsReading){
+        IOSleep(10);
+    }
+    
+    OSSafeReleaseNULL(this->ReportDesc);
+    this->ReportDescLength = 0;
+    
+    OSSafeReleaseNULL(this->predictionBuffer);
+    
+    if (this->latencyTimer){
+        this->latencyTimer->cancelTimeout();
+        this->workLoop->removeEventSource(this->latencyTimer);
+        OSSafeReleaseNULL(this->latencyTimer);
     }
     
+    if (this->autosuspendTimer){
+        this->autosuspendTimer->cancelTimeout();
+        this->workLoop->removeEventSource(this->autosuspendTimer);
+        OSSafeReleaseNULL(this->autosuspendTimer);
+    }
+    
+    if (this->pollTimer){
+        this->pollTimer->cancelTimeout();
+        this->workLoop->removeEventSource(this->pollTimer);
+        OSSafeReleaseNULL(this->pollTimer);
+    }
+    
+    if (this->pacingTimer){
+        this->pacingTimer->cancelTimeout();
+        this->workLoop->removeEventSource(this->pacingTimer);
+        OSSafeReleaseNULL(this->pacingTimer);
+    }
+    this->framePacer.release();
+    this->trace.release();
+    
+    if (this->logTimer){
+        this->logTimer->cancelTimeout();
+        this->workLoop->removeEventSource(this->logTimer);
+        OSSafeReleaseNULL(this->logTimer);
+    }
+    this->diagnosticLog.drain(getName());
+    
     if (this->interruptSource){
         this->interruptSource->disable();
         this->workLoop->removeEventSource(this->interruptSource);
@@ -163,6 +327,11 @@ void VoodooI2CHIDDevice::stop(IOService *provider){
     
     OSSafeReleaseNULL(this->workLoop);
     
+    if (this->transferScheduler){
+        this->transferScheduler->relinquish();
+        this->transferScheduler = NULL;
+    }
+    
     PMstop();
     
     super::stop(provider);
@@ -175,10 +344,21 @@ IOReturn VoodooI2CHIDDevice::setPowerState(unsigned long powerState, IOService *
         //Going to sleep
         if (this->DeviceIsAwake){
             this->DeviceIsAwake = false;
+            if (this->latencyTimer)
+                this->latencyTimer->cancelTimeout();
+            if (this->autosuspendTimer)
+                this->autosuspendTimer->cancelTimeout();
+            if (this->pollTimer)
+                this->pollTimer->cancelTimeout();
             while (this->IsReading){
                 IOSleep(10);
             }
+            if (this->pacingTimer){
+                this->pacingTimer->cancelTimeout();
+                this->framePacer.reset();
+            }
             this->IsReading = true;
+            this->trace.record(kVoodooI2CHIDTracePowerState, this->traceReport, 0, 0);
             set_power(I2C_HID_PWR_SLEEP);
             this->IsReading = false;
             
@@ -187,10 +367,23 @@ IOReturn VoodooI2CHIDDevice::setPowerState(unsigned long powerState, IOService *
     } else {
         if (!this->DeviceIsAwake){
             this->IsReading = true;
+            this->trace.record(kVoodooI2CHIDTracePowerState, this->traceReport, 0, 1);
             reset_dev();
+            setInputMode();
+            if (this->DeviceIsSuspended){
+                uint64_t suspendedNs;
+                absolutetime_to_nanoseconds(mach_absolute_time() - this->suspendedAt, &suspendedNs);
+                this->autosuspend.suspendedNs += suspendedNs;
+                this->DeviceIsSuspended = false;
+            }
+            this->lastInputAt = mach_absolute_time();
+            if (this->autosuspendTimer)
+                this->autosuspendTimer->setTimeoutMS(this->autosuspendIdleMs);
             this->IsReading = false;
             
             this->DeviceIsAwake = true;
+            if (this->pollTimer)
+                this->pollTimer->setTimeoutMS(this->quirks.pollIntervalMs);
             IOLog("%s::Woke up from Sleep!\n", getName());
         } else {
             IOLog("%s::Device already awake! Not reinitializing.\n", getName());
@@ -199,6 +392,158 @@ IOReturn VoodooI2CHIDDevice::setPowerState(unsigned long powerState, IOService *
     return kIOPMAckImplied;
 }
 
+static void setStatistic(OSDictionary *dict, const char *key, UInt64 value){
+    OSNumber *number = OSNumber::withNumber(value, 64);
+    if (number){
+        dict->setObject(key, number);
+        number->release();
+    }
+}
+
+bool VoodooI2CHIDDevice::serializeProperties(OSSerialize *serialize) const {
+    //Refresh the shared bus statistics only when someone actually reads the registry
+    if (this->transferScheduler){
+        OSDictionary *stats = this->transferScheduler->copyStatistics();
+        if (stats){
+            const_cast<VoodooI2CHIDDevice *>(this)->setProperty("TransferScheduler", stats);
+            stats->release();
+        }
+    }
+    
+    OSDictionary *recovery = OSDictionary::withCapacity(6);
+    if (recovery){
+        setStatistic(recovery, "Retries", this->inputRecovery.retries);
+        setStatistic(recovery, "Flushes", this->inputRecovery.flushes);
+        setStatistic(recovery, "PowerCycles", this->inputRecovery.powerCycles);
+        setStatistic(recovery, "Resets", this->inputRecovery.resets);
+        setStatistic(recovery, "Failures", this->inputRecovery.failures);
+        setStatistic(recovery, "MaxRecoveryNs", this->inputRecovery.maxRecoveryNs);
+        const_cast<VoodooI2CHIDDevice *>(this)->setProperty("InputRecovery", recovery);
+        recovery->release();
+    }
+    
+    if (this->keyboard.isEnabled()){
+        OSDictionary *keys = OSDictionary::withCapacity(5);
+        if (keys){
+            setStatistic(keys, "Reports", this->keyboard.reports);
+            setStatistic(keys, "Presses", this->keyboard.presses);
+            setStatistic(keys, "Releases", this->keyboard.releases);
+            setStatistic(keys, "DuplicateReports", this->keyboard.duplicates);
+            setStatistic(keys, "RolloverErrors", this->keyboard.rolloverErrors);
+            const_cast<VoodooI2CHIDDevice *>(this)->setProperty("Keyboard", keys);
+            keys->release();
+        }
+    }
+    
+    if (this->penFilter.isEnabled()){
+        OSDictionary *pen = OSDictionary::withCapacity(3);
+        if (pen){
+            setStatistic(pen, "Samples", this->penFilter.samples);
+            if (this->penFilter.isPredicting()){
+                setStatistic(pen, "Predictions", this->penFilter.predictions);
+                setStatistic(pen, "PredictionReportID", this->penFilter.predictionReportID());
+            }
+            const_cast<VoodooI2CHIDDevice *>(this)->setProperty("PenFilter", pen);
+            pen->release();
+        }
+    }
+    
+    if (this->touchTransform.isEnabled()){
+        OSDictionary *transform = OSDictionary::withCapacity(2);
+        if (transform){
+            setStatistic(transform, "Frames", this->touchTransform.frames);
+            setStatistic(transform, "Contacts", this->touchTransform.contacts);
+            const_cast<VoodooI2CHIDDevice *>(this)->setProperty("TouchTransformStats", transform);
+            transform->release();
+        }
+    }
+    
+    if (this->touchpadModes.hasLatencyMode()){
+        OSDictionary *modes = OSDictionary::withCapacity(4);
+        if (modes){
+            uint64_t now;
+            absolutetime_to_nanoseconds(mach_absolute_time(), &now);
+            setStatistic(modes, "NormalLatencyMs", this->touchpadModes.timeInMode(kPTPLatencyNormal, now) / 1000000);
+            setStatistic(modes, "HighLatencyMs", this->touchpadModes.timeInMode(kPTPLatencyHigh, now) / 1000000);
+            setStatistic(modes, "LatencySwitches", this->touchpadModes.latencySwitches);
+            setStatistic(modes, "MaxSwitchNs", this->touchpadModes.maxSwitchNs);
+            const_cast<VoodooI2CHIDDevice *>(this)->setProperty("TouchpadModes", modes);
+            modes->release();
+        }
+    }
+    
+    if (this->trace.isEnabled()){
+        OSData *dump = this->trace.copyDump();
+        if (dump){
+            const_cast<VoodooI2CHIDDevice *>(this)->setProperty("EventTrace", dump);
+            dump->release();
+        }
+    }
+    
+    OSDictionary *logStats = this->diagnosticLog.copyStatistics();
+    if (logStats){
+        const_cast<VoodooI2CHIDDevice *>(this)->setProperty("DiagnosticLog", logStats);
+        logStats->release();
+    }
+    
+    OSArray *recentLog = this->diagnosticLog.copyRecent(kLogRecentRecords);
+    if (recentLog){
+        const_cast<VoodooI2CHIDDevice *>(this)->setProperty("RecentLog", recentLog);
+        recentLog->release();
+    }
+    
+    if (this->framePacer.isEnabled()){
+        VoodooI2CHIDPacerStats paced;
+        this->framePacer.copyStatistics(&paced);
+        OSDictionary *pacing = OSDictionary::withCapacity(7);
+        if (pacing){
+            setStatistic(pacing, "Queued", paced.queued);
+            setStatistic(pacing, "Delivered", paced.delivered);
+            setStatistic(pacing, "Frames", paced.frames);
+            setStatistic(pacing, "Replaced", paced.replaced);
+            setStatistic(pacing, "Overflowed", paced.overflowed);
+            setStatistic(pacing, "AverageDelayNs", paced.delivered ? paced.totalDelayNs / paced.delivered : 0);
+            setStatistic(pacing, "MaxDelayNs", paced.maxDelayNs);
+            const_cast<VoodooI2CHIDDevice *>(this)->setProperty("FramePacing", pacing);
+            pacing->release();
+        }
+    }
+    
+    if (this->autosuspendIdleMs){
+        OSDictionary *suspend = OSDictionary::withCapacity(5);
+        if (suspend){
+            uint64_t suspendedNs = this->autosuspend.suspendedNs;
+            if (this->DeviceIsSuspended){
+                uint64_t currentNs;
+                absolutetime_to_nanoseconds(mach_absolute_time() - this->suspendedAt, &currentNs);
+                suspendedNs += currentNs;
+            }
+            setStatistic(suspend, "Suspends", this->autosuspend.suspends);
+            setStatistic(suspend, "SuspendedMs", suspendedNs / 1000000);
+            setStatistic(suspend, "LastWakeToReportNs", this->autosuspend.lastWakeToReportNs);
+            setStatistic(suspend, "MaxWakeToReportNs", this->autosuspend.maxWakeToReportNs);
+            setStatistic(suspend, "EmptyWakes", this->autosuspend.emptyWakes);
+            const_cast<VoodooI2CHIDDevice *>(this)->setProperty("Autosuspend", suspend);
+            suspend->release();
+        }
+    }
+    
+    OSDictionary *timing = OSDictionary::withCapacity(6);
+    if (timing){
+        setStatistic(timing, "Transfers", this->busCounters.transfers);
+        setStatistic(timing, "Messages", this->busCounters.messages);
+        setStatistic(timing, "ReadBytes", this->busCounters.readBytes);
+        setStatistic(timing, "WriteBytes", this->busCounters.writeBytes);
+        setStatistic(timing, "MeasuredNs", this->busCounters.measuredNs);
+#ifdef DEBUG
+        setStatistic(timing, "InjectedFaults", this->injectedFaults);
+#endif
+        const_cast<VoodooI2CHIDDevice *>(this)->setProperty("BusTiming", timing);
+        timing->release();
+    }
+    return super::serializeProperties(serialize);
+}
+
 IOReturn VoodooI2CHIDDevice::getDescriptorAddress(IOACPIPlatformDevice *acpiDevice){
     if (!acpiDevice)
         return kIOReturnNoDevice;
@@ -249,10 +594,91 @@ IOReturn VoodooI2CHIDDevice::getDescriptorAddress(IOACPIPlatformDevice *acpiDevi
     return kIOReturnSuccess;
 }
 
-IOReturn VoodooI2CHIDDevice::readI2C(UInt8 *values, UInt16 len){
+IOReturn VoodooI2CHIDDevice::transferI2C(VoodooI2CHIDTransferClass transferClass, VoodooI2CControllerBusMessage *msgs, int number){
+#ifdef DEBUG
+    //Simulate a NACKed transfer so the error paths can be exercised on real hardware
+    if (this->faultInjectionInterval && ((UInt32)OSIncrementAtomic(&this->faultInjectionCounter) + 1) % this->faultInjectionInterval == 0){
+        OSIncrementAtomic64(&this->injectedFaults);
+        return kIOReturnNotResponding;
+    }
+#endif
+    
+    this->trace.record(kVoodooI2CHIDTraceTransferStart, this->traceReport, transferClass, number);
+    
+    //Every message carries the declared speed, a speed of 0 leaves the controller at its configured one
+    for (int i = 0; i < number; i++){
+        msgs[i].speed = this->requestedTiming.speed;
+        msgs[i].hcnt = this->requestedTiming.hcnt;
+        msgs[i].lcnt = this->requestedTiming.lcnt;
+    }
+    
+    UInt64 busTimeNs = 0;
+    IOReturn ret;
+    if (this->transferScheduler){
+        ret = this->transferScheduler->transfer(transferClass, msgs, number, &busTimeNs);
+    } else {
+        uint64_t startTime = mach_absolute_time();
+        ret = i2cController->transferI2C(msgs, number);
+        absolutetime_to_nanoseconds(mach_absolute_time() - startTime, &busTimeNs);
+    }
+    
+    this->trace.record(kVoodooI2CHIDTraceTransferEnd, this->traceReport, transferClass, ret);
+    
+    //Transfers can come from the reader, PM and user client threads at once
+    if (ret == kIOReturnSuccess)
+        VoodooI2CHIDBusCount(&this->busCounters, msgs, number, busTimeNs);
+    return ret;
+}
+
+UInt32 VoodooI2CHIDDevice::getConnectionSpeed(IOACPIPlatformDevice *acpiDevice){
+    //Walk _CRS for the I2cSerialBus connection matching our address and use its declared speed
+    OSObject *result = NULL;
+    acpiDevice->evaluateObject("_CRS", &result);
+    
+    OSData *resources = OSDynamicCast(OSData, result);
+    UInt32 speed = kVoodooI2CHIDBusSpeedUnspecified;
+    if (resources){
+        const UInt8 *data = (const UInt8 *)resources->getBytesNoCopy();
+        UInt32 length = resources->getLength();
+        UInt32 offset = 0;
+        
+        while (offset < length){
+            UInt8 tag = data[offset];
+            if (!(tag & 0x80)){
+                //Small resource, stop at the end tag
+                if ((tag & 0x78) == 0x78)
+                    break;
+                offset += 1 + (tag & 0x07);
+                continue;
+            }
+            
+            if (offset + 3 > length)
+                break;
+            UInt16 itemLength = data[offset + 1] | data[offset + 2] << 8;
+            
+            //Serial bus connection descriptor of type I2C
+            if (tag == 0x8E && itemLength >= 15 && offset + 3 + itemLength <= length && data[offset + 5] == 0x01){
+                UInt32 itemSpeed = data[offset + 12] | data[offset + 13] << 8 | data[offset + 14] << 16 | (UInt32)data[offset + 15] << 24;
+                UInt16 itemAddress = data[offset + 16] | data[offset + 17] << 8;
+                if (itemAddress == this->i2cAddress){
+                    speed = itemSpeed;
+                    break;
+                }
+            }
+            offset += 3 + itemLength;
+        }
+    }
+    
+    if (result)
+        result->release();
+    
+    return speed;
+}
+
+IOReturn VoodooI2CHIDDevice::readI2C(VoodooI2CHIDTransferClass transferClass, UInt8 *values, UInt16 len){
     UInt16 flags = I2C_M_RD;
     if (this->use10BitAddressing)
-        flags = I2C_M_RD | I2C_M_TEN;
+        flags |= I2C_M_TEN;
     VoodooI2CControllerBusMessage msgs[] = {
         {
             .address = this->i2cAddress,
@@ -261,13 +687,13 @@ IOReturn VoodooI2CHIDDevice::readI2C(UInt8 *values, UInt16 len){
             .length = (UInt16)len,
         },
     };
-    return i2cController->transferI2C(msgs, 1);
+    return transferI2C(transferClass, msgs, 1);
 }
 
-IOReturn VoodooI2CHIDDevice::writeI2C(UInt8 *values, UInt16 len){
+IOReturn VoodooI2CHIDDevice::writeI2C(VoodooI2CHIDTransferClass transferClass, UInt8 *values, UInt16 len){
     UInt16 flags = 0;
     if (this->use10BitAddressing)
-        flags = I2C_M_TEN;
+        flags |= I2C_M_TEN;
     VoodooI2CControllerBusMessage msgs[] = {
         {
             .address = this->i2cAddress,
@@ -276,16 +702,16 @@ IOReturn VoodooI2CHIDDevice::writeI2C(UInt8 *values, UInt16 len){
             .length = (UInt16)len,
         },
     };
-    return i2cController->transferI2C(msgs, 1);
+    return transferI2C(transferClass, msgs, 1);
 }
 
-IOReturn VoodooI2CHIDDevice::writeReadI2C(UInt8 *writeBuf, UInt16 writeLen, UInt8 *readBuf, UInt16 readLen){
+IOReturn VoodooI2CHIDDevice::writeReadI2C(VoodooI2CHIDTransferClass transferClass, UInt8 *writeBuf, UInt16 writeLen, UInt8 *readBuf, UInt16 readLen){
     UInt16 readFlags = I2C_M_RD;
     if (this->use10BitAddressing)
-        readFlags = I2C_M_RD | I2C_M_TEN;
+        readFlags |= I2C_M_TEN;
     UInt16 writeFlags = 0;
     if (this->use10BitAddressing)
-        writeFlags = I2C_M_TEN;
+        writeFlags |= I2C_M_TEN;
     VoodooI2CControllerBusMessage msgs[] = {
         {
             .address = this->i2cAddress,
@@ -300,7 +726,57 @@ IOReturn VoodooI2CHIDDevice::writeReadI2C(UInt8 *writeBuf, UInt16 writeLen, UInt
             .length = readLen,
         }
     };
-    return i2cController->transferI2C(msgs, 2);
+    return transferI2C(transferClass, msgs, 2);
+}
+
+//Plain register read straight through the controller, nothing else is set up while probing
+static IOReturn probeRegister(VoodooI2CControllerDriver *controller, UInt16 address, UInt16 flags, UInt16 reg, UInt8 *buffer, UInt16 length){
+    union command cmd;
+    cmd.c.reg = reg;
+    VoodooI2CControllerBusMessage msgs[] = {
+        {
+            .address = address,
+            .buffer = cmd.data,
+            .flags = flags,
+            .length = 2,
+        },
+        {
+            .address = address,
+            .buffer = buffer,
+            .flags = (UInt16)(flags | I2C_M_RD),
+            .length = length,
+        }
+    };
+    return controller->transferI2C(msgs, 2);
+}
+
+bool VoodooI2CHIDDevice::probeKeyboard(IOService *provider){
+    VoodooI2CControllerDriver *controller = OSDynamicCast(VoodooI2CControllerDriver, provider->getProvider());
+    OSNumber *address = OSDynamicCast(OSNumber, provider->getProperty("i2cAddress"));
+    OSNumber *addrWidth = OSDynamicCast(OSNumber, provider->getProperty("addrWidth"));
+    IOACPIPlatformDevice *acpiDevice = OSDynamicCast(IOACPIPlatformDevice, provider->getProperty("acpi-device"));
+    if (!controller || !address || !addrWidth || getDescriptorAddress(acpiDevice) != kIOReturnSuccess)
+        return false;
+    UInt16 flags = addrWidth->unsigned8BitValue() == 10 ? I2C_M_TEN : 0;
+    
+    struct i2c_hid_descr descriptor;
+    memset(&descriptor, 0, sizeof(descriptor));
+    if (probeRegister(controller, address->unsigned16BitValue(), flags, this->HIDDescriptorAddress, (UInt8 *)&descriptor, sizeof(descriptor)) != kIOReturnSuccess)
+        return false;
+    UInt16 length = descriptor.wReportDescLength;
+    if (length == 0)
+        return false;
+    
+    UInt8 *bytes = (UInt8 *)IOMalloc(length);
+    if (!bytes)
+        return false;
+    
+    //start() parses the descriptor again into the same table
+    bool keyboard = probeRegister(controller, address->unsigned16BitValue(), flags, descriptor.wReportDescRegister, bytes, length) == kIOReturnSuccess &&
+        this->reportDescriptor.parse(bytes, length) &&
+        this->reportDescriptor.hasApplication(kHIDPage_GenericDesktop, kHIDUsage_GD_Keyboard);
+    IOFree(bytes, length);
+    return keyboard;
 }
 
 IOReturn VoodooI2CHIDDevice::fetchHIDDescriptor(){
@@ -311,11 +787,16 @@ IOReturn VoodooI2CHIDDevice::fetchHIDDescriptor(){
     
     memset((UInt8 *)&this->HIDDescriptor, 0, sizeof(i2c_hid_descr));
     
-    if (writeReadI2C(cmd.data, (UInt16)length, (UInt8 *)&this->HIDDescriptor, (UInt16)sizeof(i2c_hid_descr)) != kIOReturnSuccess)
+    if (writeReadI2C(kVoodooI2CHIDTransferManagement, cmd.data, (UInt16)length, (UInt8 *)&this->HIDDescriptor, (UInt16)sizeof(i2c_hid_descr)) != kIOReturnSuccess)
         return kIOReturnIOError;
     
     IOLog("%s::BCD Version: 0x%x\n", getName(), this->HIDDescriptor.bcdVersion);
-    if (this->HIDDescriptor.bcdVersion == 0x0100 && this->HIDDescriptor.wHIDDescLength == sizeof(i2c_hid_descr)){
+    applyQuirks();
+    
+    bool valid = this->HIDDescriptor.bcdVersion == 0x0100 && this->HIDDescriptor.wHIDDescLength == sizeof(i2c_hid_descr);
+    if (!valid && this->quirks.relaxedDescriptor)
+        valid = this->HIDDescriptor.wHIDDescLength != 0 && this->HIDDescriptor.wReportDescLength != 0 && this->inputReadLength > 2;
+    if (valid){
         setProperty("HIDDescLength", (UInt32)this->HIDDescriptor.wHIDDescLength, 32);
         setProperty("bcdVersion", (UInt32)this->HIDDescriptor.bcdVersion, 32);
         setProperty("ReportDescLength", (UInt32)this->HIDDescriptor.wReportDescLength, 32);
@@ -334,23 +815,325 @@ IOReturn VoodooI2CHIDDevice::fetchHIDDescriptor(){
     return kIOReturnDeviceError;
 }
 
+static void overrideQuirk(IOService *service, const char *key, UInt16 *value){
+    OSNumber *number = OSDynamicCast(OSNumber, service->getProperty(key));
+    if (number)
+        *value = number->unsigned16BitValue();
+}
+
+static void overrideQuirk(IOService *service, const char *key, bool *value){
+    OSBoolean *boolean = OSDynamicCast(OSBoolean, service->getProperty(key));
+    if (boolean)
+        *value = boolean->isTrue();
+}
+
+void VoodooI2CHIDDevice::applyQuirks(){
+    this->quirks = VoodooI2CHIDQuirksFor(this->HIDDescriptor.wVendorID, this->HIDDescriptor.wProductID);
+    
+    overrideQuirk(this, "QuirkResetDelayMs", &this->quirks.resetDelayMs);
+    overrideQuirk(this, "QuirkWaitForReset", &this->quirks.waitForReset);
+    overrideQuirk(this, "QuirkResetSettleMs", &this->quirks.resetSettleMs);
+    overrideQuirk(this, "QuirkMaxInputLength", &this->quirks.maxInputLength);
+    overrideQuirk(this, "QuirkMultiReportDrain", &this->quirks.multiReportDrain);
+    overrideQuirk(this, "QuirkPollIntervalMs", &this->quirks.pollIntervalMs);
+    overrideQuirk(this, "QuirkRelaxedDescriptor", &this->quirks.relaxedDescriptor);
+    
+    //Shorter than the length header reads nothing, longer than wMaxInputLength reads past what the device promises to send
+    this->inputReadLength = this->HIDDescriptor.wMaxInputLength;
+    if (this->quirks.maxInputLength){
+        UInt16 readLength = this->quirks.maxInputLength;
+        if (readLength > this->HIDDescriptor.wMaxInputLength)
+            readLength = this->HIDDescriptor.wMaxInputLength;
+        if (readLength < 2)
+            readLength = 2;
+        if (readLength != this->quirks.maxInputLength)
+            IOLog("%s::Max input length %d out of range, reading %d\n", getName(), this->quirks.maxInputLength, readLength);
+        this->inputReadLength = readLength;
+    }
+    
+    OSDictionary *applied = OSDictionary::withCapacity(7);
+    if (applied){
+        setStatistic(applied, "ResetDelayMs", this->quirks.resetDelayMs);
+        setStatistic(applied, "WaitForReset", this->quirks.waitForReset);
+        setStatistic(applied, "ResetSettleMs", this->quirks.resetSettleMs);
+        setStatistic(applied, "InputReadLength", this->inputReadLength);
+        setStatistic(applied, "MultiReportDrain", this->quirks.multiReportDrain);
+        setStatistic(applied, "PollIntervalMs", this->quirks.pollIntervalMs);
+        setStatistic(applied, "RelaxedDescriptor", this->quirks.relaxedDescriptor);
+        setProperty("Quirks", applied);
+        applied->release();
+    }
+}
+
 IOReturn VoodooI2CHIDDevice::fetchReportDescriptor(){
-    if (this->ReportDescLength != 0)
+    //The descriptor is fetched once and shared read-only for the lifetime of the device
+    if (this->ReportDesc)
         return kIOReturnSuccess;
-    this->ReportDescLength = this->HIDDescriptor.wReportDescLength;
+    UInt16 descLength = this->HIDDescriptor.wReportDescLength;
+    if (descLength == 0)
+        return kIOReturnDeviceError;
     UInt8 length = 2;
     
     union command cmd;
     cmd.c.reg = this->HIDDescriptor.wReportDescRegister;
     
-    this->ReportDesc = (UInt8 *)IOMalloc(this->ReportDescLength);
-    memset((UInt8 *)this->ReportDesc, 0, this->ReportDescLength);
+    IOBufferMemoryDescriptor *desc = IOBufferMemoryDescriptor::inTaskWithOptions(kernel_task, kIODirectionOut, descLength);
+    if (!desc)
+        return kIOReturnNoResources;
+    
+    UInt8 *descBytes = (UInt8 *)desc->getBytesNoCopy();
+    memset(descBytes, 0, descLength);
     
-    if (writeReadI2C(cmd.data, (UInt16)length, (UInt8 *)this->ReportDesc, this->ReportDescLength) != kIOReturnSuccess)
+    if (writeReadI2C(kVoodooI2CHIDTransferManagement, cmd.data, (UInt16)length, descBytes, descLength) != kIOReturnSuccess){
+        desc->release();
         return kIOReturnIOError;
+    }
+    
+    this->ReportDesc = desc;
+    this->ReportDescLength = descLength;
     return kIOReturnSuccess;
 }
 
+void VoodooI2CHIDDevice::configurePenFilter(){
+    OSNumber *weight = OSDynamicCast(OSNumber, getProperty("PenSmoothingWeight"));
+    OSNumber *prediction = OSDynamicCast(OSNumber, getProperty("PenPredictionUs"));
+    
+    if (!this->penFilter.configure(&this->reportDescriptor, weight ? weight->unsigned32BitValue() : 0, prediction ? prediction->unsigned32BitValue() : 0))
+        return;
+    
+    if (this->penFilter.isPredicting() && !extendReportDescriptorForPrediction()){
+        //Smoothing alone still works, predictions just have nowhere to go
+        this->penFilter.configure(&this->reportDescriptor, weight ? weight->unsigned32BitValue() : 0, 0);
+    }
+    
+    IOLog("%s::Pen filter enabled%s\n", getName(), this->penFilter.isPredicting() ? " with prediction" : "");
+}
+
+bool VoodooI2CHIDDevice::extendReportDescriptorForPrediction(){
+    //Predicted samples are described as a vendor-defined application appended to the device's own descriptor
+    UInt32 length = this->ReportDescLength + kPenPredictionDescriptorLength;
+    if (length > 0xFFFF)
+        return false;
+    IOBufferMemoryDescriptor *desc = IOBufferMemoryDescriptor::inTaskWithOptions(kernel_task, kIODirectionOut, length);
+    if (!desc)
+        return false;
+    
+    UInt8 *descBytes = (UInt8 *)desc->getBytesNoCopy();
+    memcpy(descBytes, this->ReportDesc->getBytesNoCopy(), this->ReportDescLength);
+    length = this->ReportDescLength + this->penFilter.predictionDescriptor(descBytes + this->ReportDescLength, kPenPredictionDescriptorLength);
+    desc->setLength(length);
+    
+    this->predictionBuffer = IOBufferMemoryDescriptor::inTaskWithOptions(kernel_task, 0, kPenPredictionReportLength);
+    if (!this->predictionBuffer){
+        desc->release();
+        return false;
+    }
+    
+    this->ReportDesc->release();
+    this->ReportDesc = desc;
+    this->ReportDescLength = (UInt16)length;
+    return true;
+}
+
+void VoodooI2CHIDDevice::configureTouchTransform(){
+    SInt32 matrix[6];
+    
+    OSArray *transform = OSDynamicCast(OSArray, getProperty("TouchTransform"));
+    if (transform && transform->getCount() == 6){
+        for (int i = 0; i < 6; i++){
+            OSNumber *value = OSDynamicCast(OSNumber, transform->getObject(i));
+            if (!value){
+                IOLog("%s::Invalid TouchTransform, ignoring\n", getName());
+                return;
+            }
+            matrix[i] = (SInt32)value->unsigned32BitValue();
+        }
+    } else {
+        OSNumber *rotation = OSDynamicCast(OSNumber, getProperty("TouchRotation"));
+        OSBoolean *flipX = OSDynamicCast(OSBoolean, getProperty("TouchFlipX"));
+        OSBoolean *flipY = OSDynamicCast(OSBoolean, getProperty("TouchFlipY"));
+        VoodooI2CHIDTouchTransform::matrixForOrientation(rotation ? rotation->unsigned32BitValue() : 0, flipX && flipX->isTrue(), flipY && flipY->isTrue(), matrix);
+    }
+    
+    if (this->touchTransform.configure(&this->reportDescriptor, matrix))
+        IOLog("%s::Touch transform enabled\n", getName());
+}
+
+void VoodooI2CHIDDevice::configureTouchpadModes(){
+    //Switching to PTP reports breaks devices still presented as a mouse, so it's opt-in
+    OSBoolean *inputMode = OSDynamicCast(OSBoolean, getProperty("TouchpadInputMode"));
+    OSNumber *idleMs = OSDynamicCast(OSNumber, getProperty("TouchpadIdleLatencyMs"));
+    if (!this->touchpadModes.configure(&this->reportDescriptor, inputMode && inputMode->isTrue(), idleMs ? idleMs->unsigned32BitValue() : 0))
+        return;
+    
+    IOLog("%s::Touchpad input mode: %s, latency mode: %s\n", getName(), this->touchpadModes.hasInputMode() ? "yes" : "no", this->touchpadModes.hasLatencyMode() ? "yes" : "no");
+}
+
+IOReturn VoodooI2CHIDDevice::setInputMode(){
+    UInt8 reportID;
+    UInt8 buffer[kPTPMaxFeatureReport];
+    UInt16 length;
+    
+    uint64_t now;
+    absolutetime_to_nanoseconds(mach_absolute_time(), &now);
+    this->touchpadModes.reset(now);
+    if (this->latencyTimer)
+        this->latencyTimer->setTimeoutMS(kLatencyRetryMs);
+    
+    if (!this->touchpadModes.buildInputModeReport(&reportID, buffer, &length))
+        return kIOReturnUnsupported;
+    
+    IOReturn ret = setReport(reportID, kIOHIDReportTypeFeature, buffer, length);
+    if (ret != kIOReturnSuccess)
+        IOLog("%s::Unable to set touchpad input mode: 0x%.8x\n", getName(), ret);
+    return ret;
+}
+
+IOReturn VoodooI2CHIDDevice::setLatencyMode(int mode){
+    UInt8 reportID;
+    UInt8 buffer[kPTPMaxFeatureReport];
+    UInt16 length;
+    
+    if (!this->touchpadModes.buildLatencyModeReport(mode, &reportID, buffer, &length))
+        return kIOReturnUnsupported;
+    
+    uint64_t startTime = mach_absolute_time();
+    IOReturn ret = setReport(reportID, kIOHIDReportTypeFeature, buffer, length);
+    uint64_t endTime = mach_absolute_time();
+    if (ret != kIOReturnSuccess)
+        return ret;
+    
+    uint64_t now, switchNs;
+    absolutetime_to_nanoseconds(endTime, &now);
+    absolutetime_to_nanoseconds(endTime - startTime, &switchNs);
+    this->touchpadModes.modeChanged(mode, now, switchNs);
+    return kIOReturnSuccess;
+}
+
+static void i2c_hid_enterIdleLatency(VoodooI2CHIDDevice *device){
+    device->enterIdleLatency();
+}
+
+void VoodooI2CHIDDevice::latencyTimerFired(OSObject* owner, IOTimerEventSource* sender){
+    if (!this->DeviceIsAwake)
+        return;
+    
+    uint64_t now, remainingNs;
+    absolutetime_to_nanoseconds(mach_absolute_time(), &now);
+    if (!this->touchpadModes.idle(now, &remainingNs)){
+        if (remainingNs)
+            this->latencyTimer->setTimeoutUS((UInt32)(remainingNs / 1000) + 1);
+        return;
+    }
+    
+    //Interrupts run on this workloop too, so this can't race a reader being started
+    if (this->IsReading){
+        this->latencyTimer->setTimeoutMS(kLatencyRetryMs);
+        return;
+    }
+    
+    //The feature write blocks on the bus, keep it off the workloop like reads
+    this->IsReading = true;
+    thread_t newThread;
+    kern_return_t kr = kernel_thread_start((thread_continue_t)i2c_hid_enterIdleLatency, this, &newThread);
+    if (kr != KERN_SUCCESS){
+        this->IsReading = false;
+        this->latencyTimer->setTimeoutMS(kLatencyRetryMs);
+        recordDiagnostic(kVoodooI2CHIDLogThreadError, kr);
+    } else {
+        thread_deallocate(newThread);
+    }
+}
+
+void VoodooI2CHIDDevice::enterIdleLatency(){
+    setLatencyMode(kPTPLatencyHigh);
+    this->IsReading = false;
+}
+
+static void i2c_hid_enterAutosuspend(VoodooI2CHIDDevice *device){
+    device->enterAutosuspend();
+}
+
+void VoodooI2CHIDDevice::autosuspendTimerFired(OSObject* owner, IOTimerEventSource* sender){
+    if (!this->DeviceIsAwake || this->DeviceIsSuspended)
+        return;
+    
+    uint64_t quietNs, idleNs = (uint64_t)this->autosuspendIdleMs * 1000000ULL;
+    absolutetime_to_nanoseconds(mach_absolute_time() - this->lastInputAt, &quietNs);
+    if (quietNs < idleNs){
+        this->autosuspendTimer->setTimeoutUS((UInt32)((idleNs - quietNs) / 1000) + 1);
+        return;
+    }
+    
+    //Same as the latency switch, a reader can't start while we hold the workloop
+    if (this->IsReading){
+        this->autosuspendTimer->setTimeoutMS(kLatencyRetryMs);
+        return;
+    }
+    
+    this->IsReading = true;
+    thread_t newThread;
+    kern_return_t kr = kernel_thread_start((thread_continue_t)i2c_hid_enterAutosuspend, this, &newThread);
+    if (kr != KERN_SUCCESS){
+        this->IsReading = false;
+        this->autosuspendTimer->setTimeoutMS(kLatencyRetryMs);
+        recordDiagnostic(kVoodooI2CHIDLogThreadError, kr);
+    } else {
+        thread_deallocate(newThread);
+    }
+}
+
+void VoodooI2CHIDDevice::enterAutosuspend(){
+    this->trace.record(kVoodooI2CHIDTracePowerState, this->traceReport, 1, 0);
+    if (set_power(I2C_HID_PWR_SLEEP) == kIOReturnSuccess){
+        this->DeviceIsSuspended = true;
+        this->suspendedAt = mach_absolute_time();
+        this->autosuspend.suspends++;
+    } else {
+        this->autosuspendTimer->setTimeoutMS(this->autosuspendIdleMs);
+    }
+    this->IsReading = false;
+}
+
+void VoodooI2CHIDDevice::recordDiagnostic(VoodooI2CHIDLogCode code, UInt32 arg0, UInt32 arg1){
+    //Idle devices keep the drain timer disarmed until there is something to log
+    if (this->diagnosticLog.record(code, arg0, arg1) && this->logTimer)
+        this->logTimer->setTimeoutMS(kLogDrainMs);
+}
+
+void VoodooI2CHIDDevice::logTimerFired(OSObject* owner, IOTimerEventSource* sender){
+    if (this->diagnosticLog.drain(getName()))
+        this->logTimer->setTimeoutMS(kLogDrainMs);
+}
+
+void VoodooI2CHIDDevice::pollTimerFired(OSObject* owner, IOTimerEventSource* sender){
+    if (!this->DeviceIsAwake)
+        return;
+    
+    InterruptOccured(this, NULL, 0);
+    this->pollTimer->setTimeoutMS(this->quirks.pollIntervalMs);
+}
+
+void VoodooI2CHIDDevice::pacingTimerFired(OSObject* owner, IOTimerEventSource* sender){
+    if (this->wrapper)
+        this->framePacer.deliver(this->wrapper);
+}
+
+void VoodooI2CHIDDevice::resumeFromAutosuspend(){
+    this->trace.record(kVoodooI2CHIDTracePowerState, this->traceReport, 1, 1);
+    set_power(I2C_HID_PWR_ON);
+    
+    uint64_t now = mach_absolute_time();
+    uint64_t suspendedNs;
+    absolutetime_to_nanoseconds(now - this->suspendedAt, &suspendedNs);
+    this->autosuspend.suspendedNs += suspendedNs;
+    
+    this->lastInputAt = now;
+    this->DeviceIsSuspended = false;
+    if (this->autosuspendTimer)
+        this->autosuspendTimer->setTimeoutMS(this->autosuspendIdleMs);
+}
+
 IOReturn VoodooI2CHIDDevice::set_power(int power_state){
     uint8_t length = 4;
     
@@ -359,13 +1142,14 @@ IOReturn VoodooI2CHIDDevice::set_power(int power_state){
     cmd.c.opcode = 0x08;
     cmd.c.reportTypeID = power_state;
     
-    return writeI2C(cmd.data, length);
+    return writeI2C(kVoodooI2CHIDTransferManagement, cmd.data, length);
 }
 
 IOReturn VoodooI2CHIDDevice::reset_dev(){
+    this->trace.record(kVoodooI2CHIDTraceResetStart, this->traceReport);
     set_power(I2C_HID_PWR_ON);
     
-    IOSleep(1);
+    IOSleep(this->quirks.resetDelayMs);
     
     uint8_t length = 4;
     
@@ -374,7 +1158,35 @@ IOReturn VoodooI2CHIDDevice::reset_dev(){
     cmd.c.opcode = 0x01;
     cmd.c.reportTypeID = 0;
     
-    writeI2C(cmd.data, length);
+    //Polled devices have no interrupt to wait for
+    bool waitForReset = this->quirks.waitForReset && this->interruptSource;
+    if (waitForReset){
+        this->resetSignalled = false;
+        this->resetPending = true;
+    }
+    
+    writeI2C(kVoodooI2CHIDTransferManagement, cmd.data, length);
+    
+    if (waitForReset){
+        //The device ends a reset by raising its interrupt with an empty report in the input register
+        for (int waited = 0; !this->resetSignalled && waited < kVoodooI2CHIDResetCompleteTimeoutMs; waited++)
+            IOSleep(1);
+        
+        //Reading the empty report releases the interrupt line
+        UInt16 maxLen = this->inputReadLength;
+        UInt8 *report = (UInt8 *)IOMalloc(maxLen);
+        readI2C(kVoodooI2CHIDTransferManagement, report, maxLen);
+        IOFree(report, maxLen);
+        this->resetPending = false;
+        
+        if (this->resetSignalled)
+            this->trace.record(kVoodooI2CHIDTraceResetComplete, this->traceReport);
+        else
+            IOLog("%s::Reset did not complete within %dms\n", getName(), kVoodooI2CHIDResetCompleteTimeoutMs);
+    } else if (this->quirks.resetSettleMs){
+        //Nothing will tell us the reset is done, give the device the time it needs
+        IOSleep(this->quirks.resetSettleMs);
+    }
     return kIOReturnSuccess;
 }
 
@@ -428,42 +1240,187 @@ IOReturn VoodooI2CHIDDevice::setReport(UInt8 reportID, IOHIDReportType reportTyp
     
     memcpy(rawCmd + len, args, args_len);
     len += args_len;
-    IOReturn ret = writeI2C(rawCmd, len);
+    IOReturn ret = writeI2C(kVoodooI2CHIDTransferOutput, rawCmd, len);
     
     IOFree(cmd, 4+args_len);
     IOFree(args, args_len);
     return ret;
 }
 
-void VoodooI2CHIDDevice::get_input(OSObject* owner, IOTimerEventSource* sender) {
-    UInt16 maxLen = this->HIDDescriptor.wMaxInputLength;
+bool VoodooI2CHIDDevice::readInputReport(UInt8 *report, UInt16 maxLen){
+    if (readI2C(kVoodooI2CHIDTransferInput, report, maxLen) != kIOReturnSuccess)
+        return false;
+    UInt16 return_size = report[0] | report[1] << 8;
+    return return_size <= maxLen;
+}
+
+bool VoodooI2CHIDDevice::resyncInput(UInt8 *report, UInt16 maxLen){
+    //Escalate from cheapest to most expensive, stopping at the first tier that gets the device talking again
+    uint64_t startTime = mach_absolute_time();
+    bool recovered = false;
+    
+    //Tier 1: the glitch was transient, a single re-read returns a usable report
+    this->inputRecovery.retries++;
+    if (readInputReport(report, maxLen)){
+        recovered = true;
+        goto done;
+    }
     
-    unsigned char* report = (unsigned char *)IOMalloc(maxLen);
+    //Tier 2: drain whatever is queued until the device hands back an empty report
+    this->inputRecovery.flushes++;
+    for (int i = 0; i < kInputFlushMaxReads; i++){
+        if (readInputReport(report, maxLen) && (report[0] | report[1] << 8) <= 2){
+            report[0] = report[1] = 0;
+            recovered = true;
+            goto done;
+        }
+    }
     
-    readI2C(report, maxLen);
+    //Tier 3: power cycle the device without reinitializing it
+    this->inputRecovery.powerCycles++;
+    if (set_power(I2C_HID_PWR_SLEEP) == kIOReturnSuccess){
+        IOSleep(1);
+        if (set_power(I2C_HID_PWR_ON) == kIOReturnSuccess && readInputReport(report, maxLen)){
+            report[0] = report[1] = 0;
+            recovered = true;
+            goto done;
+        }
+    }
     
+    //Tier 4: full reset, which also drops the input and latency modes. The device is only back once a read makes sense again.
+    this->inputRecovery.resets++;
+    reset_dev();
+    setInputMode();
+    if (readInputReport(report, maxLen))
+        recovered = true;
+    report[0] = report[1] = 0;
+    
+done:
+    uint64_t elapsedNs;
+    absolutetime_to_nanoseconds(mach_absolute_time() - startTime, &elapsedNs);
+    if (elapsedNs > this->inputRecovery.maxRecoveryNs)
+        this->inputRecovery.maxRecoveryNs = elapsedNs;
+    if (!recovered)
+        this->inputRecovery.failures++;
+    return recovered;
+}
+
+bool VoodooI2CHIDDevice::dispatchInputReport(UInt8 *report, UInt16 maxLen, uint64_t readTime, bool expectEmpty){
     int return_size = report[0] | report[1] << 8;
-    if (return_size == 0) {
-        IOLog("%s::0 sized report!\n", getName());
-        this->IsReading = false;
-        return;
+    this->trace.record(kVoodooI2CHIDTraceLengthParsed, this->traceReport, 0, return_size);
+    //Anything up to the length header itself carries no report data, and the stages below take return_size - 2 as an unsigned length
+    if (return_size <= 2) {
+        if (!expectEmpty)
+            recordDiagnostic(kVoodooI2CHIDLogEmptyReport);
+        return false;
     }
     
     if (return_size > maxLen) {
-        IOLog("%s: Incomplete report %d/%d\n", getName(), maxLen, return_size);
-        this->IsReading = false;
-        return;
+        recordDiagnostic(kVoodooI2CHIDLogIncompleteReport, maxLen, return_size);
+        return false;
     }
     
+    //Rollover errors carry phantom state, and a repeat of the same keys tells the HID stack nothing new
+    VoodooI2CHIDKeyboardResult keys = this->keyboard.process(report + 2, return_size - 2);
+    if (keys == kKeyboardReportRollover){
+        recordDiagnostic(kVoodooI2CHIDLogKeyboardRollover, this->keyboard.lastErrorUsage);
+        return true;
+    }
+    if (keys == kKeyboardReportUnchanged && this->keyboard.isKeysOnly())
+        return true;
+    
+    this->touchTransform.process(report + 2, return_size - 2);
+    
+    //Predictions are pointless once delivery is held back to the next frame
+    bool havePrediction = false;
+    if (this->penFilter.isEnabled()){
+        uint64_t sampleTimeNs;
+        absolutetime_to_nanoseconds(readTime, &sampleTimeNs);
+        UInt8 *predicted = (this->predictionBuffer && !this->framePacer.isEnabled()) ? (UInt8 *)this->predictionBuffer->getBytesNoCopy() : NULL;
+        havePrediction = this->penFilter.process(report + 2, return_size - 2, sampleTimeNs, predicted);
+    }
     
-    IOBufferMemoryDescriptor *buffer = IOBufferMemoryDescriptor::inTaskWithOptions(kernel_task, 0, return_size);
-    buffer->writeBytes(0, report + 2, return_size - 2);
+    if (this->framePacer.isEnabled()){
+        UInt32 delayUs;
+        if (this->framePacer.enqueue(report + 2, return_size - 2, readTime, &delayUs))
+            this->pacingTimer->setTimeoutUS(delayUs);
+    } else {
+        IOBufferMemoryDescriptor *buffer = IOBufferMemoryDescriptor::inTaskWithOptions(kernel_task, 0, return_size);
+        buffer->writeBytes(0, report + 2, return_size - 2);
+        
+        this->trace.record(kVoodooI2CHIDTraceDispatchStart, this->traceReport, 0, return_size - 2);
+        IOReturn err = this->wrapper->handleReport(buffer, kIOHIDReportTypeInput);
+        this->trace.record(kVoodooI2CHIDTraceDispatchEnd, this->traceReport, 0, err);
+        if (err != kIOReturnSuccess)
+            recordDiagnostic(kVoodooI2CHIDLogReportError, err);
+        
+        buffer->release();
+        
+        //A report of its own right behind the real sample, in the vendor-defined prediction collection
+        if (havePrediction)
+            this->wrapper->handleReport(this->predictionBuffer, kIOHIDReportTypeInput);
+    }
     
-    IOReturn err = this->wrapper->handleReport(buffer, kIOHIDReportTypeInput);
-    if (err != kIOReturnSuccess)
-        IOLog("%s::Error handling report: 0x%.8x\n", getName(), err);
+    //Switch out of high-latency mode only after this report is delivered, the switch delays the next one
+    uint64_t readTimeNs;
+    absolutetime_to_nanoseconds(readTime, &readTimeNs);
+    if (this->touchpadModes.activity(readTimeNs)){
+        setLatencyMode(kPTPLatencyNormal);
+        if (this->latencyTimer)
+            this->latencyTimer->setTimeoutMS(kLatencyRetryMs);
+    }
+    return true;
+}
+
+void VoodooI2CHIDDevice::get_input(OSObject* owner, IOTimerEventSource* sender) {
+    UInt16 maxLen = this->inputReadLength;
+    
+    this->trace.record(kVoodooI2CHIDTraceReaderWake, this->traceReport);
+    
+    unsigned char* report = (unsigned char *)IOMalloc(maxLen);
+    
+    //The device raised this interrupt from SLEEP, it has to be powered on before the report can be read
+    bool resumed = this->DeviceIsSuspended;
+    if (resumed)
+        resumeFromAutosuspend();
+    
+    bool readOk = readInputReport(report, maxLen);
+    
+    //The report that woke us may not be latched yet right after SET_POWER(ON), poll briefly instead of dropping it
+    for (int i = 0; resumed && readOk && (report[0] | report[1] << 8) <= 2 && i < kAutosuspendWakeReads; i++){
+        IODelay(kAutosuspendWakeReadDelayUs);
+        readOk = readInputReport(report, maxLen);
+    }
+    
+    if (!readOk){
+        recordDiagnostic(kVoodooI2CHIDLogBadRead);
+        resyncInput(report, maxLen);
+    }
+    uint64_t readTime = mach_absolute_time();
+    this->lastInputAt = readTime;
+    
+    if (resumed){
+        if ((report[0] | report[1] << 8) > 2){
+            uint64_t wakeNs;
+            absolutetime_to_nanoseconds(readTime - this->interruptAt, &wakeNs);
+            this->autosuspend.lastWakeToReportNs = wakeNs;
+            if (wakeNs > this->autosuspend.maxWakeToReportNs)
+                this->autosuspend.maxWakeToReportNs = wakeNs;
+        } else {
+            this->autosuspend.emptyWakes++;
+        }
+    }
     
-    buffer->release();
+    //Polled devices have nothing to report most of the time
+    bool expectEmpty = this->quirks.pollIntervalMs != 0;
+    
+    //Devices that queue several reports behind one interrupt can be drained here instead of waiting for the next one
+    for (int drained = 0; dispatchInputReport(report, maxLen, readTime, expectEmpty) && this->quirks.multiReportDrain && drained < kInputFlushMaxReads; drained++){
+        if (!readInputReport(report, maxLen))
+            break;
+        readTime = mach_absolute_time();
+        expectEmpty = true;
+    }
     
     IOFree(report, maxLen);
     this->IsReading = false;
@@ -474,18 +1431,27 @@ static void i2c_hid_readReport(VoodooI2CHIDDevice *device){
 }
 
 void VoodooI2CHIDDevice::InterruptOccured(OSObject* owner, IOInterruptEventSource* src, int intCount){
-    if (this->IsReading)
+    //reset_dev is waiting for this one and reads the report itself
+    if (this->resetPending){
+        this->resetSignalled = true;
+        return;
+    }
+    if (this->IsReading){
+        this->trace.record(kVoodooI2CHIDTraceInterrupt, this->traceReport, 0, 1);
         return;
+    }
     if (!this->DeviceIsAwake)
         return;
     
     this->IsReading = true;
+    this->interruptAt = mach_absolute_time();
+    this->trace.record(kVoodooI2CHIDTraceInterrupt, ++this->traceReport);
     
     thread_t newThread;
     kern_return_t kr = kernel_thread_start((thread_continue_t)i2c_hid_readReport, this, &newThread);
     if (kr != KERN_SUCCESS){
         this->IsReading = false;
-        IOLog("%s::Thread error!\n", getName());
+        recordDiagnostic(kVoodooI2CHIDLogThreadError, kr);
     } else {
         thread_deallocate(newThread);
     }
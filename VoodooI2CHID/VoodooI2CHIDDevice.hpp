@@ -11,8 +11,21 @@
 
 #include <IOKit/IOService.h>
 #include <IOKit/acpi/IOACPIPlatformDevice.h>
+#include <IOKit/IOBufferMemoryDescriptor.h>
+#include <IOKit/IOTimerEventSource.h>
 #include <IOKit/hid/IOHIDDevice.h>
 #include "VoodooI2CControllerDriver.hpp"
+#include "VoodooI2CHIDTransferScheduler.hpp"
+#include "VoodooI2CHIDBusTiming.hpp"
+#include "VoodooI2CHIDReportDescriptor.hpp"
+#include "VoodooI2CHIDLog.hpp"
+#include "VoodooI2CHIDTrace.hpp"
+#include "VoodooI2CHIDQuirks.hpp"
+#include "VoodooI2CHIDFramePacer.hpp"
+#include "VoodooI2CHIDPenFilter.hpp"
+#include "VoodooI2CHIDTouchTransform.hpp"
+#include "VoodooI2CHIDKeyboard.hpp"
+#include "VoodooI2CHIDTouchpadModes.hpp"
 
 struct __attribute__((__packed__)) i2c_hid_descr {
     UInt16 wHIDDescLength;
@@ -31,12 +44,46 @@ struct __attribute__((__packed__)) i2c_hid_descr {
     UInt32 reserved;
 };
 
+struct i2c_hid_recovery_stats {
+    UInt64 retries;
+    UInt64 flushes;
+    UInt64 powerCycles;
+    UInt64 resets;
+    UInt64 failures;
+    UInt64 maxRecoveryNs;
+};
+
+//Upper bound on reads while draining a desynchronized device
+#define kInputFlushMaxReads 8
+
+//How long to wait before retrying an idle latency switch while a read is in flight
+#define kLatencyRetryMs 10
+
+//How often the diagnostic log is drained to the system log
+#define kLogDrainMs 1000
+
+//Most recent diagnostic records published in the registry
+#define kLogRecentRecords 32
+
+//Reads allowed for the pending report to show up after waking from autosuspend
+#define kAutosuspendWakeReads 5
+#define kAutosuspendWakeReadDelayUs 200
+
+struct i2c_hid_autosuspend_stats {
+    UInt64 suspends;
+    UInt64 suspendedNs;
+    UInt64 lastWakeToReportNs;
+    UInt64 maxWakeToReportNs;
+    UInt64 emptyWakes;
+};
+
 class VoodooI2CHIDDeviceWrapper;
 class VoodooI2CHIDDevice : public IOService
 {
     OSDeclareDefaultStructors(VoodooI2CHIDDevice);
 private:
     VoodooI2CControllerDriver *i2cController;
+    VoodooI2CHIDTransferScheduler *transferScheduler;
     IOService *provider;
     IOInterruptEventSource *interruptSource;
     
@@ -46,34 +93,106 @@ private:
     
     UInt16 i2cAddress;
     bool use10BitAddressing;
+    UInt32 connectionSpeed;
     UInt16 HIDDescriptorAddress;
     
+    VoodooI2CHIDQuirks quirks;
+    UInt16 inputReadLength;
+    IOTimerEventSource *pollTimer;
+    
+    VoodooI2CHIDBusTiming requestedTiming;
+    VoodooI2CHIDBusCounters busCounters;
+    
+#ifdef DEBUG
+    UInt32 faultInjectionInterval;
+    volatile SInt32 faultInjectionCounter;
+    volatile SInt64 injectedFaults;
+#endif
+    
+    struct i2c_hid_recovery_stats inputRecovery;
+    
+    VoodooI2CHIDLog diagnosticLog;
+    IOTimerEventSource *logTimer;
+    
+    VoodooI2CHIDFramePacer framePacer;
+    IOTimerEventSource *pacingTimer;
+    
+    VoodooI2CHIDTrace trace;
+    UInt32 traceReport;
+    
+    VoodooI2CHIDPenFilter penFilter;
+    IOBufferMemoryDescriptor *predictionBuffer;
+    VoodooI2CHIDTouchTransform touchTransform;
+    
+    VoodooI2CHIDTouchpadModes touchpadModes;
+    IOTimerEventSource *latencyTimer;
+    
+    UInt32 autosuspendIdleMs;
+    IOTimerEventSource *autosuspendTimer;
+    bool DeviceIsSuspended;
+    uint64_t suspendedAt;
+    uint64_t interruptAt;
+    uint64_t lastInputAt;
+    struct i2c_hid_autosuspend_stats autosuspend;
+    
     bool DeviceIsAwake;
     bool IsReading;
+    volatile bool resetPending;
+    volatile bool resetSignalled;
     
     IOReturn getDescriptorAddress(IOACPIPlatformDevice *acpiDevice);
+    UInt32 getConnectionSpeed(IOACPIPlatformDevice *acpiDevice);
     
-    IOReturn readI2C(UInt8 *values, UInt16 len);
-    IOReturn writeI2C(UInt8 *values, UInt16 len);
-    IOReturn writeReadI2C(UInt8 *writeBuf, UInt16 writeLen, UInt8 *readBuf, UInt16 readLen);
+    IOReturn transferI2C(VoodooI2CHIDTransferClass transferClass, VoodooI2CControllerBusMessage *msgs, int number);
+    IOReturn readI2C(VoodooI2CHIDTransferClass transferClass, UInt8 *values, UInt16 len);
+    IOReturn writeI2C(VoodooI2CHIDTransferClass transferClass, UInt8 *values, UInt16 len);
+    IOReturn writeReadI2C(VoodooI2CHIDTransferClass transferClass, UInt8 *writeBuf, UInt16 writeLen, UInt8 *readBuf, UInt16 readLen);
     
+    bool probeKeyboard(IOService *provider);
     IOReturn fetchHIDDescriptor();
+    void applyQuirks();
     IOReturn fetchReportDescriptor();
+    void configurePenFilter();
+    bool extendReportDescriptorForPrediction();
+    void configureTouchTransform();
+    void configureTouchpadModes();
+    
+    IOReturn setInputMode();
+    IOReturn setLatencyMode(int mode);
+    void latencyTimerFired(OSObject* owner, IOTimerEventSource* sender);
+    
+    void autosuspendTimerFired(OSObject* owner, IOTimerEventSource* sender);
+    void resumeFromAutosuspend();
+    
+    void recordDiagnostic(VoodooI2CHIDLogCode code, UInt32 arg0 = 0, UInt32 arg1 = 0);
+    void logTimerFired(OSObject* owner, IOTimerEventSource* sender);
+    void pollTimerFired(OSObject* owner, IOTimerEventSource* sender);
+    void pacingTimerFired(OSObject* owner, IOTimerEventSource* sender);
     
     IOReturn set_power(int power_state);
     IOReturn reset_dev();
     
+    bool readInputReport(UInt8 *report, UInt16 maxLen);
+    bool resyncInput(UInt8 *report, UInt16 maxLen);
+    bool dispatchInputReport(UInt8 *report, UInt16 maxLen, uint64_t readTime, bool expectEmpty);
+    
 public:
-    UInt8 *ReportDesc;
+    IOBufferMemoryDescriptor *ReportDesc;
     UInt16 ReportDescLength;
+    VoodooI2CHIDReportDescriptor reportDescriptor;
+    VoodooI2CHIDKeyboard keyboard;
     
     struct i2c_hid_descr HIDDescriptor;
     
+    virtual IOService *probe(IOService *provider, SInt32 *score) override;
     virtual bool start(IOService *provider) override;
     virtual void stop(IOService *provider) override;
     virtual IOReturn setPowerState(unsigned long powerState, IOService *whatDevice) override;
+    virtual bool serializeProperties(OSSerialize *serialize) const override;
     
     void get_input(OSObject* owner, IOTimerEventSource* sender);
+    void enterIdleLatency();
+    void enterAutosuspend();
     
     IOReturn setReport(UInt8 reportID, IOHIDReportType reportType, UInt8 *buf, UInt16 buf_len);
     
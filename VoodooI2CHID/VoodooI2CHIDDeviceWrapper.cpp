@@ -17,19 +17,20 @@ bool VoodooI2CHIDDeviceWrapper::start(IOService *provider) {
     
     this->provider = OSDynamicCast(VoodooI2CHIDDevice, provider);
     
-    setProperty("HIDDefaultBehavior", OSString::withCString("Mouse"));
+    if (isPrimaryKeyboard())
+        setProperty("HIDDefaultBehavior", OSString::withCString("Keyboard"));
+    else
+        setProperty("HIDDefaultBehavior", OSString::withCString("Mouse"));
     return IOHIDDevice::start(provider);
 }
 
 IOReturn VoodooI2CHIDDeviceWrapper::newReportDescriptor(IOMemoryDescriptor **descriptor) const {
-    if (this->provider->ReportDescLength == 0)
+    if (!this->provider->ReportDesc)
         return kIOReturnDeviceError;
     
-    IOBufferMemoryDescriptor *buffer = IOBufferMemoryDescriptor::inTaskWithOptions(kernel_task, 0, this->provider->ReportDescLength);
-    if (!buffer)
-        return kIOReturnNoResources;
-    buffer->writeBytes(0, this->provider->ReportDesc, this->provider->ReportDescLength);
-    *descriptor = buffer;
+    //Hand out the shared descriptor by reference; the caller releases its retain when done
+    this->provider->ReportDesc->retain();
+    *descriptor = this->provider->ReportDesc;
     return kIOReturnSuccess;
 }
 
@@ -67,7 +68,17 @@ OSString* VoodooI2CHIDDeviceWrapper::newManufacturerString() const {
     return OSString::withCString("Apple");
 }
 
+//Composite devices keep presenting as a mouse unless the keyboard is their first application
+bool VoodooI2CHIDDeviceWrapper::isPrimaryKeyboard() const {
+    const VoodooI2CHIDReportDescriptor *descriptor = &this->provider->reportDescriptor;
+    return descriptor->applicationCount > 0 &&
+        descriptor->applications[0].usagePage == kHIDPage_GenericDesktop &&
+        descriptor->applications[0].usage == kHIDUsage_GD_Keyboard;
+}
+
 OSNumber* VoodooI2CHIDDeviceWrapper::newPrimaryUsageNumber() const {
+    if (isPrimaryKeyboard())
+        return OSNumber::withNumber(kHIDUsage_GD_Keyboard, 32);
     return OSNumber::withNumber(kHIDUsage_GD_Mouse, 32);
 }
 
@@ -27,6 +27,9 @@ public:
     virtual OSString* newManufacturerString() const override;
     virtual OSNumber* newPrimaryUsageNumber() const override;
     virtual OSNumber* newPrimaryUsagePageNumber() const override;
+    
+private:
+    bool isPrimaryKeyboard() const;
 };
 
 #endif /* VoodooI2CHIDDeviceWrapper_hpp */
@@ -0,0 +1,231 @@
+//
+//  VoodooI2CHIDFramePacer.cpp
+//  VoodooI2CHID
+//
+//  Created on 10/19/26.
+//  Copyright © 2026 VoodooI2C contributors. All rights reserved.
+//
+
+#include "VoodooI2CHIDFramePacer.hpp"
+
+static bool isStateField(const VoodooI2CHIDField *field){
+    if (field->reportType != kIOHIDReportTypeInput || (field->flags & kVoodooI2CHIDFieldConstant))
+        return false;
+
+    //Arrays hold whichever keys or buttons are down, single bits are buttons, tip, range and confidence
+    if (!(field->flags & kVoodooI2CHIDFieldVariable) || field->bitSize == 1)
+        return true;
+    return field->usagePage == kHIDPage_Digitizer &&
+           (field->usage == kFramePacerUsageContactIdentifier || field->usage == kFramePacerUsageContactCount);
+}
+
+bool VoodooI2CHIDFramePacer::configure(const VoodooI2CHIDReportDescriptor *descriptor, UInt32 intervalMs, bool intermediates, UInt16 maxReportLength){
+    this->enabled = false;
+    this->lock = NULL;
+    this->queue.storage = NULL;
+    this->batch.storage = NULL;
+    memset(&this->stats, 0, sizeof(this->stats));
+
+    if (!intervalMs || !maxReportLength)
+        return false;
+
+    this->descriptor = descriptor;
+    this->intermediates = intermediates;
+    this->slotLength = maxReportLength;
+    nanoseconds_to_absolutetime((uint64_t)intervalMs * 1000000ULL, &this->interval);
+
+    //Without the full set of fields to compare, replacing could hide a transition
+    this->stateFieldCount = 0;
+    this->canReplace = true;
+    for (int i = 0; i < descriptor->fieldCount; i++){
+        if (!isStateField(&descriptor->fields[i]))
+            continue;
+        if (this->stateFieldCount == kFramePacerStateFields){
+            this->canReplace = false;
+            break;
+        }
+        this->stateFields[this->stateFieldCount++] = &descriptor->fields[i];
+    }
+
+    this->lock = IOLockAlloc();
+    this->queue.storage = (UInt8 *)IOMalloc(kFramePacerSlots * this->slotLength);
+    this->batch.storage = (UInt8 *)IOMalloc(kFramePacerSlots * this->slotLength);
+    if (!this->lock || !this->queue.storage || !this->batch.storage){
+        release();
+        return false;
+    }
+
+    this->queue.first = this->queue.count = 0;
+    this->batch.first = this->batch.count = 0;
+    this->armed = false;
+    this->lastFrameAt = 0;
+    this->enabled = true;
+    return true;
+}
+
+void VoodooI2CHIDFramePacer::release(){
+    this->enabled = false;
+    if (this->queue.storage){
+        IOFree(this->queue.storage, kFramePacerSlots * this->slotLength);
+        this->queue.storage = NULL;
+    }
+    if (this->batch.storage){
+        IOFree(this->batch.storage, kFramePacerSlots * this->slotLength);
+        this->batch.storage = NULL;
+    }
+    if (this->lock){
+        IOLockFree(this->lock);
+        this->lock = NULL;
+    }
+}
+
+VoodooI2CHIDPacerMatch VoodooI2CHIDFramePacer::compare(const UInt8 *queuedReport, UInt16 queuedLength, const UInt8 *report, UInt16 length) const {
+    UInt8 queuedID, id;
+    UInt8 *queuedData, *data;
+    UInt32 queuedDataLength, dataLength;
+    if (!this->descriptor->reportData((UInt8 *)queuedReport, queuedLength, &queuedID, &queuedData, &queuedDataLength) ||
+        !this->descriptor->reportData((UInt8 *)report, length, &id, &data, &dataLength) ||
+        queuedID != id)
+        return kPacerMatchOtherStream;
+    if (queuedLength != length)
+        return kPacerMatchChanged;
+
+    bool changed = false;
+    for (int i = 0; i < this->stateFieldCount; i++){
+        const VoodooI2CHIDField *field = this->stateFields[i];
+        if (field->reportID != id)
+            continue;
+
+        //Array fields cover count elements, compare each
+        VoodooI2CHIDField element = *field;
+        for (int j = 0; j < field->count; j++){
+            element.bitOffset = field->bitOffset + j * field->bitSize;
+            if (VoodooI2CHIDReportDescriptor::getUnsigned(queuedData, queuedDataLength, &element) ==
+                VoodooI2CHIDReportDescriptor::getUnsigned(data, dataLength, &element))
+                continue;
+            //Hybrid-mode reports carry different contacts under the same report ID
+            if (field->usagePage == kHIDPage_Digitizer && field->usage == kFramePacerUsageContactIdentifier)
+                return kPacerMatchOtherStream;
+            changed = true;
+        }
+    }
+    return changed ? kPacerMatchChanged : kPacerMatchSameState;
+}
+
+bool VoodooI2CHIDFramePacer::enqueue(const UInt8 *report, UInt16 length, uint64_t timestamp, UInt32 *delayUs){
+    if (length > this->slotLength)
+        length = this->slotLength;
+
+    IOLockLock(this->lock);
+    VoodooI2CHIDPacerQueue *queue = &this->queue;
+
+    //Only the newest queued report of the same stream is a candidate, replacing anything older would reorder a transition
+    int slot = -1;
+    if (!this->intermediates && this->canReplace){
+        for (int i = queue->count - 1; i >= 0; i--){
+            int candidate = (queue->first + i) % kFramePacerSlots;
+            VoodooI2CHIDPacerMatch match = compare(slotData(queue, candidate), queue->reports[candidate].length, report, length);
+            if (match == kPacerMatchOtherStream)
+                continue;
+            if (match == kPacerMatchSameState){
+                slot = candidate;
+                this->stats.replaced++;
+            }
+            break;
+        }
+    }
+
+    if (slot < 0){
+        //The newest report always makes it into the frame, the oldest gives way
+        if (queue->count == kFramePacerSlots){
+            queue->first = (queue->first + 1) % kFramePacerSlots;
+            queue->count--;
+            this->stats.overflowed++;
+        }
+        slot = (queue->first + queue->count) % kFramePacerSlots;
+        queue->count++;
+    }
+
+    memcpy(slotData(queue, slot), report, length);
+    queue->reports[slot].length = length;
+    queue->reports[slot].timestamp = timestamp;
+    this->stats.queued++;
+
+    bool arm = !this->armed;
+    if (arm){
+        //Hold the frame until a full interval has passed since the last one
+        this->armed = true;
+        uint64_t now = mach_absolute_time();
+        uint64_t delayNs = 0;
+        if (now - this->lastFrameAt < this->interval)
+            absolutetime_to_nanoseconds(this->interval - (now - this->lastFrameAt), &delayNs);
+        *delayUs = (UInt32)(delayNs / 1000);
+    }
+    IOLockUnlock(this->lock);
+    return arm;
+}
+
+void VoodooI2CHIDFramePacer::deliver(IOHIDDevice *target){
+    VoodooI2CHIDPacerQueue *batch = &this->batch;
+
+    IOLockLock(this->lock);
+    VoodooI2CHIDPacerQueue *queue = &this->queue;
+    for (int i = 0; i < queue->count; i++){
+        int slot = (queue->first + i) % kFramePacerSlots;
+        memcpy(slotData(batch, i), slotData(queue, slot), queue->reports[slot].length);
+        batch->reports[i] = queue->reports[slot];
+    }
+    batch->count = queue->count;
+    queue->first = queue->count = 0;
+    this->armed = false;
+    uint64_t now = mach_absolute_time();
+    this->lastFrameAt = now;
+    IOLockUnlock(this->lock);
+
+    if (!batch->count)
+        return;
+
+    UInt64 delivered = 0, totalDelayNs = 0, maxDelayNs = 0;
+    for (int i = 0; i < batch->count; i++){
+        VoodooI2CHIDPacedReport *paced = &batch->reports[i];
+        
+        IOBufferMemoryDescriptor *buffer = IOBufferMemoryDescriptor::inTaskWithOptions(kernel_task, 0, paced->length);
+        if (!buffer)
+            continue;
+        buffer->writeBytes(0, slotData(batch, i), paced->length);
+        
+        //Keep the time each report was read, consumers that use intermediate samples need it
+        target->handleReportWithTime(paced->timestamp, buffer, kIOHIDReportTypeInput);
+        buffer->release();
+        
+        uint64_t delayNs;
+        absolutetime_to_nanoseconds(now - paced->timestamp, &delayNs);
+        totalDelayNs += delayNs;
+        if (delayNs > maxDelayNs)
+            maxDelayNs = delayNs;
+        delivered++;
+    }
+    batch->count = 0;
+
+    //Counted under the lock like enqueue's, so a snapshot never sees half a frame
+    IOLockLock(this->lock);
+    this->stats.delivered += delivered;
+    this->stats.totalDelayNs += totalDelayNs;
+    if (maxDelayNs > this->stats.maxDelayNs)
+        this->stats.maxDelayNs = maxDelayNs;
+    this->stats.frames++;
+    IOLockUnlock(this->lock);
+}
+
+void VoodooI2CHIDFramePacer::reset(){
+    IOLockLock(this->lock);
+    this->queue.first = this->queue.count = 0;
+    this->armed = false;
+    IOLockUnlock(this->lock);
+}
+
+void VoodooI2CHIDFramePacer::copyStatistics(VoodooI2CHIDPacerStats *stats) const {
+    IOLockLock(this->lock);
+    *stats = this->stats;
+    IOLockUnlock(this->lock);
+}
@@ -0,0 +1,103 @@
+//
+//  VoodooI2CHIDFramePacer.hpp
+//  VoodooI2CHID
+//
+//  Created on 10/19/26.
+//  Copyright © 2026 VoodooI2C contributors. All rights reserved.
+//
+
+#ifndef VoodooI2CHIDFramePacer_hpp
+#define VoodooI2CHIDFramePacer_hpp
+
+#include <IOKit/IOLib.h>
+#include <IOKit/IOLocks.h>
+#include <IOKit/IOBufferMemoryDescriptor.h>
+#include <IOKit/hid/IOHIDDevice.h>
+#include "VoodooI2CHIDReportDescriptor.hpp"
+
+//Reports held per frame, the oldest are dropped past this
+#define kFramePacerSlots 16
+
+//Fields compared to decide whether a newer report may replace a queued one
+#define kFramePacerStateFields 64
+
+//Digitizer usages that tell hybrid-mode reports of the same frame apart
+#define kFramePacerUsageContactIdentifier 0x51
+#define kFramePacerUsageContactCount 0x54
+
+typedef struct {
+    uint64_t timestamp;
+    UInt16 length;
+} VoodooI2CHIDPacedReport;
+
+enum VoodooI2CHIDPacerMatch {
+    kPacerMatchOtherStream = 0,     //Another report ID or another contact
+    kPacerMatchSameState,
+    kPacerMatchChanged
+};
+
+typedef struct {
+    UInt64 queued;
+    UInt64 delivered;
+    UInt64 frames;
+    UInt64 replaced;
+    UInt64 overflowed;
+    UInt64 totalDelayNs;
+    UInt64 maxDelayNs;
+} VoodooI2CHIDPacerStats;
+
+typedef struct {
+    VoodooI2CHIDPacedReport reports[kFramePacerSlots];
+    UInt8 *storage;
+    UInt8 first;
+    UInt8 count;
+} VoodooI2CHIDPacerQueue;
+
+//Holds decoded input reports and hands them to the HID stack in batches, at most once per interval.
+//By default a frame carries only the latest state: a newer report replaces the queued one for the same
+//report ID and contact unless buttons, tip and range bits or the contact count changed in between,
+//so transitions and every report of a hybrid-mode frame still get through.
+class VoodooI2CHIDFramePacer {
+public:
+    //With intermediates, every report is queued and delivered for consumers that use each sample
+    bool configure(const VoodooI2CHIDReportDescriptor *descriptor, UInt32 intervalMs, bool intermediates, UInt16 maxReportLength);
+    void release();
+    bool isEnabled() const { return this->enabled; }
+
+    //Returns true when the caller has to arm the delivery timer, delayUs from now
+    bool enqueue(const UInt8 *report, UInt16 length, uint64_t timestamp, UInt32 *delayUs);
+
+    //Only called from the delivery timer
+    void deliver(IOHIDDevice *target);
+
+    //Drops anything queued, for when the delivery timer is cancelled
+    void reset();
+
+    //Consistent snapshot of the counters, which enqueue and deliver update from different threads
+    void copyStatistics(VoodooI2CHIDPacerStats *stats) const;
+
+private:
+    bool enabled;
+    bool intermediates;
+    UInt16 slotLength;
+    uint64_t interval;
+
+    const VoodooI2CHIDReportDescriptor *descriptor;
+    const VoodooI2CHIDField *stateFields[kFramePacerStateFields];
+    UInt8 stateFieldCount;
+    bool canReplace;
+
+    IOLock *lock;
+    VoodooI2CHIDPacerStats stats;
+    VoodooI2CHIDPacerQueue queue;
+    bool armed;
+    uint64_t lastFrameAt;
+
+    //Private to deliver, filled under the lock so reports are handed out without holding it
+    VoodooI2CHIDPacerQueue batch;
+
+    UInt8 *slotData(VoodooI2CHIDPacerQueue *queue, int slot) const { return queue->storage + slot * this->slotLength; }
+    VoodooI2CHIDPacerMatch compare(const UInt8 *queuedReport, UInt16 queuedLength, const UInt8 *report, UInt16 length) const;
+};
+
+#endif /* VoodooI2CHIDFramePacer_hpp */
@@ -0,0 +1,115 @@
+//
+//  VoodooI2CHIDKeyboard.cpp
+//  VoodooI2CHID
+//
+//  Created on 10/19/26.
+//  Copyright © 2026 VoodooI2C contributors. All rights reserved.
+//
+
+#include "VoodooI2CHIDKeyboard.hpp"
+
+bool VoodooI2CHIDKeyboard::configure(const VoodooI2CHIDReportDescriptor *descriptor){
+    this->descriptor = descriptor;
+    this->enabled = false;
+    this->keysOnly = true;
+    this->reports = 0;
+    this->presses = 0;
+    this->releases = 0;
+    this->duplicates = 0;
+    this->rolloverErrors = 0;
+    this->lastErrorUsage = 0;
+    memset(this->state, 0, sizeof(this->state));
+
+    bool found = false;
+    for (int i = 0; i < descriptor->fieldCount; i++){
+        const VoodooI2CHIDField *field = &descriptor->fields[i];
+        if (field->reportType != kIOHIDReportTypeInput || field->usagePage != kHIDPage_KeyboardOrKeypad)
+            continue;
+        if (field->application >= descriptor->applicationCount ||
+            descriptor->applications[field->application].usagePage != kHIDPage_GenericDesktop ||
+            descriptor->applications[field->application].usage != kHIDUsage_GD_Keyboard)
+            continue;
+
+        if (!found){
+            this->reportID = field->reportID;
+            this->firstKeyField = i;
+            found = true;
+        }
+        if (field->reportID == this->reportID)
+            this->lastKeyField = i;
+    }
+    if (!found)
+        return false;
+
+    for (int i = 0; i < descriptor->fieldCount; i++){
+        const VoodooI2CHIDField *field = &descriptor->fields[i];
+        if (field->reportType == kIOHIDReportTypeInput && field->reportID == this->reportID && field->usagePage != kHIDPage_KeyboardOrKeypad)
+            this->keysOnly = false;
+    }
+
+    this->enabled = true;
+    return true;
+}
+
+VoodooI2CHIDKeyboardResult VoodooI2CHIDKeyboard::process(const UInt8 *report, UInt32 length){
+    if (!this->enabled)
+        return kKeyboardReportIgnored;
+
+    UInt8 id;
+    UInt8 *data;
+    UInt32 dataLength;
+    if (!this->descriptor->reportData((UInt8 *)report, length, &id, &data, &dataLength) || id != this->reportID)
+        return kKeyboardReportIgnored;
+
+    this->reports++;
+
+    UInt32 current[kKeyboardStateWords];
+    memset(current, 0, sizeof(current));
+
+    for (int i = this->firstKeyField; i <= this->lastKeyField; i++){
+        const VoodooI2CHIDField *field = &this->descriptor->fields[i];
+        if (field->reportID != this->reportID || field->usagePage != kHIDPage_KeyboardOrKeypad)
+            continue;
+
+        if (field->flags & kVoodooI2CHIDFieldVariable){
+            if (field->usage < 256 && VoodooI2CHIDReportDescriptor::getUnsigned(data, dataLength, field))
+                current[field->usage / 32] |= 1U << (field->usage % 32);
+            continue;
+        }
+
+        //Array of pressed usages, one slot per simultaneous key
+        VoodooI2CHIDField slot = *field;
+        for (int j = 0; j < field->count; j++){
+            slot.bitOffset = field->bitOffset + j * field->bitSize;
+            SInt32 value = VoodooI2CHIDReportDescriptor::getValue(data, dataLength, &slot);
+            if (value < field->logicalMin || value > field->logicalMax)
+                continue;
+            UInt32 usage = field->usage + (value - field->logicalMin);
+            if (usage == kHIDUsage_KeyboardErrorRollOver || usage == kHIDUsage_KeyboardPOSTFail || usage == kHIDUsage_KeyboardErrorUndefined){
+                //Phantom state, keep the last good state and drop the report
+                this->rolloverErrors++;
+                this->lastErrorUsage = usage;
+                return kKeyboardReportRollover;
+            }
+            if (usage != 0 && usage < 256)
+                current[usage / 32] |= 1U << (usage % 32);
+        }
+    }
+
+    UInt32 changed = 0;
+    for (int w = 0; w < kKeyboardStateWords; w++){
+        UInt32 diff = current[w] ^ this->state[w];
+        if (!diff)
+            continue;
+        this->presses += __builtin_popcount(diff & current[w]);
+        this->releases += __builtin_popcount(diff & this->state[w]);
+        this->state[w] = current[w];
+        changed |= diff;
+    }
+
+    if (!changed){
+        this->duplicates++;
+        return kKeyboardReportUnchanged;
+    }
+    return kKeyboardReportChanged;
+}
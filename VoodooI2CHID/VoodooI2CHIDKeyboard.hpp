@@ -0,0 +1,59 @@
+//
+//  VoodooI2CHIDKeyboard.hpp
+//  VoodooI2CHID
+//
+//  Created on 10/19/26.
+//  Copyright © 2026 VoodooI2C contributors. All rights reserved.
+//
+
+#ifndef VoodooI2CHIDKeyboard_hpp
+#define VoodooI2CHIDKeyboard_hpp
+
+#include "VoodooI2CHIDReportDescriptor.hpp"
+
+//One bit per usage on the keyboard page
+#define kKeyboardStateWords (256 / 32)
+
+enum VoodooI2CHIDKeyboardResult {
+    kKeyboardReportIgnored = 0,
+    kKeyboardReportChanged,
+    kKeyboardReportUnchanged,
+    kKeyboardReportRollover
+};
+
+//Tracks key state as a usage bitmap and diffs consecutive keyboard reports. The diff only
+//decides whether a report changes anything; key events still come from the HID stack
+//parsing the full report, so a report is either delivered whole or dropped.
+class VoodooI2CHIDKeyboard {
+public:
+    UInt64 reports;
+    UInt64 presses;
+    UInt64 releases;
+    UInt64 duplicates;
+    UInt64 rolloverErrors;
+
+    //Error usage (ErrorRollOver, POSTFail or ErrorUndefined) of the last dropped report
+    UInt32 lastErrorUsage;
+
+    bool configure(const VoodooI2CHIDReportDescriptor *descriptor);
+    bool isEnabled() const { return this->enabled; }
+
+    //Only reports made up entirely of key fields are safe to drop when nothing changed
+    bool isKeysOnly() const { return this->keysOnly; }
+
+    VoodooI2CHIDKeyboardResult process(const UInt8 *report, UInt32 length);
+
+private:
+    const VoodooI2CHIDReportDescriptor *descriptor;
+    bool enabled;
+    bool keysOnly;
+    UInt8 reportID;
+
+    //Key fields are contiguous in the descriptor's field table
+    UInt16 firstKeyField;
+    UInt16 lastKeyField;
+
+    UInt32 state[kKeyboardStateWords];
+};
+
+#endif /* VoodooI2CHIDKeyboard_hpp */
@@ -0,0 +1,181 @@
+//
+//  VoodooI2CHIDLog.cpp
+//  VoodooI2CHID
+//
+//  Created on 10/19/26.
+//  Copyright © 2026 VoodooI2C contributors. All rights reserved.
+//
+
+#include "VoodooI2CHIDLog.hpp"
+
+static const char *logFormats[kVoodooI2CHIDLogCodeCount] = {
+    "Bad input read, resyncing",
+    "0 sized report!",
+    "Incomplete report %u/%u",
+    "Error handling report: 0x%.8x",
+    "Thread error! 0x%.8x",
+    "Keyboard error usage 0x%x, report dropped"
+};
+
+static const char *logNames[kVoodooI2CHIDLogCodeCount] = {
+    "BadRead",
+    "EmptyReport",
+    "IncompleteReport",
+    "ReportError",
+    "ThreadError",
+    "KeyboardRollover"
+};
+
+void VoodooI2CHIDLog::init(){
+    memset(this->records, 0, sizeof(this->records));
+    memset(this->limits, 0, sizeof(this->limits));
+    this->head = 0;
+    this->tail = 0;
+    this->drainPending = 0;
+    this->overruns = 0;
+    nanoseconds_to_absolutetime((uint64_t)kVoodooI2CHIDLogRateWindowMs * 1000000ULL, &this->rateWindow);
+}
+
+bool VoodooI2CHIDLog::record(VoodooI2CHIDLogCode code, UInt32 arg0, UInt32 arg1, UInt32 arg2){
+    if (code >= kVoodooI2CHIDLogCodeCount)
+        return false;
+
+    uint64_t now = mach_absolute_time();
+    VoodooI2CHIDLogLimit *limit = &this->limits[code];
+
+    //Racing window resets only let a few extra records through, not worth a lock
+    if (now - limit->windowStart >= this->rateWindow){
+        limit->windowStart = now;
+        limit->windowCount = 0;
+    }
+    if (OSIncrementAtomic(&limit->windowCount) >= kVoodooI2CHIDLogRateLimit){
+        OSIncrementAtomic64(&limit->dropped);
+        return false;
+    }
+    OSIncrementAtomic64(&limit->recorded);
+
+    UInt32 sequence = (UInt32)OSIncrementAtomic(&this->head);
+    VoodooI2CHIDLogRecord *record = &this->records[sequence & (kVoodooI2CHIDLogRecords - 1)];
+
+    record->committed = 0;
+    OSMemoryBarrier();
+    record->code = code;
+    record->timestamp = now;
+    record->args[0] = arg0;
+    record->args[1] = arg1;
+    record->args[2] = arg2;
+    OSMemoryBarrier();
+    record->committed = sequence + 1;
+
+    return OSCompareAndSwap(0, 1, &this->drainPending);
+}
+
+bool VoodooI2CHIDLog::readRecord(UInt32 sequence, VoodooI2CHIDLogRecord *out) const {
+    const VoodooI2CHIDLogRecord *record = &this->records[sequence & (kVoodooI2CHIDLogRecords - 1)];
+    if (record->committed != sequence + 1)
+        return false;
+    OSMemoryBarrier();
+    memcpy(out, record, sizeof(*out));
+    OSMemoryBarrier();
+
+    //A producer lapped us while copying
+    return record->committed == sequence + 1;
+}
+
+void VoodooI2CHIDLog::format(const VoodooI2CHIDLogRecord *record, char *line, size_t length){
+    uint64_t timestampNs;
+    absolutetime_to_nanoseconds(record->timestamp, &timestampNs);
+
+    char message[kVoodooI2CHIDLogMaxLine];
+    snprintf(message, sizeof(message), logFormats[record->code], record->args[0], record->args[1], record->args[2]);
+    snprintf(line, length, "[%llu.%06llu] %s", timestampNs / 1000000000ULL, (timestampNs / 1000ULL) % 1000000ULL, message);
+}
+
+bool VoodooI2CHIDLog::drain(const char *name){
+    //Cleared before sampling head, anything recorded after this schedules its own drain
+    this->drainPending = 0;
+    OSMemoryBarrier();
+    UInt32 head = (UInt32)this->head;
+
+    if (head - this->tail > kVoodooI2CHIDLogRecords){
+        this->overruns += head - this->tail - kVoodooI2CHIDLogRecords;
+        this->tail = head - kVoodooI2CHIDLogRecords;
+    }
+
+    char line[kVoodooI2CHIDLogMaxLine];
+    VoodooI2CHIDLogRecord record;
+    while (this->tail != head){
+        //Still being written, pick it up next time
+        if (!readRecord(this->tail, &record)){
+            if (((UInt32)this->head - this->tail) <= kVoodooI2CHIDLogRecords)
+                break;
+            this->overruns++;
+            this->tail++;
+            continue;
+        }
+        format(&record, line, sizeof(line));
+        IOLog("%s::%s\n", name, line);
+        this->tail++;
+    }
+
+    if (this->tail == head)
+        return false;
+    return OSCompareAndSwap(0, 1, &this->drainPending);
+}
+
+OSArray *VoodooI2CHIDLog::copyRecent(unsigned int count) const {
+    UInt32 head = (UInt32)this->head;
+    if (count > kVoodooI2CHIDLogRecords)
+        count = kVoodooI2CHIDLogRecords;
+    if (count > head)
+        count = head;
+
+    OSArray *array = OSArray::withCapacity(count ? count : 1);
+    if (!array)
+        return NULL;
+
+    char line[kVoodooI2CHIDLogMaxLine];
+    VoodooI2CHIDLogRecord record;
+    for (UInt32 sequence = head - count; sequence != head; sequence++){
+        if (!readRecord(sequence, &record))
+            continue;
+        format(&record, line, sizeof(line));
+        OSString *string = OSString::withCString(line);
+        if (string){
+            array->setObject(string);
+            string->release();
+        }
+    }
+    return array;
+}
+
+OSDictionary *VoodooI2CHIDLog::copyStatistics() const {
+    OSDictionary *stats = OSDictionary::withCapacity(kVoodooI2CHIDLogCodeCount + 1);
+    if (!stats)
+        return NULL;
+
+    for (int i = 0; i < kVoodooI2CHIDLogCodeCount; i++){
+        OSDictionary *code = OSDictionary::withCapacity(2);
+        if (!code)
+            continue;
+        OSNumber *recorded = OSNumber::withNumber((UInt64)this->limits[i].recorded, 64);
+        OSNumber *dropped = OSNumber::withNumber((UInt64)this->limits[i].dropped, 64);
+        if (recorded){
+            code->setObject("Recorded", recorded);
+            recorded->release();
+        }
+        if (dropped){
+            code->setObject("RateLimited", dropped);
+            dropped->release();
+        }
+        stats->setObject(logNames[i], code);
+        code->release();
+    }
+
+    OSNumber *overruns = OSNumber::withNumber(this->overruns, 64);
+    if (overruns){
+        stats->setObject("Overruns", overruns);
+        overruns->release();
+    }
+    return stats;
+}
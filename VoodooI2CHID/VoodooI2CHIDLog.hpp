@@ -0,0 +1,84 @@
+//
+//  VoodooI2CHIDLog.hpp
+//  VoodooI2CHID
+//
+//  Created on 10/19/26.
+//  Copyright © 2026 VoodooI2C contributors. All rights reserved.
+//
+
+#ifndef VoodooI2CHIDLog_hpp
+#define VoodooI2CHIDLog_hpp
+
+#include <IOKit/IOLib.h>
+#include <libkern/OSAtomic.h>
+#include <libkern/c++/OSArray.h>
+#include <libkern/c++/OSDictionary.h>
+#include <libkern/c++/OSNumber.h>
+#include <libkern/c++/OSString.h>
+
+//Must be a power of two
+#define kVoodooI2CHIDLogRecords 256
+
+//Records allowed per event code in each rate window, the rest are only counted
+#define kVoodooI2CHIDLogRateLimit 16
+#define kVoodooI2CHIDLogRateWindowMs 1000
+
+#define kVoodooI2CHIDLogMaxLine 128
+
+enum VoodooI2CHIDLogCode {
+    kVoodooI2CHIDLogBadRead = 0,
+    kVoodooI2CHIDLogEmptyReport,
+    kVoodooI2CHIDLogIncompleteReport,
+    kVoodooI2CHIDLogReportError,
+    kVoodooI2CHIDLogThreadError,
+    kVoodooI2CHIDLogKeyboardRollover,
+    kVoodooI2CHIDLogCodeCount
+};
+
+typedef struct {
+    UInt32 committed;
+    UInt16 code;
+    UInt16 reserved;
+    UInt64 timestamp;
+    UInt32 args[3];
+} VoodooI2CHIDLogRecord;
+
+typedef struct {
+    UInt64 windowStart;
+    volatile SInt32 windowCount;
+    volatile SInt64 recorded;
+    volatile SInt64 dropped;
+} VoodooI2CHIDLogLimit;
+
+//Lock-free per-device ring of binary diagnostic records. Any thread may record;
+//formatting is left to a single consumer that drains the ring well off the input path.
+class VoodooI2CHIDLog {
+public:
+    void init();
+
+    //Returns true when this is the first record since the last drain, the caller should schedule one
+    bool record(VoodooI2CHIDLogCode code, UInt32 arg0 = 0, UInt32 arg1 = 0, UInt32 arg2 = 0);
+
+    //Formats and IOLogs everything recorded since the last drain. Only one thread may drain.
+    //Returns true when records were left behind and another drain should be scheduled.
+    bool drain(const char *name);
+    bool isDrainPending() const { return this->drainPending != 0; }
+
+    //Non-destructive copy of the most recent records, formatted, for the registry
+    OSArray *copyRecent(unsigned int count) const;
+    OSDictionary *copyStatistics() const;
+
+private:
+    VoodooI2CHIDLogRecord records[kVoodooI2CHIDLogRecords];
+    VoodooI2CHIDLogLimit limits[kVoodooI2CHIDLogCodeCount];
+    volatile SInt32 head;
+    UInt32 tail;
+    volatile UInt32 drainPending;
+    UInt64 overruns;
+    uint64_t rateWindow;
+
+    bool readRecord(UInt32 sequence, VoodooI2CHIDLogRecord *out) const;
+    static void format(const VoodooI2CHIDLogRecord *record, char *line, size_t length);
+};
+
+#endif /* VoodooI2CHIDLog_hpp */
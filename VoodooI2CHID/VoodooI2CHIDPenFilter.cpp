@@ -0,0 +1,176 @@
+//
+//  VoodooI2CHIDPenFilter.cpp
+//  VoodooI2CHID
+//
+//  Created on 10/19/26.
+//  Copyright © 2026 VoodooI2C contributors. All rights reserved.
+//
+
+#include "VoodooI2CHIDPenFilter.hpp"
+
+static SInt32 clampToField(const VoodooI2CHIDField *field, SInt64 value){
+    if (value < field->logicalMin)
+        return field->logicalMin;
+    if (field->logicalMax > field->logicalMin && value > field->logicalMax)
+        return field->logicalMax;
+    return (SInt32)value;
+}
+
+static void writeLittleEndian(UInt8 *buffer, UInt32 value, int bytes){
+    for (int i = 0; i < bytes; i++)
+        buffer[i] = (value >> (8 * i)) & 0xFF;
+}
+
+bool VoodooI2CHIDPenFilter::configure(const VoodooI2CHIDReportDescriptor *descriptor, UInt32 weight, UInt32 predictionUs){
+    this->descriptor = descriptor;
+    this->enabled = false;
+    this->tracking = false;
+    this->touching = false;
+    this->samples = 0;
+    this->predictions = 0;
+    memset(this->axes, 0, sizeof(this->axes));
+    this->inRange = NULL;
+    this->tipSwitch = NULL;
+    this->predictedID = 0;
+
+    if (weight == 0 || weight > kPenFilterWeightOne)
+        weight = kPenFilterWeightOne;
+    this->weight = weight;
+    if (predictionUs > kPenPredictionMaxUs)
+        predictionUs = kPenPredictionMaxUs;
+    this->predictionUs = predictionUs;
+
+    if (weight == kPenFilterWeightOne && predictionUs == 0)
+        return false;
+
+    //Only X/Y inside a pen application collection belong to us
+    const VoodooI2CHIDField *x = NULL;
+    while ((x = descriptor->findField(kIOHIDReportTypeInput, kHIDPage_GenericDesktop, kHIDUsage_GD_X, x))){
+        if (x->application < descriptor->applicationCount &&
+            descriptor->applications[x->application].usagePage == kHIDPage_Digitizer &&
+            descriptor->applications[x->application].usage == kHIDUsage_Dig_Pen)
+            break;
+    }
+    if (!x)
+        return false;
+
+    this->reportID = x->reportID;
+    this->axes[kPenAxisX] = x;
+    this->axes[kPenAxisY] = descriptor->findFieldInReport(kIOHIDReportTypeInput, this->reportID, kHIDPage_GenericDesktop, kHIDUsage_GD_Y);
+    if (!this->axes[kPenAxisY])
+        return false;
+    this->axes[kPenAxisXTilt] = descriptor->findFieldInReport(kIOHIDReportTypeInput, this->reportID, kHIDPage_Digitizer, kHIDUsage_Dig_XTilt);
+    this->axes[kPenAxisYTilt] = descriptor->findFieldInReport(kIOHIDReportTypeInput, this->reportID, kHIDPage_Digitizer, kHIDUsage_Dig_YTilt);
+    this->inRange = descriptor->findFieldInReport(kIOHIDReportTypeInput, this->reportID, kHIDPage_Digitizer, kHIDUsage_Dig_InRange);
+    this->tipSwitch = descriptor->findFieldInReport(kIOHIDReportTypeInput, this->reportID, kHIDPage_Digitizer, kHIDUsage_Dig_TipSwitch);
+
+    //Predicted samples need a report ID nothing else uses, which a descriptor without IDs can't give them
+    if (this->predictionUs && descriptor->usesReportIDs){
+        for (int id = 0xFF; id > 0 && !this->predictedID; id--){
+            if (!descriptor->reportIDInUse((UInt8)id))
+                this->predictedID = (UInt8)id;
+        }
+    }
+    if (!this->predictedID)
+        this->predictionUs = 0;
+    if (this->weight == kPenFilterWeightOne && this->predictionUs == 0)
+        return false;
+
+    this->enabled = true;
+    return true;
+}
+
+UInt32 VoodooI2CHIDPenFilter::predictionDescriptor(UInt8 *buffer, UInt32 capacity) const {
+    if (!this->predictionUs || capacity < kPenPredictionDescriptorLength)
+        return 0;
+
+    UInt8 *p = buffer;
+    *p++ = 0x06; writeLittleEndian(p, kPenPredictionUsagePage, 2); p += 2;     //Usage Page (Vendor Defined)
+    *p++ = 0x09; *p++ = kPenPredictionUsage;                                  //Usage (Predicted Pen Sample)
+    *p++ = 0xA1; *p++ = 0x01;                                                 //Collection (Application)
+    *p++ = 0x85; *p++ = this->predictedID;                                    //  Report ID
+    for (int i = kPenAxisX; i <= kPenAxisY; i++){
+        *p++ = 0x09; *p++ = i == kPenAxisX ? kPenPredictionUsageX : kPenPredictionUsageY;
+        *p++ = 0x17; writeLittleEndian(p, (UInt32)this->axes[i]->logicalMin, 4); p += 4;   //  Logical Minimum, as the pen's
+        *p++ = 0x27; writeLittleEndian(p, (UInt32)this->axes[i]->logicalMax, 4); p += 4;   //  Logical Maximum, as the pen's
+        *p++ = 0x75; *p++ = 32;                                               //  Report Size (32)
+        *p++ = 0x95; *p++ = 1;                                                //  Report Count (1)
+        *p++ = 0x81; *p++ = 0x02;                                             //  Input (Data, Variable, Absolute)
+    }
+    *p++ = 0x09; *p++ = kPenPredictionUsageLead;                              //  Usage (Lead)
+    *p++ = 0x15; *p++ = 0x00;                                                 //  Logical Minimum (0)
+    *p++ = 0x27; writeLittleEndian(p, 0xFFFF, 4); p += 4;                     //  Logical Maximum (65535)
+    *p++ = 0x75; *p++ = 16;                                                   //  Report Size (16)
+    *p++ = 0x95; *p++ = 1;                                                    //  Report Count (1)
+    *p++ = 0x81; *p++ = 0x02;                                                 //  Input (Data, Variable, Absolute)
+    *p++ = 0xC0;                                                              //End Collection
+    return (UInt32)(p - buffer);
+}
+
+bool VoodooI2CHIDPenFilter::process(UInt8 *report, UInt32 length, UInt64 timestampNs, UInt8 *predicted){
+    if (!this->enabled)
+        return false;
+
+    UInt8 id;
+    UInt8 *data;
+    UInt32 dataLength;
+    if (!this->descriptor->reportData(report, length, &id, &data, &dataLength) || id != this->reportID)
+        return false;
+
+    this->samples++;
+
+    if (this->inRange && !VoodooI2CHIDReportDescriptor::getUnsigned(data, dataLength, this->inRange)){
+        this->tracking = false;
+        return false;
+    }
+    bool touch = !this->tipSwitch || VoodooI2CHIDReportDescriptor::getUnsigned(data, dataLength, this->tipSwitch);
+
+    UInt64 dtUs = (timestampNs - this->lastTimestampNs) / 1000;
+    this->lastTimestampNs = timestampNs;
+
+    //Positions are kept in 24.8 fixed point, velocities in 24.8 units per millisecond.
+    //Strokes start and end where the tip actually touched and lifted, so contact changes restart the filter.
+    if (!this->tracking || dtUs == 0 || dtUs > kPenFilterMaxGapUs || touch != this->touching){
+        for (int i = 0; i < kPenAxisCount; i++){
+            if (this->axes[i])
+                this->smoothed[i] = (SInt64)VoodooI2CHIDReportDescriptor::getValue(data, dataLength, this->axes[i]) * kPenFilterWeightOne;
+        }
+        this->lastRaw[0] = this->smoothed[kPenAxisX];
+        this->lastRaw[1] = this->smoothed[kPenAxisY];
+        this->velocity[0] = this->velocity[1] = 0;
+        this->tracking = true;
+        this->touching = touch;
+        return false;
+    }
+
+    for (int i = 0; i < kPenAxisCount; i++){
+        const VoodooI2CHIDField *field = this->axes[i];
+        if (!field)
+            continue;
+
+        SInt64 raw = (SInt64)VoodooI2CHIDReportDescriptor::getValue(data, dataLength, field) * kPenFilterWeightOne;
+        this->smoothed[i] += (raw - this->smoothed[i]) * this->weight / kPenFilterWeightOne;
+
+        if (i <= kPenAxisY){
+            SInt64 instant = (raw - this->lastRaw[i]) * 1000 / (SInt64)dtUs;
+            this->velocity[i] += (instant - this->velocity[i]) * kPenVelocityWeight / kPenFilterWeightOne;
+            this->lastRaw[i] = raw;
+        }
+
+        VoodooI2CHIDReportDescriptor::setValue(data, dataLength, field, clampToField(field, this->smoothed[i] / kPenFilterWeightOne));
+    }
+
+    //Hovering strokes aren't drawn, there is nothing to hide the latency of
+    if (!this->predictionUs || !touch || !predicted)
+        return false;
+
+    predicted[0] = this->predictedID;
+    for (int i = kPenAxisX; i <= kPenAxisY; i++){
+        SInt64 ahead = this->smoothed[i] + this->velocity[i] * (SInt64)this->predictionUs / 1000;
+        writeLittleEndian(predicted + 1 + 4 * i, (UInt32)clampToField(this->axes[i], ahead / kPenFilterWeightOne), 4);
+    }
+    writeLittleEndian(predicted + 9, this->predictionUs, 2);
+
+    this->predictions++;
+    return true;
+}
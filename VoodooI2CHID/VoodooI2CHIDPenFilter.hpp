@@ -0,0 +1,84 @@
+//
+//  VoodooI2CHIDPenFilter.hpp
+//  VoodooI2CHID
+//
+//  Created on 10/19/26.
+//  Copyright © 2026 VoodooI2C contributors. All rights reserved.
+//
+
+#ifndef VoodooI2CHIDPenFilter_hpp
+#define VoodooI2CHIDPenFilter_hpp
+
+#include "VoodooI2CHIDReportDescriptor.hpp"
+
+#define kPenFilterWeightOne 256
+
+//Samples further apart than this restart the filter instead of being blended
+#define kPenFilterMaxGapUs 50000
+
+//Velocity for prediction is blended at this weight whatever the position smoothing
+#define kPenVelocityWeight 128
+
+//Predictions further ahead than this are mostly error
+#define kPenPredictionMaxUs 20000
+
+//Predicted samples go out in a vendor-defined application of their own, so the HID
+//event system never mistakes them for the pen and clients that want them can find them
+#define kPenPredictionUsagePage kHIDPage_VendorDefinedStart
+#define kPenPredictionUsage 0x50
+#define kPenPredictionUsageX 0x51
+#define kPenPredictionUsageY 0x52
+#define kPenPredictionUsageLead 0x53
+
+//Report ID, X and Y as 32 bits each, then the lead in microseconds as 16 bits
+#define kPenPredictionReportLength 11
+#define kPenPredictionDescriptorLength 61
+
+//Smoothed and predicted axes, pressure and the tip switch pass through untouched
+enum {
+    kPenAxisX = 0,
+    kPenAxisY,
+    kPenAxisXTilt,
+    kPenAxisYTilt,
+    kPenAxisCount
+};
+
+//Fixed-cost smoothing and short-horizon prediction of pen samples, run in place on raw input reports
+class VoodooI2CHIDPenFilter {
+public:
+    UInt64 samples;
+    UInt64 predictions;
+
+    bool configure(const VoodooI2CHIDReportDescriptor *descriptor, UInt32 weight, UInt32 predictionUs);
+    bool isEnabled() const { return this->enabled; }
+    bool isPredicting() const { return this->predictionUs != 0; }
+    UInt8 predictionReportID() const { return this->predictedID; }
+
+    //Writes the application collection describing predicted samples, to be appended to the device's report descriptor
+    UInt32 predictionDescriptor(UInt8 *buffer, UInt32 capacity) const;
+
+    //Smooths the report in place. Returns true when predicted holds a kPenPredictionReportLength byte
+    //report of where the pen will be predictionUs after this sample; predicted may be NULL.
+    bool process(UInt8 *report, UInt32 length, UInt64 timestampNs, UInt8 *predicted);
+
+private:
+    const VoodooI2CHIDReportDescriptor *descriptor;
+    bool enabled;
+    UInt8 reportID;
+    const VoodooI2CHIDField *axes[kPenAxisCount];
+    const VoodooI2CHIDField *inRange;
+    const VoodooI2CHIDField *tipSwitch;
+
+    UInt32 weight;
+    UInt32 predictionUs;
+    UInt8 predictedID;
+
+    bool tracking;
+    bool touching;
+    UInt64 lastTimestampNs;
+    SInt64 smoothed[kPenAxisCount];
+    SInt64 lastRaw[2];
+    SInt64 velocity[2];
+};
+
+#endif /* VoodooI2CHIDPenFilter_hpp */
@@ -0,0 +1,74 @@
+//
+//  VoodooI2CHIDQuirks.hpp
+//  VoodooI2CHID
+//
+//  Created on 10/19/26.
+//  Copyright © 2026 VoodooI2C contributors. All rights reserved.
+//
+
+#ifndef VoodooI2CHIDQuirks_hpp
+#define VoodooI2CHIDQuirks_hpp
+
+#include <IOKit/IOLib.h>
+
+// Per-device behaviour, selected from wVendorID/wProductID once the HID
+// descriptor has been read. Every field can also be overridden from the
+// personality with the Quirk* property of the same name.
+
+#define kVoodooI2CHIDQuirkAnyID 0xFFFF
+
+// Upper bound on waiting for the interrupt that signals reset complete
+#define kVoodooI2CHIDResetCompleteTimeoutMs 100
+
+typedef struct {
+    UInt16 resetDelayMs;        //Delay between SET_POWER(ON) and RESET
+    bool waitForReset;          //Wait for the interrupt that ends a reset instead of assuming it's done
+    UInt16 resetSettleMs;       //Delay after RESET for devices that never signal its completion
+    UInt16 maxInputLength;      //Read this many bytes instead of wMaxInputLength, 0 to trust the descriptor. Clamped to [2, wMaxInputLength].
+    bool multiReportDrain;      //Keep reading after a report until the device returns an empty one
+    UInt16 pollIntervalMs;      //Poll the input register instead of using the interrupt, 0 for interrupts
+    bool relaxedDescriptor;     //Accept descriptors with an unexpected bcdVersion or length
+} VoodooI2CHIDQuirks;
+
+typedef struct {
+    UInt16 vendorID;
+    UInt16 productID;
+    VoodooI2CHIDQuirks quirks;
+} VoodooI2CHIDQuirkEntry;
+
+// The last entry matches everything and holds the defaults. Waiting for reset
+// completion is opt-in, from a device entry or QuirkWaitForReset.
+static constexpr VoodooI2CHIDQuirkEntry kVoodooI2CHIDQuirkTable[] = {
+    //Hantick 5288 and Raydium 3118 touchpads never signal reset completion, give them the 100ms Linux does instead
+    { 0x0911, 0x5288, { 1, false, 100, 0, false, 0, false } },
+    { 0x2386, 0x3118, { 1, false, 100, 0, false, 0, false } },
+    
+    { kVoodooI2CHIDQuirkAnyID, kVoodooI2CHIDQuirkAnyID, { 1, false, 0, 0, false, 0, false } }
+};
+
+#define kVoodooI2CHIDQuirkCount (sizeof(kVoodooI2CHIDQuirkTable) / sizeof(kVoodooI2CHIDQuirkTable[0]))
+
+static constexpr bool VoodooI2CHIDQuirkMatches(const VoodooI2CHIDQuirkEntry &entry, UInt16 vendorID, UInt16 productID){
+    return (entry.vendorID == kVoodooI2CHIDQuirkAnyID || entry.vendorID == vendorID) &&
+           (entry.productID == kVoodooI2CHIDQuirkAnyID || entry.productID == productID);
+}
+
+// First matching entry wins, so specific devices must come before vendor-wide entries
+static constexpr unsigned int VoodooI2CHIDQuirkIndex(UInt16 vendorID, UInt16 productID, unsigned int index = 0){
+    return index >= kVoodooI2CHIDQuirkCount - 1 ? kVoodooI2CHIDQuirkCount - 1 :
+           VoodooI2CHIDQuirkMatches(kVoodooI2CHIDQuirkTable[index], vendorID, productID) ? index :
+           VoodooI2CHIDQuirkIndex(vendorID, productID, index + 1);
+}
+
+static constexpr const VoodooI2CHIDQuirks &VoodooI2CHIDQuirksFor(UInt16 vendorID, UInt16 productID){
+    return kVoodooI2CHIDQuirkTable[VoodooI2CHIDQuirkIndex(vendorID, productID)].quirks;
+}
+
+static_assert(VoodooI2CHIDQuirkMatches(kVoodooI2CHIDQuirkTable[kVoodooI2CHIDQuirkCount - 1], 0, 0),
+              "The last quirk entry must match every device");
+static_assert(VoodooI2CHIDQuirkIndex(0x0911, 0x5288) == 0 && VoodooI2CHIDQuirksFor(0x0911, 0x5288).resetSettleMs == 100,
+              "Quirk lookup must find device entries");
+static_assert(VoodooI2CHIDQuirkIndex(0x0911, 0x0001) == kVoodooI2CHIDQuirkCount - 1,
+              "Quirk lookup must fall back to the defaults");
+
+#endif /* VoodooI2CHIDQuirks_hpp */
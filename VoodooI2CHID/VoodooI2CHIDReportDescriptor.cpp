@@ -0,0 +1,372 @@
+//
+//  VoodooI2CHIDReportDescriptor.cpp
+//  VoodooI2CHID
+//
+//  Created on 10/19/26.
+//  Copyright © 2026 VoodooI2C contributors. All rights reserved.
+//
+
+#include "VoodooI2CHIDReportDescriptor.hpp"
+
+#define HID_ITEM_TYPE_MAIN 0
+#define HID_ITEM_TYPE_GLOBAL 1
+#define HID_ITEM_TYPE_LOCAL 2
+#define HID_ITEM_LONG 0xFE
+
+#define HID_MAIN_INPUT 0x8
+#define HID_MAIN_OUTPUT 0x9
+#define HID_MAIN_COLLECTION 0xA
+#define HID_MAIN_FEATURE 0xB
+#define HID_MAIN_END_COLLECTION 0xC
+
+#define HID_GLOBAL_USAGE_PAGE 0x0
+#define HID_GLOBAL_LOGICAL_MIN 0x1
+#define HID_GLOBAL_LOGICAL_MAX 0x2
+#define HID_GLOBAL_REPORT_SIZE 0x7
+#define HID_GLOBAL_REPORT_ID 0x8
+#define HID_GLOBAL_REPORT_COUNT 0x9
+#define HID_GLOBAL_PUSH 0xA
+#define HID_GLOBAL_POP 0xB
+
+#define HID_LOCAL_USAGE 0x0
+#define HID_LOCAL_USAGE_MIN 0x1
+#define HID_LOCAL_USAGE_MAX 0x2
+
+#define HID_COLLECTION_APPLICATION 0x01
+
+struct hid_globals {
+    UInt16 usagePage;
+    SInt32 logicalMin;
+    SInt32 logicalMax;
+    UInt32 reportSize;
+    UInt32 reportCount;
+    UInt8 reportID;
+};
+
+struct hid_usage {
+    UInt16 page;
+    UInt16 usage;
+};
+
+bool VoodooI2CHIDReportDescriptor::parseItems(const UInt8 *descriptor, UInt32 length){
+    this->fieldCount = 0;
+    this->applicationCount = 0;
+    this->reportCount = 0;
+    this->usesReportIDs = false;
+
+    struct hid_globals globals;
+    memset(&globals, 0, sizeof(globals));
+    struct hid_globals globalStack[kVoodooI2CHIDMaxGlobalStack];
+    int globalDepth = 0;
+
+    struct hid_usage usages[kVoodooI2CHIDMaxUsages];
+    int usageCount = 0;
+    UInt32 usageMin = 0;
+    UInt32 usageMax = 0;
+    bool haveUsageMin = false;
+    bool haveUsageMax = false;
+
+    UInt16 collections = 0;
+    UInt16 collectionStack[kVoodooI2CHIDMaxCollectionDepth];
+    int collectionDepth = 0;
+    UInt8 application = 0xFF;
+
+    UInt32 offset = 0;
+    while (offset < length){
+        UInt8 prefix = descriptor[offset++];
+
+        if (prefix == HID_ITEM_LONG){
+            if (offset + 2 > length)
+                return false;
+            offset += 2 + descriptor[offset];
+            continue;
+        }
+
+        UInt32 size = prefix & 0x3;
+        if (size == 3)
+            size = 4;
+        UInt8 type = (prefix >> 2) & 0x3;
+        UInt8 tag = prefix >> 4;
+
+        if (offset + size > length)
+            return false;
+
+        UInt32 udata = 0;
+        for (UInt32 i = 0; i < size; i++)
+            udata |= (UInt32)descriptor[offset + i] << (8 * i);
+        SInt32 sdata = (SInt32)udata;
+        if (size == 1)
+            sdata = (SInt8)udata;
+        else if (size == 2)
+            sdata = (SInt16)udata;
+        offset += size;
+
+        switch (type){
+            case HID_ITEM_TYPE_GLOBAL:
+                switch (tag){
+                    case HID_GLOBAL_USAGE_PAGE:
+                        globals.usagePage = udata;
+                        break;
+                    case HID_GLOBAL_LOGICAL_MIN:
+                        globals.logicalMin = sdata;
+                        break;
+                    case HID_GLOBAL_LOGICAL_MAX:
+                        //A positive maximum is unsigned unless the minimum is negative
+                        globals.logicalMax = (globals.logicalMin < 0) ? sdata : (SInt32)udata;
+                        break;
+                    case HID_GLOBAL_REPORT_SIZE:
+                        globals.reportSize = udata;
+                        break;
+                    case HID_GLOBAL_REPORT_ID:
+                        globals.reportID = udata;
+                        this->usesReportIDs = true;
+                        break;
+                    case HID_GLOBAL_REPORT_COUNT:
+                        globals.reportCount = udata;
+                        break;
+                    case HID_GLOBAL_PUSH:
+                        if (globalDepth < kVoodooI2CHIDMaxGlobalStack)
+                            globalStack[globalDepth++] = globals;
+                        break;
+                    case HID_GLOBAL_POP:
+                        if (globalDepth > 0)
+                            globals = globalStack[--globalDepth];
+                        break;
+                }
+                break;
+            case HID_ITEM_TYPE_LOCAL:
+                switch (tag){
+                    case HID_LOCAL_USAGE:
+                        if (usageCount < kVoodooI2CHIDMaxUsages){
+                            usages[usageCount].page = (size == 4) ? (udata >> 16) : globals.usagePage;
+                            usages[usageCount].usage = udata & 0xFFFF;
+                            usageCount++;
+                        }
+                        break;
+                    case HID_LOCAL_USAGE_MIN:
+                        usageMin = udata;
+                        haveUsageMin = true;
+                        break;
+                    case HID_LOCAL_USAGE_MAX:
+                        usageMax = udata;
+                        haveUsageMax = true;
+                        break;
+                }
+                break;
+            case HID_ITEM_TYPE_MAIN: {
+                if (tag == HID_MAIN_COLLECTION){
+                    UInt16 usagePage = usageCount ? usages[0].page : globals.usagePage;
+                    UInt16 usage = usageCount ? usages[0].usage : 0;
+                    if (udata == HID_COLLECTION_APPLICATION && collectionDepth == 0 && this->applicationCount < kVoodooI2CHIDMaxApplications){
+                        application = this->applicationCount;
+                        this->applications[this->applicationCount].usagePage = usagePage;
+                        this->applications[this->applicationCount].usage = usage;
+                        this->applicationCount++;
+                    }
+                    if (collectionDepth < kVoodooI2CHIDMaxCollectionDepth)
+                        collectionStack[collectionDepth] = ++collections;
+                    collectionDepth++;
+                } else if (tag == HID_MAIN_END_COLLECTION){
+                    if (collectionDepth > 0)
+                        collectionDepth--;
+                    if (collectionDepth == 0)
+                        application = 0xFF;
+                } else if (tag == HID_MAIN_INPUT || tag == HID_MAIN_OUTPUT || tag == HID_MAIN_FEATURE){
+                    UInt8 reportType = (tag == HID_MAIN_INPUT) ? kIOHIDReportTypeInput : ((tag == HID_MAIN_OUTPUT) ? kIOHIDReportTypeOutput : kIOHIDReportTypeFeature);
+                    UInt32 *bits = reportBits(reportType, globals.reportID, true);
+                    if (!bits)
+                        return false;
+
+                    UInt8 flags = 0;
+                    if (udata & 0x01)
+                        flags |= kVoodooI2CHIDFieldConstant;
+                    if (udata & 0x02)
+                        flags |= kVoodooI2CHIDFieldVariable;
+
+                    UInt16 collection = 0;
+                    if (collectionDepth > 0)
+                        collection = collectionStack[(collectionDepth > kVoodooI2CHIDMaxCollectionDepth ? kVoodooI2CHIDMaxCollectionDepth : collectionDepth) - 1];
+
+                    //Variable items get one field per count, arrays one field covering the whole usage range
+                    UInt32 count = (flags & kVoodooI2CHIDFieldVariable) ? globals.reportCount : 1;
+
+                    for (UInt32 i = 0; i < count; i++){
+                        if (!(flags & kVoodooI2CHIDFieldConstant) && this->fieldCount < kVoodooI2CHIDMaxFields){
+                            VoodooI2CHIDField *field = &this->fields[this->fieldCount++];
+                            field->reportID = globals.reportID;
+                            field->reportType = reportType;
+                            field->flags = flags;
+                            field->bitSize = globals.reportSize;
+                            field->count = (flags & kVoodooI2CHIDFieldVariable) ? 1 : globals.reportCount;
+                            field->bitOffset = *bits + i * globals.reportSize;
+                            field->collection = collection;
+                            field->application = application;
+                            field->logicalMin = globals.logicalMin;
+                            field->logicalMax = globals.logicalMax;
+                            field->usagePage = globals.usagePage;
+
+                            if (haveUsageMin && haveUsageMax){
+                                if (usageMin > 0xFFFF)
+                                    field->usagePage = usageMin >> 16;
+                                UInt32 usage = (flags & kVoodooI2CHIDFieldVariable) ? usageMin + i : usageMin;
+                                if (usage > usageMax)
+                                    usage = usageMax;
+                                field->usage = usage & 0xFFFF;
+                                field->usageMax = (flags & kVoodooI2CHIDFieldVariable) ? field->usage : (usageMax & 0xFFFF);
+                            } else if (usageCount > 0){
+                                int index = (i < (UInt32)usageCount) ? i : usageCount - 1;
+                                field->usagePage = usages[index].page;
+                                field->usage = usages[index].usage;
+                                field->usageMax = field->usage;
+                            } else {
+                                field->usage = 0;
+                                field->usageMax = 0;
+                            }
+                        }
+                    }
+                    *bits += globals.reportSize * globals.reportCount;
+                }
+
+                usageCount = 0;
+                haveUsageMin = false;
+                haveUsageMax = false;
+                break;
+            }
+        }
+    }
+    return true;
+}
+
+bool VoodooI2CHIDReportDescriptor::parse(const UInt8 *descriptor, UInt32 length){
+    if (parseItems(descriptor, length))
+        return true;
+    //Never hand out half of a malformed descriptor
+    this->fieldCount = 0;
+    this->applicationCount = 0;
+    this->reportCount = 0;
+    return false;
+}
+
+UInt32 *VoodooI2CHIDReportDescriptor::reportBits(UInt8 reportType, UInt8 reportID, bool create){
+    if (reportType >= 3)
+        return NULL;
+    for (int i = 0; i < this->reportCount; i++){
+        if (this->reports[i].reportID == reportID)
+            return &this->reports[i].bits[reportType];
+    }
+    if (!create || this->reportCount >= kVoodooI2CHIDMaxReports)
+        return NULL;
+    this->reports[this->reportCount].reportID = reportID;
+    memset(this->reports[this->reportCount].bits, 0, sizeof(this->reports[this->reportCount].bits));
+    return &this->reports[this->reportCount++].bits[reportType];
+}
+
+UInt32 VoodooI2CHIDReportDescriptor::reportLength(UInt8 reportType, UInt8 reportID) const {
+    if (reportType >= 3)
+        return 0;
+    for (int i = 0; i < this->reportCount; i++){
+        if (this->reports[i].reportID == reportID)
+            return (this->reports[i].bits[reportType] + 7) / 8;
+    }
+    return 0;
+}
+
+bool VoodooI2CHIDReportDescriptor::reportIDInUse(UInt8 reportID) const {
+    if (this->reportCount >= kVoodooI2CHIDMaxReports)
+        return true;
+    for (int i = 0; i < this->reportCount; i++){
+        if (this->reports[i].reportID == reportID)
+            return true;
+    }
+    return false;
+}
+
+const VoodooI2CHIDField *VoodooI2CHIDReportDescriptor::findField(UInt8 reportType, UInt16 usagePage, UInt16 usage, const VoodooI2CHIDField *after) const {
+    int start = after ? (int)(after - this->fields) + 1 : 0;
+    for (int i = start; i < this->fieldCount; i++){
+        const VoodooI2CHIDField *field = &this->fields[i];
+        if (field->reportType == reportType && field->usagePage == usagePage && usage >= field->usage && usage <= field->usageMax)
+            return field;
+    }
+    return NULL;
+}
+
+const VoodooI2CHIDField *VoodooI2CHIDReportDescriptor::findFieldInReport(UInt8 reportType, UInt8 reportID, UInt16 usagePage, UInt16 usage, const VoodooI2CHIDField *after) const {
+    const VoodooI2CHIDField *field = after;
+    while ((field = findField(reportType, usagePage, usage, field))){
+        if (field->reportID == reportID)
+            return field;
+    }
+    return NULL;
+}
+
+bool VoodooI2CHIDReportDescriptor::hasApplication(UInt16 usagePage, UInt16 usage) const {
+    for (int i = 0; i < this->applicationCount; i++){
+        if (this->applications[i].usagePage == usagePage && this->applications[i].usage == usage)
+            return true;
+    }
+    return false;
+}
+
+bool VoodooI2CHIDReportDescriptor::reportData(UInt8 *report, UInt32 length, UInt8 *reportID, UInt8 **data, UInt32 *dataLength) const {
+    if (this->usesReportIDs){
+        if (length < 1)
+            return false;
+        *reportID = report[0];
+        *data = report + 1;
+        *dataLength = length - 1;
+    } else {
+        *reportID = 0;
+        *data = report;
+        *dataLength = length;
+    }
+    return true;
+}
+
+UInt32 VoodooI2CHIDReportDescriptor::getUnsigned(const UInt8 *data, UInt32 dataLength, const VoodooI2CHIDField *field){
+    UInt32 bitSize = field->bitSize > 32 ? 32 : field->bitSize;
+    if (bitSize == 0 || field->bitOffset + bitSize > dataLength * 8)
+        return 0;
+
+    UInt32 value = 0;
+    UInt32 bit = field->bitOffset;
+    for (UInt32 done = 0; done < bitSize;){
+        UInt32 shift = bit & 7;
+        UInt32 take = 8 - shift;
+        if (take > bitSize - done)
+            take = bitSize - done;
+        UInt32 chunk = (data[bit >> 3] >> shift) & ((1U << take) - 1);
+        value |= chunk << done;
+        done += take;
+        bit += take;
+    }
+    return value;
+}
+
+SInt32 VoodooI2CHIDReportDescriptor::getValue(const UInt8 *data, UInt32 dataLength, const VoodooI2CHIDField *field){
+    UInt32 value = getUnsigned(data, dataLength, field);
+    UInt32 bitSize = field->bitSize > 32 ? 32 : field->bitSize;
+    //Sign extend only when the logical range says the field is signed
+    if (field->logicalMin < 0 && bitSize > 0 && bitSize < 32 && (value & (1U << (bitSize - 1))))
+        value |= ~((1U << bitSize) - 1);
+    return (SInt32)value;
+}
+
+void VoodooI2CHIDReportDescriptor::setValue(UInt8 *data, UInt32 dataLength, const VoodooI2CHIDField *field, SInt32 value){
+    UInt32 bitSize = field->bitSize > 32 ? 32 : field->bitSize;
+    if (bitSize == 0 || field->bitOffset + bitSize > dataLength * 8)
+        return;
+
+    UInt32 uvalue = (UInt32)value;
+    UInt32 bit = field->bitOffset;
+    for (UInt32 done = 0; done < bitSize;){
+        UInt32 shift = bit & 7;
+        UInt32 take = 8 - shift;
+        if (take > bitSize - done)
+            take = bitSize - done;
+        UInt8 mask = ((1U << take) - 1) << shift;
+        data[bit >> 3] = (data[bit >> 3] & ~mask) | (((uvalue >> done) << shift) & mask);
+        done += take;
+        bit += take;
+    }
+}
@@ -0,0 +1,86 @@
+//
+//  VoodooI2CHIDReportDescriptor.hpp
+//  VoodooI2CHID
+//
+//  Created on 10/19/26.
+//  Copyright © 2026 VoodooI2C contributors. All rights reserved.
+//
+
+#ifndef VoodooI2CHIDReportDescriptor_hpp
+#define VoodooI2CHIDReportDescriptor_hpp
+
+#include <IOKit/IOLib.h>
+#include <IOKit/hid/IOHIDDevice.h>
+#include <IOKit/hid/IOHIDUsageTables.h>
+
+#define kVoodooI2CHIDMaxFields 192
+#define kVoodooI2CHIDMaxReports 32
+#define kVoodooI2CHIDMaxApplications 8
+#define kVoodooI2CHIDMaxUsages 16
+#define kVoodooI2CHIDMaxCollectionDepth 8
+#define kVoodooI2CHIDMaxGlobalStack 4
+
+#define kVoodooI2CHIDFieldConstant 0x01
+#define kVoodooI2CHIDFieldVariable 0x02
+
+typedef struct {
+    UInt8 reportID;
+    UInt8 reportType;
+    UInt8 flags;
+    UInt8 bitSize;
+    UInt8 count;
+    UInt32 bitOffset;
+    UInt16 usagePage;
+    UInt16 usage;
+    UInt16 usageMax;
+    UInt16 collection;
+    UInt8 application;
+    SInt32 logicalMin;
+    SInt32 logicalMax;
+} VoodooI2CHIDField;
+
+typedef struct {
+    UInt16 usagePage;
+    UInt16 usage;
+} VoodooI2CHIDApplication;
+
+//Flat view of the input, output and feature fields in a report descriptor
+class VoodooI2CHIDReportDescriptor {
+public:
+    VoodooI2CHIDField fields[kVoodooI2CHIDMaxFields];
+    UInt16 fieldCount;
+
+    VoodooI2CHIDApplication applications[kVoodooI2CHIDMaxApplications];
+    UInt8 applicationCount;
+
+    bool usesReportIDs;
+
+    bool parse(const UInt8 *descriptor, UInt32 length);
+
+    const VoodooI2CHIDField *findField(UInt8 reportType, UInt16 usagePage, UInt16 usage, const VoodooI2CHIDField *after = NULL) const;
+    const VoodooI2CHIDField *findFieldInReport(UInt8 reportType, UInt8 reportID, UInt16 usagePage, UInt16 usage, const VoodooI2CHIDField *after = NULL) const;
+    bool hasApplication(UInt16 usagePage, UInt16 usage) const;
+
+    UInt32 reportLength(UInt8 reportType, UInt8 reportID) const;
+    //Also true when the descriptor has more reports than are tracked, as the ID can't be ruled out
+    bool reportIDInUse(UInt8 reportID) const;
+
+    //Splits a report into its ID and the field data that bit offsets are relative to
+    bool reportData(UInt8 *report, UInt32 length, UInt8 *reportID, UInt8 **data, UInt32 *dataLength) const;
+
+    static UInt32 getUnsigned(const UInt8 *data, UInt32 dataLength, const VoodooI2CHIDField *field);
+    static SInt32 getValue(const UInt8 *data, UInt32 dataLength, const VoodooI2CHIDField *field);
+    static void setValue(UInt8 *data, UInt32 dataLength, const VoodooI2CHIDField *field, SInt32 value);
+
+private:
+    struct {
+        UInt8 reportID;
+        UInt32 bits[3];
+    } reports[kVoodooI2CHIDMaxReports];
+    UInt8 reportCount;
+
+    bool parseItems(const UInt8 *descriptor, UInt32 length);
+    UInt32 *reportBits(UInt8 reportType, UInt8 reportID, bool create);
+};
+
+#endif /* VoodooI2CHIDReportDescriptor_hpp */
@@ -0,0 +1,161 @@
+//
+//  VoodooI2CHIDTouchTransform.cpp
+//  VoodooI2CHID
+//
+//  Created on 10/19/26.
+//  Copyright © 2026 VoodooI2C contributors. All rights reserved.
+//
+
+#include "VoodooI2CHIDTouchTransform.hpp"
+
+static const SInt32 identityMatrix[6] = {
+    kTouchTransformOne, 0, 0,
+    0, kTouchTransformOne, 0
+};
+
+void VoodooI2CHIDTouchTransform::matrixForOrientation(UInt32 rotation, bool flipX, bool flipY, SInt32 matrix[6]){
+    memcpy(matrix, identityMatrix, sizeof(identityMatrix));
+
+    switch (rotation){
+        case 90:
+            matrix[0] = 0;
+            matrix[1] = -kTouchTransformOne;
+            matrix[2] = kTouchTransformOne;
+            matrix[3] = kTouchTransformOne;
+            matrix[4] = 0;
+            matrix[5] = 0;
+            break;
+        case 180:
+            matrix[0] = -kTouchTransformOne;
+            matrix[2] = kTouchTransformOne;
+            matrix[4] = -kTouchTransformOne;
+            matrix[5] = kTouchTransformOne;
+            break;
+        case 270:
+            matrix[0] = 0;
+            matrix[1] = kTouchTransformOne;
+            matrix[2] = 0;
+            matrix[3] = -kTouchTransformOne;
+            matrix[4] = 0;
+            matrix[5] = kTouchTransformOne;
+            break;
+    }
+
+    //Flips apply after the rotation
+    if (flipX){
+        matrix[0] = -matrix[0];
+        matrix[1] = -matrix[1];
+        matrix[2] = kTouchTransformOne - matrix[2];
+    }
+    if (flipY){
+        matrix[3] = -matrix[3];
+        matrix[4] = -matrix[4];
+        matrix[5] = kTouchTransformOne - matrix[5];
+    }
+}
+
+static const VoodooI2CHIDField *findInCollection(const VoodooI2CHIDReportDescriptor *descriptor, const VoodooI2CHIDField *x, UInt16 usage){
+    const VoodooI2CHIDField *field = NULL;
+    while ((field = descriptor->findFieldInReport(kIOHIDReportTypeInput, x->reportID, kHIDPage_Digitizer, usage, field))){
+        if (field->collection == x->collection)
+            return field;
+    }
+    return NULL;
+}
+
+bool VoodooI2CHIDTouchTransform::configure(const VoodooI2CHIDReportDescriptor *descriptor, const SInt32 matrix[6]){
+    this->descriptor = descriptor;
+    this->enabled = false;
+    this->frames = 0;
+    this->contacts = 0;
+    this->contactCount = 0;
+    memcpy(this->matrix, matrix, sizeof(this->matrix));
+
+    if (memcmp(this->matrix, identityMatrix, sizeof(identityMatrix)) == 0)
+        return false;
+
+    //Every finger collection in the touchscreen report contributes one X/Y pair
+    const VoodooI2CHIDField *x = NULL;
+    while ((x = descriptor->findField(kIOHIDReportTypeInput, kHIDPage_GenericDesktop, kHIDUsage_GD_X, x)) && this->contactCount < kTouchTransformMaxContacts){
+        if (x->application >= descriptor->applicationCount ||
+            descriptor->applications[x->application].usagePage != kHIDPage_Digitizer ||
+            descriptor->applications[x->application].usage != kHIDUsage_Dig_TouchScreen)
+            continue;
+        if (this->contactCount > 0 && x->reportID != this->reportID)
+            continue;
+
+        const VoodooI2CHIDField *y = NULL;
+        while ((y = descriptor->findFieldInReport(kIOHIDReportTypeInput, x->reportID, kHIDPage_GenericDesktop, kHIDUsage_GD_Y, y))){
+            if (y->collection == x->collection)
+                break;
+        }
+        if (!y || x->logicalMax <= x->logicalMin || y->logicalMax <= y->logicalMin)
+            continue;
+
+        this->reportID = x->reportID;
+        this->xFields[this->contactCount] = x;
+        this->yFields[this->contactCount] = y;
+        this->tipFields[this->contactCount] = findInCollection(descriptor, x, kHIDUsage_Dig_TipSwitch);
+        this->confidenceFields[this->contactCount] = findInCollection(descriptor, x, kHIDUsage_Dig_Confidence);
+        this->contactCount++;
+    }
+
+    this->enabled = (this->contactCount > 0);
+    return this->enabled;
+}
+
+void VoodooI2CHIDTouchTransform::process(UInt8 *report, UInt32 length){
+    if (!this->enabled)
+        return;
+
+    UInt8 id;
+    UInt8 *data;
+    UInt32 dataLength;
+    if (!this->descriptor->reportData(report, length, &id, &data, &dataLength) || id != this->reportID)
+        return;
+
+    int count = 0;
+    int slots[kTouchTransformMaxContacts];
+    SInt64 nx[kTouchTransformMaxContacts];
+    SInt64 ny[kTouchTransformMaxContacts];
+    SInt64 tx[kTouchTransformMaxContacts];
+    SInt64 ty[kTouchTransformMaxContacts];
+
+    //Gather, transform and scatter in separate passes so the middle one is a straight-line loop over the active contacts
+    for (int i = 0; i < this->contactCount; i++){
+        if (this->tipFields[i] && !VoodooI2CHIDReportDescriptor::getUnsigned(data, dataLength, this->tipFields[i]))
+            continue;
+        if (this->confidenceFields[i] && !VoodooI2CHIDReportDescriptor::getUnsigned(data, dataLength, this->confidenceFields[i]))
+            continue;
+
+        const VoodooI2CHIDField *xField = this->xFields[i];
+        const VoodooI2CHIDField *yField = this->yFields[i];
+        SInt64 x = VoodooI2CHIDReportDescriptor::getValue(data, dataLength, xField);
+        SInt64 y = VoodooI2CHIDReportDescriptor::getValue(data, dataLength, yField);
+        slots[count] = i;
+        nx[count] = (x - xField->logicalMin) * kTouchTransformOne / (xField->logicalMax - xField->logicalMin);
+        ny[count] = (y - yField->logicalMin) * kTouchTransformOne / (yField->logicalMax - yField->logicalMin);
+        count++;
+    }
+
+    const SInt64 m0 = this->matrix[0], m1 = this->matrix[1], m2 = this->matrix[2];
+    const SInt64 m3 = this->matrix[3], m4 = this->matrix[4], m5 = this->matrix[5];
+    for (int i = 0; i < count; i++){
+        tx[i] = ((m0 * nx[i] + m1 * ny[i]) / kTouchTransformOne) + m2;
+        ty[i] = ((m3 * nx[i] + m4 * ny[i]) / kTouchTransformOne) + m5;
+        tx[i] = tx[i] < 0 ? 0 : (tx[i] > kTouchTransformOne ? kTouchTransformOne : tx[i]);
+        ty[i] = ty[i] < 0 ? 0 : (ty[i] > kTouchTransformOne ? kTouchTransformOne : ty[i]);
+    }
+
+    for (int i = 0; i < count; i++){
+        const VoodooI2CHIDField *xField = this->xFields[slots[i]];
+        const VoodooI2CHIDField *yField = this->yFields[slots[i]];
+        SInt64 x = xField->logicalMin + tx[i] * (xField->logicalMax - xField->logicalMin) / kTouchTransformOne;
+        SInt64 y = yField->logicalMin + ty[i] * (yField->logicalMax - yField->logicalMin) / kTouchTransformOne;
+        VoodooI2CHIDReportDescriptor::setValue(data, dataLength, xField, (SInt32)x);
+        VoodooI2CHIDReportDescriptor::setValue(data, dataLength, yField, (SInt32)y);
+    }
+
+    this->contacts += count;
+    this->frames++;
+}
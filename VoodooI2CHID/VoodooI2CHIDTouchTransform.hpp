@@ -0,0 +1,54 @@
+//
+//  VoodooI2CHIDTouchTransform.hpp
+//  VoodooI2CHID
+//
+//  Created on 10/19/26.
+//  Copyright © 2026 VoodooI2C contributors. All rights reserved.
+//
+
+#ifndef VoodooI2CHIDTouchTransform_hpp
+#define VoodooI2CHIDTouchTransform_hpp
+
+#include "VoodooI2CHIDReportDescriptor.hpp"
+
+#define kTouchTransformMaxContacts 16
+
+//16.16 fixed point
+#define kTouchTransformOne 65536
+
+// Maps touchscreen contacts through a 2x3 affine matrix in normalized
+// coordinates, where (0, 0) and (kTouchTransformOne, kTouchTransformOne) are
+// the opposite corners of the logical range:
+//
+//     x' = m[0] * x + m[1] * y + m[2]
+//     y' = m[3] * x + m[4] * y + m[5]
+//
+// The matrix comes from the TouchTransform property (six 16.16 integers), or
+// is built from TouchRotation (0, 90, 180 or 270) and TouchFlipX/TouchFlipY.
+// Contact slots whose tip switch or confidence is off are left as they are.
+class VoodooI2CHIDTouchTransform {
+public:
+    UInt64 frames;
+    UInt64 contacts;
+
+    bool configure(const VoodooI2CHIDReportDescriptor *descriptor, const SInt32 matrix[6]);
+    bool isEnabled() const { return this->enabled; }
+
+    static void matrixForOrientation(UInt32 rotation, bool flipX, bool flipY, SInt32 matrix[6]);
+
+    void process(UInt8 *report, UInt32 length);
+
+private:
+    const VoodooI2CHIDReportDescriptor *descriptor;
+    bool enabled;
+    UInt8 reportID;
+    SInt32 matrix[6];
+
+    UInt8 contactCount;
+    const VoodooI2CHIDField *xFields[kTouchTransformMaxContacts];
+    const VoodooI2CHIDField *yFields[kTouchTransformMaxContacts];
+    const VoodooI2CHIDField *tipFields[kTouchTransformMaxContacts];
+    const VoodooI2CHIDField *confidenceFields[kTouchTransformMaxContacts];
+};
+
+#endif /* VoodooI2CHIDTouchTransform_hpp */
@@ -0,0 +1,119 @@
+//
+//  VoodooI2CHIDTouchpadModes.cpp
+//  VoodooI2CHID
+//
+//  Created on 10/19/26.
+//  Copyright © 2026 VoodooI2C contributors. All rights reserved.
+//
+
+#include "VoodooI2CHIDTouchpadModes.hpp"
+
+//Other digitizer applications reuse these usages with different meanings, only trust the touch pad's
+static const VoodooI2CHIDField *findTouchPadFeature(const VoodooI2CHIDReportDescriptor *descriptor, UInt16 usage){
+    const VoodooI2CHIDField *field = NULL;
+    while ((field = descriptor->findField(kIOHIDReportTypeFeature, kHIDPage_Digitizer, usage, field))){
+        if (field->application < descriptor->applicationCount &&
+            descriptor->applications[field->application].usagePage == kHIDPage_Digitizer &&
+            descriptor->applications[field->application].usage == kPTPUsageTouchPad)
+            return field;
+    }
+    return NULL;
+}
+
+bool VoodooI2CHIDTouchpadModes::configure(const VoodooI2CHIDReportDescriptor *descriptor, bool selectInputMode, UInt32 idleMs){
+    this->descriptor = descriptor;
+    this->inputMode = selectInputMode ? findTouchPadFeature(descriptor, kPTPUsageInputMode) : NULL;
+    this->latencyMode = findTouchPadFeature(descriptor, kPTPUsageLatencyMode);
+    this->surfaceSwitch = NULL;
+    this->buttonSwitch = NULL;
+
+    //Selective reporting switches only matter when they share the input mode report
+    if (this->inputMode){
+        this->surfaceSwitch = descriptor->findFieldInReport(kIOHIDReportTypeFeature, this->inputMode->reportID, kHIDPage_Digitizer, kPTPUsageSurfaceSwitch);
+        this->buttonSwitch = descriptor->findFieldInReport(kIOHIDReportTypeFeature, this->inputMode->reportID, kHIDPage_Digitizer, kPTPUsageButtonSwitch);
+    }
+
+    if (idleMs == 0)
+        this->latencyMode = NULL;
+    this->idleNs = (UInt64)idleMs * 1000000ULL;
+
+    memset(this->timeInModeNs, 0, sizeof(this->timeInModeNs));
+    this->latencySwitches = 0;
+    this->maxSwitchNs = 0;
+    this->mode = kPTPLatencyNormal;
+    this->modeSinceNs = 0;
+    this->lastActivityNs = 0;
+
+    return this->inputMode || this->latencyMode;
+}
+
+bool VoodooI2CHIDTouchpadModes::buildReport(const VoodooI2CHIDField *field, SInt32 value, UInt8 *reportID, UInt8 *buffer, UInt16 *length) const {
+    if (!field)
+        return false;
+
+    UInt32 reportLength = this->descriptor->reportLength(kIOHIDReportTypeFeature, field->reportID);
+    if (reportLength == 0 || reportLength > kPTPMaxFeatureReport)
+        return false;
+
+    memset(buffer, 0, reportLength);
+    VoodooI2CHIDReportDescriptor::setValue(buffer, reportLength, field, value);
+    *reportID = field->reportID;
+    *length = reportLength;
+    return true;
+}
+
+bool VoodooI2CHIDTouchpadModes::buildInputModeReport(UInt8 *reportID, UInt8 *buffer, UInt16 *length) const {
+    if (!buildReport(this->inputMode, kPTPInputModeTouchpad, reportID, buffer, length))
+        return false;
+    if (this->surfaceSwitch)
+        VoodooI2CHIDReportDescriptor::setValue(buffer, *length, this->surfaceSwitch, 1);
+    if (this->buttonSwitch)
+        VoodooI2CHIDReportDescriptor::setValue(buffer, *length, this->buttonSwitch, 1);
+    return true;
+}
+
+bool VoodooI2CHIDTouchpadModes::buildLatencyModeReport(int mode, UInt8 *reportID, UInt8 *buffer, UInt16 *length) const {
+    return buildReport(this->latencyMode, mode == kPTPLatencyHigh ? kPTPLatencyModeHigh : kPTPLatencyModeNormal, reportID, buffer, length);
+}
+
+bool VoodooI2CHIDTouchpadModes::activity(UInt64 nowNs){
+    this->lastActivityNs = nowNs;
+    return this->latencyMode && this->mode == kPTPLatencyHigh;
+}
+
+bool VoodooI2CHIDTouchpadModes::idle(UInt64 nowNs, UInt64 *remainingNs){
+    *remainingNs = 0;
+    if (!this->latencyMode || this->mode == kPTPLatencyHigh)
+        return false;
+
+    UInt64 quietNs = nowNs - this->lastActivityNs;
+    if (quietNs >= this->idleNs)
+        return true;
+    *remainingNs = this->idleNs - quietNs;
+    return false;
+}
+
+void VoodooI2CHIDTouchpadModes::modeChanged(int mode, UInt64 nowNs, UInt64 switchNs){
+    this->timeInModeNs[this->mode] += nowNs - this->modeSinceNs;
+    this->mode = mode;
+    this->modeSinceNs = nowNs;
+    this->latencySwitches++;
+    if (switchNs > this->maxSwitchNs)
+        this->maxSwitchNs = switchNs;
+}
+
+void VoodooI2CHIDTouchpadModes::reset(UInt64 nowNs){
+    //Devices come out of reset in normal latency mode
+    if (this->modeSinceNs)
+        this->timeInModeNs[this->mode] += nowNs - this->modeSinceNs;
+    this->mode = kPTPLatencyNormal;
+    this->modeSinceNs = nowNs;
+    this->lastActivityNs = nowNs;
+}
+
+UInt64 VoodooI2CHIDTouchpadModes::timeInMode(int mode, UInt64 nowNs) const {
+    UInt64 total = this->timeInModeNs[mode];
+    if (mode == this->mode && this->modeSinceNs)
+        total += nowNs - this->modeSinceNs;
+    return total;
+}
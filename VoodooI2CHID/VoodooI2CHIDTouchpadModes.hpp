@@ -0,0 +1,77 @@
+//
+//  VoodooI2CHIDTouchpadModes.hpp
+//  VoodooI2CHID
+//
+//  Created on 10/19/26.
+//  Copyright © 2026 VoodooI2C contributors. All rights reserved.
+//
+
+#ifndef VoodooI2CHIDTouchpadModes_hpp
+#define VoodooI2CHIDTouchpadModes_hpp
+
+#include "VoodooI2CHIDReportDescriptor.hpp"
+
+//Precision Touchpad feature usages on the digitizer page
+#define kPTPUsageInputMode 0x52
+#define kPTPUsageSurfaceSwitch 0x57
+#define kPTPUsageButtonSwitch 0x58
+#define kPTPUsageLatencyMode 0x60
+
+#define kPTPUsageTouchPad 0x05
+
+#define kPTPInputModeTouchpad 0x03
+
+#define kPTPLatencyModeNormal 0
+#define kPTPLatencyModeHigh 1
+
+#define kPTPMaxFeatureReport 16
+
+enum {
+    kPTPLatencyNormal = 0,
+    kPTPLatencyHigh,
+    kPTPLatencyCount
+};
+
+//Input mode selection and activity-driven latency mode policy for Precision Touchpads.
+//The device owns the I/O; this only decides when to switch and builds the feature reports.
+class VoodooI2CHIDTouchpadModes {
+public:
+    UInt64 timeInModeNs[kPTPLatencyCount];
+    UInt64 latencySwitches;
+    UInt64 maxSwitchNs;
+
+    bool configure(const VoodooI2CHIDReportDescriptor *descriptor, bool selectInputMode, UInt32 idleMs);
+    bool hasInputMode() const { return this->inputMode != NULL; }
+    bool hasLatencyMode() const { return this->latencyMode != NULL; }
+
+    bool buildInputModeReport(UInt8 *reportID, UInt8 *buffer, UInt16 *length) const;
+    bool buildLatencyModeReport(int mode, UInt8 *reportID, UInt8 *buffer, UInt16 *length) const;
+
+    //Returns true when a touch should move the device out of high-latency mode
+    bool activity(UInt64 nowNs);
+    //Returns true when the device has been idle long enough to go back to high-latency mode,
+    //otherwise how long until it might be
+    bool idle(UInt64 nowNs, UInt64 *remainingNs);
+
+    void modeChanged(int mode, UInt64 nowNs, UInt64 switchNs);
+    void reset(UInt64 nowNs);
+
+    UInt64 timeInMode(int mode, UInt64 nowNs) const;
+
+private:
+    const VoodooI2CHIDField *inputMode;
+    const VoodooI2CHIDField *surfaceSwitch;
+    const VoodooI2CHIDField *buttonSwitch;
+    const VoodooI2CHIDField *latencyMode;
+
+    UInt64 idleNs;
+    int mode;
+    UInt64 modeSinceNs;
+    volatile UInt64 lastActivityNs;
+
+    const VoodooI2CHIDReportDescriptor *descriptor;
+
+    bool buildReport(const VoodooI2CHIDField *field, SInt32 value, UInt8 *reportID, UInt8 *buffer, UInt16 *length) const;
+};
+
+#endif /* VoodooI2CHIDTouchpadModes_hpp */
@@ -0,0 +1,103 @@
+//
+//  VoodooI2CHIDTrace.cpp
+//  VoodooI2CHID
+//
+//  Created on 10/19/26.
+//  Copyright © 2026 VoodooI2C contributors. All rights reserved.
+//
+
+#include "VoodooI2CHIDTrace.hpp"
+
+void VoodooI2CHIDTrace::init(bool enabled){
+    this->head = 0;
+    this->dumping = 0;
+    this->enabled = false;
+    this->events = NULL;
+    if (!enabled)
+        return;
+
+    //Only devices that trace pay for the ring
+    this->events = (VoodooI2CHIDTraceEvent *)IOMalloc(kVoodooI2CHIDTraceRecords * sizeof(VoodooI2CHIDTraceEvent));
+    if (!this->events)
+        return;
+    memset(this->events, 0, kVoodooI2CHIDTraceRecords * sizeof(VoodooI2CHIDTraceEvent));
+    this->enabled = true;
+}
+
+void VoodooI2CHIDTrace::release(){
+    this->enabled = false;
+    OSMemoryBarrier();
+    
+    //A registry read may be copying the ring, it either saw the flag cleared or is counted here
+    while (this->dumping)
+        IOSleep(1);
+    
+    if (this->events){
+        IOFree(this->events, kVoodooI2CHIDTraceRecords * sizeof(VoodooI2CHIDTraceEvent));
+        this->events = NULL;
+    }
+}
+
+void VoodooI2CHIDTrace::append(VoodooI2CHIDTraceEventType event, UInt32 report, UInt16 arg, UInt32 value){
+    UInt32 sequence = (UInt32)OSIncrementAtomic(&this->head);
+    VoodooI2CHIDTraceEvent *entry = &this->events[sequence & (kVoodooI2CHIDTraceRecords - 1)];
+
+    entry->committed = 0;
+    OSMemoryBarrier();
+    entry->timestamp = mach_absolute_time();
+    entry->report = report;
+    entry->event = event;
+    entry->arg = arg;
+    entry->value = value;
+    OSMemoryBarrier();
+    entry->committed = sequence + 1;
+}
+
+OSData *VoodooI2CHIDTrace::copyDump() const {
+    OSIncrementAtomic(&this->dumping);
+    OSMemoryBarrier();
+    OSData *dump = this->enabled ? copyRing() : NULL;
+    OSDecrementAtomic(&this->dumping);
+    return dump;
+}
+
+OSData *VoodooI2CHIDTrace::copyRing() const {
+    UInt32 head = (UInt32)this->head;
+    UInt32 count = head < kVoodooI2CHIDTraceRecords ? head : kVoodooI2CHIDTraceRecords;
+
+    OSData *dump = OSData::withCapacity(sizeof(VoodooI2CHIDTraceHeader) + count * sizeof(VoodooI2CHIDTraceEvent));
+    if (!dump)
+        return NULL;
+
+    VoodooI2CHIDTraceHeader header;
+    header.magic = kVoodooI2CHIDTraceMagic;
+    header.version = kVoodooI2CHIDTraceVersion;
+    header.eventSize = sizeof(VoodooI2CHIDTraceEvent);
+    header.count = 0;
+    header.lost = head - count;
+    dump->appendBytes(&header, sizeof(header));
+
+    for (UInt32 sequence = head - count; sequence != head; sequence++){
+        const VoodooI2CHIDTraceEvent *entry = &this->events[sequence & (kVoodooI2CHIDTraceRecords - 1)];
+        VoodooI2CHIDTraceEvent copy;
+        
+        //Skip events still being written or overwritten while we copy
+        if (entry->committed != sequence + 1)
+            continue;
+        OSMemoryBarrier();
+        memcpy(&copy, entry, sizeof(copy));
+        OSMemoryBarrier();
+        if (entry->committed != sequence + 1)
+            continue;
+        
+        absolutetime_to_nanoseconds(copy.timestamp, &copy.timestamp);
+        copy.committed = 0;
+        dump->appendBytes(&copy, sizeof(copy));
+        header.count++;
+    }
+
+    //Patch the final count into the header
+    VoodooI2CHIDTraceHeader *dumped = (VoodooI2CHIDTraceHeader *)dump->getBytesNoCopy();
+    dumped->count = header.count;
+    return dump;
+}
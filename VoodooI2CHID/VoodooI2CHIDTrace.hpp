@@ -0,0 +1,81 @@
+//
+//  VoodooI2CHIDTrace.hpp
+//  VoodooI2CHID
+//
+//  Created on 10/19/26.
+//  Copyright © 2026 VoodooI2C contributors. All rights reserved.
+//
+
+#ifndef VoodooI2CHIDTrace_hpp
+#define VoodooI2CHIDTrace_hpp
+
+#include <IOKit/IOLib.h>
+#include <libkern/OSAtomic.h>
+#include <libkern/c++/OSData.h>
+
+//Must be a power of two
+#define kVoodooI2CHIDTraceRecords 1024
+
+#define kVoodooI2CHIDTraceMagic 0x54483249 /* 'I2HT' */
+#define kVoodooI2CHIDTraceVersion 1
+
+enum VoodooI2CHIDTraceEventType {
+    kVoodooI2CHIDTraceInterrupt = 0,      //value: 1 if dropped because a read was in flight
+    kVoodooI2CHIDTraceReaderWake,
+    kVoodooI2CHIDTraceTransferStart,      //arg: transfer class, value: message count
+    kVoodooI2CHIDTraceTransferEnd,        //arg: transfer class, value: IOReturn
+    kVoodooI2CHIDTraceLengthParsed,       //value: length header
+    kVoodooI2CHIDTraceDispatchStart,      //value: report length
+    kVoodooI2CHIDTraceDispatchEnd,        //value: IOReturn
+    kVoodooI2CHIDTracePowerState,         //arg: 0 system power, 1 autosuspend, value: new state
+    kVoodooI2CHIDTraceResetStart,
+    kVoodooI2CHIDTraceResetComplete,
+    kVoodooI2CHIDTraceEventCount
+};
+
+//Dump layout, as published in the EventTrace registry property:
+//one VoodooI2CHIDTraceHeader followed by count VoodooI2CHIDTraceEvent records, oldest first.
+//Events sharing a report number belong to the same interrupt.
+typedef struct {
+    UInt32 magic;
+    UInt16 version;
+    UInt16 eventSize;
+    UInt32 count;
+    UInt32 lost;
+} VoodooI2CHIDTraceHeader;
+
+typedef struct {
+    UInt64 timestamp;   //Nanoseconds in dumps, absolute time while in the ring
+    UInt32 report;
+    UInt16 event;
+    UInt16 arg;
+    UInt32 value;
+    UInt32 committed;   //Ring sequence + 1 while in the ring, 0 in dumps
+} VoodooI2CHIDTraceEvent;
+
+//Fixed-size binary trace of the input pipeline, overwriting the oldest events when full
+class VoodooI2CHIDTrace {
+public:
+    void init(bool enabled);
+    void release();
+    bool isEnabled() const { return this->enabled; }
+
+    inline void record(VoodooI2CHIDTraceEventType event, UInt32 report, UInt16 arg = 0, UInt32 value = 0){
+        if (this->enabled)
+            append(event, report, arg, value);
+    }
+
+    //Snapshot of the ring in the dump layout. Safe against a concurrent release(), which waits for it.
+    OSData *copyDump() const;
+
+private:
+    volatile bool enabled;
+    volatile SInt32 head;
+    mutable volatile SInt32 dumping;
+    VoodooI2CHIDTraceEvent *events;
+
+    void append(VoodooI2CHIDTraceEventType event, UInt32 report, UInt16 arg, UInt32 value);
+    OSData *copyRing() const;
+};
+
+#endif /* VoodooI2CHIDTrace_hpp */
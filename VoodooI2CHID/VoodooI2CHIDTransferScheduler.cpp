@@ -0,0 +1,203 @@
+//
+//  VoodooI2CHIDTransferScheduler.cpp
+//  VoodooI2CHID
+//
+//  Created on 10/19/26.
+//  Copyright © 2026 VoodooI2C contributors. All rights reserved.
+//
+
+#include "VoodooI2CHIDTransferScheduler.hpp"
+#include <libkern/OSAtomic.h>
+#include <libkern/c++/OSNumber.h>
+#include <kern/clock.h>
+
+#define super OSObject
+
+OSDefineMetaClassAndStructors(VoodooI2CHIDTransferScheduler, OSObject);
+
+static const char *transferClassNames[kVoodooI2CHIDTransferClassCount] = {
+    "Input",
+    "Output",
+    "Management"
+};
+
+//Globals are constructed when the kext loads and destroyed when it unloads, by which point every device has relinquished its scheduler
+static class VoodooI2CHIDSchedulerList {
+public:
+    IOLock *lock;
+    VoodooI2CHIDTransferScheduler *head;
+
+    VoodooI2CHIDSchedulerList() : lock(IOLockAlloc()), head(NULL) {}
+    ~VoodooI2CHIDSchedulerList() {
+        if (this->lock)
+            IOLockFree(this->lock);
+    }
+} gSchedulers;
+
+VoodooI2CHIDTransferScheduler *VoodooI2CHIDTransferScheduler::acquire(VoodooI2CControllerDriver *controller){
+    if (!gSchedulers.lock || !controller)
+        return NULL;
+
+    IOLockLock(gSchedulers.lock);
+    VoodooI2CHIDTransferScheduler *scheduler = gSchedulers.head;
+    while (scheduler && scheduler->controller != controller)
+        scheduler = scheduler->next;
+
+    if (!scheduler){
+        scheduler = new VoodooI2CHIDTransferScheduler;
+        if (scheduler && !scheduler->initWithController(controller)){
+            scheduler->release();
+            scheduler = NULL;
+        }
+        if (scheduler){
+            scheduler->next = gSchedulers.head;
+            gSchedulers.head = scheduler;
+        }
+    }
+    if (scheduler)
+        scheduler->users++;
+    IOLockUnlock(gSchedulers.lock);
+    return scheduler;
+}
+
+void VoodooI2CHIDTransferScheduler::relinquish(){
+    IOLockLock(gSchedulers.lock);
+    bool lastUser = (--this->users == 0);
+    if (lastUser){
+        VoodooI2CHIDTransferScheduler **link = &gSchedulers.head;
+        while (*link && *link != this)
+            link = &(*link)->next;
+        if (*link)
+            *link = this->next;
+    }
+    IOLockUnlock(gSchedulers.lock);
+
+    if (lastUser)
+        release();
+}
+
+bool VoodooI2CHIDTransferScheduler::initWithController(VoodooI2CControllerDriver *controller){
+    if (!super::init())
+        return false;
+
+    this->lock = IOLockAlloc();
+    if (!this->lock)
+        return false;
+
+    this->controller = controller;
+    this->controller->retain();
+    this->busy = false;
+    this->next = NULL;
+    this->users = 0;
+
+    memset(this->nextTicket, 0, sizeof(this->nextTicket));
+    memset(this->servingTicket, 0, sizeof(this->servingTicket));
+    memset(this->passedOver, 0, sizeof(this->passedOver));
+    memset(this->stats, 0, sizeof(this->stats));
+    return true;
+}
+
+void VoodooI2CHIDTransferScheduler::free(){
+    if (this->lock){
+        IOLockFree(this->lock);
+        this->lock = NULL;
+    }
+    OSSafeReleaseNULL(this->controller);
+    super::free();
+}
+
+int VoodooI2CHIDTransferScheduler::nextClass(){
+    //A starved class is served first, otherwise the highest priority waiter wins
+    for (int i = 0; i < kVoodooI2CHIDTransferClassCount; i++){
+        if (this->nextTicket[i] != this->servingTicket[i] && this->passedOver[i] >= kVoodooI2CHIDTransferStarvationLimit)
+            return i;
+    }
+    for (int i = 0; i < kVoodooI2CHIDTransferClassCount; i++){
+        if (this->nextTicket[i] != this->servingTicket[i])
+            return i;
+    }
+    return -1;
+}
+
+IOReturn VoodooI2CHIDTransferScheduler::transfer(VoodooI2CHIDTransferClass transferClass, VoodooI2CControllerBusMessage *messages, int number, UInt64 *busTimeNs){
+    if (transferClass >= kVoodooI2CHIDTransferClassCount)
+        return kIOReturnBadArgument;
+
+    uint64_t queuedAt = mach_absolute_time();
+
+    IOLockLock(this->lock);
+    UInt32 ticket = this->nextTicket[transferClass]++;
+    while (this->busy || nextClass() != transferClass || this->servingTicket[transferClass] != ticket)
+        IOLockSleep(this->lock, this, THREAD_UNINT);
+
+    bool starved = (this->passedOver[transferClass] >= kVoodooI2CHIDTransferStarvationLimit);
+
+    this->busy = true;
+    this->servingTicket[transferClass]++;
+    this->passedOver[transferClass] = 0;
+    for (int i = transferClass + 1; i < kVoodooI2CHIDTransferClassCount; i++){
+        if (this->nextTicket[i] != this->servingTicket[i])
+            this->passedOver[i]++;
+    }
+
+    uint64_t waitNs;
+    absolutetime_to_nanoseconds(mach_absolute_time() - queuedAt, &waitNs);
+
+    VoodooI2CHIDTransferClassStats *classStats = &this->stats[transferClass];
+    classStats->transfers++;
+    classStats->totalWaitNs += waitNs;
+    if (waitNs > classStats->maxWaitNs)
+        classStats->maxWaitNs = waitNs;
+    if (starved)
+        classStats->starvationGrants++;
+    IOLockUnlock(this->lock);
+
+    uint64_t grantedAt = mach_absolute_time();
+    IOReturn ret = this->controller->transferI2C(messages, number);
+    if (busTimeNs)
+        absolutetime_to_nanoseconds(mach_absolute_time() - grantedAt, busTimeNs);
+
+    IOLockLock(this->lock);
+    this->busy = false;
+    IOLockWakeup(this->lock, this, false);
+    IOLockUnlock(this->lock);
+    return ret;
+}
+
+OSDictionary *VoodooI2CHIDTransferScheduler::copyStatistics(){
+    OSDictionary *dict = OSDictionary::withCapacity(kVoodooI2CHIDTransferClassCount);
+    if (!dict)
+        return NULL;
+
+    VoodooI2CHIDTransferClassStats snapshot[kVoodooI2CHIDTransferClassCount];
+    IOLockLock(this->lock);
+    memcpy(snapshot, this->stats, sizeof(snapshot));
+    IOLockUnlock(this->lock);
+
+    for (int i = 0; i < kVoodooI2CHIDTransferClassCount; i++){
+        OSDictionary *classDict = OSDictionary::withCapacity(4);
+        if (!classDict)
+            continue;
+
+        UInt64 averageWaitNs = snapshot[i].transfers ? snapshot[i].totalWaitNs / snapshot[i].transfers : 0;
+
+        OSNumber *transfers = OSNumber::withNumber(snapshot[i].transfers, 64);
+        OSNumber *averageWait = OSNumber::withNumber(averageWaitNs, 64);
+        OSNumber *maxWait = OSNumber::withNumber(snapshot[i].maxWaitNs, 64);
+        OSNumber *starvationGrants = OSNumber::withNumber(snapshot[i].starvationGrants, 64);
+
+        classDict->setObject("Transfers", transfers);
+        classDict->setObject("AverageWaitNs", averageWait);
+        classDict->setObject("MaxWaitNs", maxWait);
+        classDict->setObject("StarvationGrants", starvationGrants);
+
+        OSSafeReleaseNULL(transfers);
+        OSSafeReleaseNULL(averageWait);
+        OSSafeReleaseNULL(maxWait);
+        OSSafeReleaseNULL(starvationGrants);
+
+        dict->setObject(transferClassNames[i], classDict);
+        classDict->release();
+    }
+    return dict;
+}
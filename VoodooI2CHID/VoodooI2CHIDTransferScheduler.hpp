@@ -0,0 +1,67 @@
+//
+//  VoodooI2CHIDTransferScheduler.hpp
+//  VoodooI2CHID
+//
+//  Created on 10/19/26.
+//  Copyright © 2026 VoodooI2C contributors. All rights reserved.
+//
+
+#ifndef VoodooI2CHIDTransferScheduler_hpp
+#define VoodooI2CHIDTransferScheduler_hpp
+
+#include <IOKit/IOLib.h>
+#include <IOKit/IOLocks.h>
+#include <libkern/c++/OSObject.h>
+#include <libkern/c++/OSDictionary.h>
+#include "VoodooI2CControllerDriver.hpp"
+
+//Priority classes, highest priority first
+enum VoodooI2CHIDTransferClass {
+    kVoodooI2CHIDTransferInput = 0,
+    kVoodooI2CHIDTransferOutput = 1,
+    kVoodooI2CHIDTransferManagement = 2,
+    kVoodooI2CHIDTransferClassCount = 3
+};
+
+//A lower class is granted the bus after being passed over this many times
+#define kVoodooI2CHIDTransferStarvationLimit 4
+
+struct VoodooI2CHIDTransferClassStats {
+    UInt64 transfers;
+    UInt64 totalWaitNs;
+    UInt64 maxWaitNs;
+    UInt64 starvationGrants;
+};
+
+//Serializes all HID transfers on one controller and grants the bus by priority class
+class VoodooI2CHIDTransferScheduler : public OSObject {
+    OSDeclareDefaultStructors(VoodooI2CHIDTransferScheduler);
+private:
+    VoodooI2CHIDTransferScheduler *next;
+    UInt32 users;
+
+    VoodooI2CControllerDriver *controller;
+    IOLock *lock;
+    bool busy;
+
+    UInt32 nextTicket[kVoodooI2CHIDTransferClassCount];
+    UInt32 servingTicket[kVoodooI2CHIDTransferClassCount];
+    UInt32 passedOver[kVoodooI2CHIDTransferClassCount];
+
+    VoodooI2CHIDTransferClassStats stats[kVoodooI2CHIDTransferClassCount];
+
+    bool initWithController(VoodooI2CControllerDriver *controller);
+    int nextClass();
+
+public:
+    static VoodooI2CHIDTransferScheduler *acquire(VoodooI2CControllerDriver *controller);
+    void relinquish();
+
+    virtual void free() override;
+
+    IOReturn transfer(VoodooI2CHIDTransferClass transferClass, VoodooI2CControllerBusMessage *messages, int number, UInt64 *busTimeNs = NULL);
+
+    OSDictionary *copyStatistics();
+};
+
+#endif /* VoodooI2CHIDTransferScheduler_hpp */